@@ -1,8 +1,15 @@
 {
+    "variables": {
+        # Set to 1 (e.g. `npm run rebuild -- --search_stats=1`) to count what the matchers' searches do.
+        "search_stats%": 0,
+    },
     "target_defaults": {
         "include_dirs": [
             "src",
         ],
+        "defines": [
+            "MALUUBA_SEARCH_STATS=<(search_stats)",
+        ],
         "cflags_cc": [
             "-std=c++17",
             "-Wall",
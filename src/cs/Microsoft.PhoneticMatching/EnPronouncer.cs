@@ -4,11 +4,13 @@
 namespace Microsoft.PhoneticMatching
 {
     using System;
+    using System.Collections.Generic;
+    using System.Linq;
     using System.Runtime.InteropServices;
     using System.Text;
 
     /// <summary>
-    /// Pronounces English texts.
+    /// Pronounces English texts.  Any number of threads may pronounce at once, each with a native voice of its own.
     /// </summary>
     public sealed class EnPronouncer : NativeResourceWrapper
     {
@@ -59,6 +61,85 @@ namespace Microsoft.PhoneticMatching
             return new EnPronunciation(nativePronunciation);
         }
 
+        /// <summary>
+        /// Pronounce many texts at once, in parallel, pronouncing each distinct text only once.
+        /// </summary>
+        /// <param name="phrases">The texts to pronounce.</param>
+        /// <returns>The English Pronunciation of each text, in the same order.</returns>
+        public IList<EnPronunciation> PronounceAll(IList<string> phrases)
+        {
+            if (phrases == null || phrases.Contains(null))
+            {
+                throw new ArgumentNullException("phrases can't be or contain null");
+            }
+
+            var nativePronunciations = new IntPtr[phrases.Count];
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = EnPronouncer_PronounceAll(this.Native, phrases.ToArray(), phrases.Count, nativePronunciations, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+
+            return nativePronunciations.Select(native => new EnPronunciation(native)).ToList();
+        }
+
+        /// <summary>
+        /// Set the memory budget of the pronunciation cache shared by every pronouncer in the process, which remembers the pronunciations of repeated texts.
+        /// </summary>
+        /// <param name="bytes">The budget, or 0 (the default) to disable the cache.</param>
+        public static void SetCacheBudget(long bytes)
+        {
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = EnPronouncer_SetCacheBudget(bytes, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+        }
+
+        /// <summary>
+        /// Get the counts of the pronunciation cache.
+        /// </summary>
+        /// <returns>What the cache has done and holds.</returns>
+        public static PronunciationCacheStats GetCacheStats()
+        {
+            long[] counts = new long[6];
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = EnPronouncer_CacheStats(counts, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+
+            return new PronunciationCacheStats
+            {
+                Hits = counts[0],
+                Misses = counts[1],
+                Evictions = counts[2],
+                Entries = counts[3],
+                Bytes = counts[4],
+                Budget = counts[5],
+            };
+        }
+
+        /// <summary>
+        /// Empty the pronunciation cache.
+        /// </summary>
+        public static void ClearCache()
+        {
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = EnPronouncer_ClearCache(buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+        }
+
         /// <summary>
         /// Instantiate the native resource wrapped.
         /// </summary>
@@ -97,5 +178,17 @@ namespace Microsoft.PhoneticMatching
 
         [DllImport("maluubaspeech-csharp.dll")]
         private static extern NativeResult EnPronouncer_Pronounce(IntPtr nativePtr, string phrase, out IntPtr pronunciation, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        private static extern NativeResult EnPronouncer_PronounceAll(IntPtr nativePtr, string[] phrases, int count, [Out] IntPtr[] pronunciations, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        private static extern NativeResult EnPronouncer_SetCacheBudget(long bytes, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        private static extern NativeResult EnPronouncer_CacheStats([In, Out] long[] counts, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        private static extern NativeResult EnPronouncer_ClearCache(StringBuilder buffer, ref int bufferSize);
     }
 }
@@ -5,6 +5,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
 {
     using System;
     using System.Collections.Generic;
+    using System.Linq;
     using System.Text;
     using PhoneticMatching.Distance;
 
@@ -19,10 +20,19 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
         private IList<Target> targets;
         private IList<Extraction> extractions;
         private IList<Pronounceable> pronounceables;
+
+        /// <summary>
+        /// Indices of removed targets. The native index may still compare against them, so their slots are kept.
+        /// </summary>
+        private HashSet<int> removed = new HashSet<int>();
         private DistanceFunc distance;
         private Func<Target, Extraction> targetToExtraction;
         private Func<Extraction, Pronounceable> extractionToPronounceable;
-        private Pronounceable currentQuery;
+
+        /// <summary>
+        /// The queries being searched for, which native code refers to as indices -1, -2, ...
+        /// </summary>
+        private Pronounceable[] currentQueries;
         private bool isAccelerated;
 
         /// <summary>
@@ -63,7 +73,21 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
         /// <param name="extractionToPronounceable">A mapping of the extraction type to a type understood by the distance function. Note that this is only required if Extraction != Pronounceable</param>
         /// <param name="targetToExtraction">A mapping of the input types to the query(extraction) type. Note that Extraction == Pronounceable for the usual case.</param>
         internal AbstractFuzzyMatcher(bool isAccelerated, IList<Target> targets, DistanceFunc distance, Func<Extraction, Pronounceable> extractionToPronounceable, Func<Target, Extraction> targetToExtraction = null)
-            : base(isAccelerated, targets, distance, extractionToPronounceable, targetToExtraction)
+            : this(null, isAccelerated, targets, distance, extractionToPronounceable, targetToExtraction)
+        {
+        }
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="AbstractFuzzyMatcher{Target,Extraction,Pronounceable}"/> class, optionally from a snapshot.
+        /// </summary>
+        /// <param name="snapshotPath">A snapshot written by <see cref="Save(string)"/> to load instead of building the matcher, or null.</param>
+        /// <param name="isAccelerated">Whether the fuzzy matcher is accelerated or linear.</param>
+        /// <param name="targets">The set of objects that will be matched against. When loading, the targets the saved matcher was built with, followed by every target added since, in order (including removed ones).</param>
+        /// <param name="distance">The distance delegate.</param>
+        /// <param name="extractionToPronounceable">A mapping of the extraction type to a type understood by the distance function. Note that this is only required if Extraction != Pronounceable</param>
+        /// <param name="targetToExtraction">A mapping of the input types to the query(extraction) type. Note that Extraction == Pronounceable for the usual case.</param>
+        internal AbstractFuzzyMatcher(string snapshotPath, bool isAccelerated, IList<Target> targets, DistanceFunc distance, Func<Extraction, Pronounceable> extractionToPronounceable, Func<Target, Extraction> targetToExtraction = null)
+            : base(isAccelerated, targets, distance, extractionToPronounceable, targetToExtraction, snapshotPath)
         {
         }
 
@@ -76,16 +100,194 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
         public delegate double DistanceFunc(Pronounceable first, Pronounceable second);
 
         /// <summary>
-        /// Gets the size of the matcher. The number of targets constructed with.
+        /// A native search for the current query.
+        /// </summary>
+        /// <param name="count">maximum number of elements to retrieve</param>
+        /// <param name="nearestIdxs">array in which result elements are stored</param>
+        /// <param name="distances">array in which result distances are stored</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        private delegate NativeResult NativeFind(int count, int[] nearestIdxs, double[] distances, StringBuilder buffer, ref int bufferSize);
+
+        /// <summary>
+        /// Gets the size of the matcher. The number of targets.
         /// </summary>
         public int Count
         {
             get
             {
-                return this.targets.Count;
+                return this.targets.Count - this.removed.Count;
             }
         }
 
+        /// <summary>
+        /// Add a target, without rebuilding the whole matcher.
+        /// </summary>
+        /// <param name="target">The target to add.</param>
+        public void Add(Target target)
+        {
+            if (target == null)
+            {
+                throw new ArgumentNullException("target can't be null");
+            }
+
+            // The native matcher compares the new target through its index, so the managed lists grow first.
+            int idx = this.targets.Count;
+            this.targets.Add(target);
+            if (!object.ReferenceEquals(this.extractions, this.targets))
+            {
+                this.extractions.Add(this.targetToExtraction == null ? (Extraction)(object)target : default(Extraction));
+            }
+
+            if (!object.ReferenceEquals(this.pronounceables, this.extractions))
+            {
+                this.pronounceables.Add(default(Pronounceable));
+            }
+
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = this.NativeInsert(this.Native, idx, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+        }
+
+        /// <summary>
+        /// Remove a target. It is looked up by distance, so the distance from its pronounceable to itself must be 0.
+        /// </summary>
+        /// <param name="target">The target to remove.</param>
+        /// <returns>true iff the target was found and removed.</returns>
+        public bool Remove(Target target)
+        {
+            var comparer = EqualityComparer<Target>.Default;
+            for (int idx = 0; idx < this.targets.Count; ++idx)
+            {
+                if (this.removed.Contains(idx) || !comparer.Equals(this.targets[idx], target))
+                {
+                    continue;
+                }
+
+                int count = 0;
+                NativeResourceWrapper.CallNative((buffer) =>
+                {
+                    int bufferSize = NativeResourceWrapper.BufferSize;
+                    var result = this.NativeErase(this.Native, idx, out count, buffer, ref bufferSize);
+                    NativeResourceWrapper.BufferSize = bufferSize;
+                    return result;
+                });
+
+                if (count > 0)
+                {
+                    this.removed.Add(idx);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Save the matcher's index to a snapshot file, to load it later without building it again.
+        /// Loading skips the distance computations of a build, but still reads the whole index into memory.
+        /// </summary>
+        /// <param name="path">The snapshot file.</param>
+        public void Save(string path)
+        {
+            if (path == null)
+            {
+                throw new ArgumentNullException("path can't be null");
+            }
+
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = this.NativeSave(this.Native, path, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+        }
+
+        /// <summary>
+        /// Get the counts of every search since construction or the last call to ResetSearchStats.
+        /// </summary>
+        /// <returns>What the searches did, all 0 unless the native library was built with MALUUBA_SEARCH_STATS=1.</returns>
+        public SearchStats GetSearchStats()
+        {
+            bool enabled = false;
+            long[] counts = new long[5];
+            double[] milliseconds = new double[2];
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = this.NativeSearchStats(this.Native, out enabled, counts, milliseconds, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+
+            return new SearchStats
+            {
+                IsEnabled = enabled,
+                Searches = counts[0],
+                Evaluations = counts[1],
+                NodesVisited = counts[2],
+                SubtreesPruned = counts[3],
+                StackHighWater = counts[4],
+                MetricTime = TimeSpan.FromTicks((long)(milliseconds[0] * TimeSpan.TicksPerMillisecond)),
+                TraversalTime = TimeSpan.FromTicks((long)(milliseconds[1] * TimeSpan.TicksPerMillisecond)),
+            };
+        }
+
+        /// <summary>
+        /// Zero the counts returned by GetSearchStats.
+        /// </summary>
+        public void ResetSearchStats()
+        {
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = this.NativeResetSearchStats(this.Native, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+        }
+
+        /// <summary>
+        /// Measure the shape of an accelerated matcher's index.
+        /// </summary>
+        /// <returns>The shape of the index, or null if the matcher isn't accelerated.</returns>
+        public TreeShape GetTreeShape()
+        {
+            if (!this.isAccelerated)
+            {
+                return null;
+            }
+
+            long[] counts = new long[4];
+            double[] values = new double[5];
+            NativeResourceWrapper.CallNative((buffer) =>
+            {
+                int bufferSize = NativeResourceWrapper.BufferSize;
+                var result = FuzzyMatcherBase.AcceleratedFuzzyMatcher_TreeShape(this.Native, counts, values, buffer, ref bufferSize);
+                NativeResourceWrapper.BufferSize = bufferSize;
+                return result;
+            });
+
+            return new TreeShape
+            {
+                Trees = counts[0],
+                Nodes = counts[1],
+                Leaves = counts[2],
+                MaxDepth = counts[3],
+                MeanDepth = values[0],
+                TiedSplits = values[1],
+                MinRadius = values[2],
+                MedianRadius = values[3],
+                MaxRadius = values[4],
+            };
+        }
+
         /// <summary>
         /// Find the nearest element.
         /// </summary>
@@ -143,49 +345,92 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
         /// <returns>The __k__ nearest matches to target within limit</returns>
         public IList<Match<Target>> FindNearestWithin(Extraction query, double limit, int count)
         {
-            if (query == null)
+            return this.FindNearestWithin(query, count, (int capacity, int[] nearestIdxs, double[] distances, StringBuilder buffer, ref int bufferSize) =>
+                this.NativeFindNearestWithin(this.Native, capacity, limit, nearestIdxs, distances, buffer, ref bufferSize));
+        }
+
+        /// <summary>
+        /// Find the __k__ nearest elements, giving up some accuracy to stay within the limits of options.
+        /// </summary>
+        /// <param name="query">The search target.</param>
+        /// <param name="limit">The maximum distance to a match.</param>
+        /// <param name="count">The maximum number of result to return.</param>
+        /// <param name="options">The limits on the search.</param>
+        /// <param name="isExact">Whether the matches are guaranteed to be the same as an unlimited search's.</param>
+        /// <returns>The nearest matches found to target within limit.</returns>
+        public IList<Match<Target>> FindNearestWithin(Extraction query, double limit, int count, SearchOptions options, out bool isExact)
+        {
+            if (options == null)
             {
-                throw new ArgumentNullException("query can't be null");
+                throw new ArgumentNullException("options can't be null");
+            }
+
+            double timeoutMilliseconds = options.Timeout.HasValue ? options.Timeout.Value.TotalMilliseconds : -1;
+            bool exact = false;
+            var matches = this.FindNearestWithin(query, count, (int capacity, int[] nearestIdxs, double[] distances, StringBuilder buffer, ref int bufferSize) =>
+                this.NativeFindNearestWithinApproximate(this.Native, capacity, limit, options.MaxEvaluations, timeoutMilliseconds, options.Epsilon, out exact, nearestIdxs, distances, buffer, ref bufferSize));
+            isExact = exact;
+            return matches;
+        }
+
+        /// <summary>
+        /// Find the __k__ nearest elements to each of many queries in one native call. The distance function is called from several threads at once, so it must be thread-safe.
+        /// Every target is converted with the conversion delegates on the calling thread first, so the delegates themselves are never called concurrently.
+        /// </summary>
+        /// <param name="queries">The search targets.</param>
+        /// <param name="limit">The maximum distance to a match.</param>
+        /// <param name="count">The maximum number of result to return per query.</param>
+        /// <returns>The __k__ nearest matches to each query within limit, in the same order as queries.</returns>
+        public IList<IList<Match<Target>>> FindNearestWithinBatch(IList<Extraction> queries, double limit, int count)
+        {
+            if (queries == null || queries.Any(query => query == null))
+            {
+                throw new ArgumentNullException("queries can't be null");
             }
 
-            this.SetCurrentQuery(query);
+            this.currentQueries = queries.Select(this.ToPronounceable).ToArray();
+
+            // the native threads only read the pronounceables, so none may be left for them to initialize
+            this.InitializeAllPronounceables();
 
             // the number of targets is the maximum count
             count = Math.Max(Math.Min(count, this.Count), 1);
 
-            int[] nearestIdxs = new int[count];
-            for (int idx = 0; idx < count; ++idx)
+            int[] nearestIdxs = new int[queries.Count * count];
+            for (int idx = 0; idx < nearestIdxs.Length; ++idx)
             {
                 nearestIdxs[idx] = -1;
             }
 
-            double[] distances = new double[count];
+            double[] distances = new double[queries.Count * count];
             NativeResourceWrapper.CallNative((buffer) =>
             {
                 int bufferSize = NativeResourceWrapper.BufferSize;
-                var result = this.NativeFindNearestWithin(this.Native, count, limit, nearestIdxs, distances, buffer, ref bufferSize);
+                var result = this.NativeFindNearestWithinBatch(this.Native, queries.Count, count, limit, nearestIdxs, distances, buffer, ref bufferSize);
                 NativeResourceWrapper.BufferSize = bufferSize;
                 return result;
             });
 
-            IList<Match<Target>> matches = new List<Match<Target>>();
-            for (int idx = 0; idx < count; ++idx)
+            IList<IList<Match<Target>>> batch = new List<IList<Match<Target>>>();
+            for (int query = 0; query < queries.Count; ++query)
             {
-                if (nearestIdxs[idx] == -1)
+                IList<Match<Target>> matches = new List<Match<Target>>();
+                for (int idx = query * count; idx < (query + 1) * count; ++idx)
                 {
-                    // no more matches
-                    break;
-                }
+                    if (nearestIdxs[idx] == -1)
+                    {
+                        // no more matches
+                        break;
+                    }
 
-                var match = new Match<Target>(
-                    this.targets[nearestIdxs[idx]],
-                    distances[idx]);
+                    matches.Add(new Match<Target>(this.targets[nearestIdxs[idx]], distances[idx]));
+                }
 
-                matches.Add(match);
+                batch.Add(matches);
             }
 
-            this.currentQuery = default(Pronounceable);
-            return matches;
+            this.currentQueries = null;
+            return batch;
         }
 
         /// <summary>
@@ -211,6 +456,159 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
             }
         }
 
+        /// <summary>
+        /// Makes the native call to FindNearestWithinApproximate method virtual so we can use normal or accelerated version.
+        /// </summary>
+        /// <param name="native">Pointer to the native FuzzyMatcher object</param>
+        /// <param name="count">maximum number of elements to retrieve</param>
+        /// <param name="limit">threshold under which we have a match using the fuzzy matcher</param>
+        /// <param name="maxEvaluations">maximum number of distances to compute, 0 for no limit</param>
+        /// <param name="timeoutMilliseconds">maximum time to search for, negative for no limit</param>
+        /// <param name="epsilon">approximation factor of the accelerated index</param>
+        /// <param name="exact">whether the result is guaranteed to be exact</param>
+        /// <param name="nearestIdxs">array in which result elements are stored</param>
+        /// <param name="distances">array in which result distances are stored</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        protected virtual NativeResult NativeFindNearestWithinApproximate(IntPtr native, int count, double limit, int maxEvaluations, double timeoutMilliseconds, double epsilon, out bool exact, int[] nearestIdxs, double[] distances, StringBuilder buffer, ref int bufferSize)
+        {
+            if (this.isAccelerated)
+            {
+                return FuzzyMatcherBase.AcceleratedFuzzyMatcher_FindNearestWithinApproximate(native, count, limit, maxEvaluations, timeoutMilliseconds, epsilon, out exact, nearestIdxs, distances, buffer, ref bufferSize);
+            }
+            else
+            {
+                return FuzzyMatcherBase.FuzzyMatcher_FindNearestWithinApproximate(native, count, limit, maxEvaluations, timeoutMilliseconds, epsilon, out exact, nearestIdxs, distances, buffer, ref bufferSize);
+            }
+        }
+
+        /// <summary>
+        /// Makes the native call to FindNearestWithinBatch method virtual so we can use normal or accelerated version.
+        /// </summary>
+        /// <param name="native">Pointer to the native FuzzyMatcher object</param>
+        /// <param name="queryCount">number of queries</param>
+        /// <param name="count">maximum number of elements to retrieve per query</param>
+        /// <param name="limit">threshold under which we have a match using the fuzzy matcher</param>
+        /// <param name="nearestIdxs">array in which result elements are stored, count per query</param>
+        /// <param name="distances">array in which result distances are stored, count per query</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        protected virtual NativeResult NativeFindNearestWithinBatch(IntPtr native, int queryCount, int count, double limit, int[] nearestIdxs, double[] distances, StringBuilder buffer, ref int bufferSize)
+        {
+            if (this.isAccelerated)
+            {
+                return FuzzyMatcherBase.AcceleratedFuzzyMatcher_FindNearestWithinBatch(native, queryCount, count, limit, nearestIdxs, distances, buffer, ref bufferSize);
+            }
+            else
+            {
+                return FuzzyMatcherBase.FuzzyMatcher_FindNearestWithinBatch(native, queryCount, count, limit, nearestIdxs, distances, buffer, ref bufferSize);
+            }
+        }
+
+        /// <summary>
+        /// Makes the native call to Insert method virtual so we can use normal or accelerated version.
+        /// </summary>
+        /// <param name="native">Pointer to the native FuzzyMatcher object</param>
+        /// <param name="target">index of the target to insert</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        protected virtual NativeResult NativeInsert(IntPtr native, int target, StringBuilder buffer, ref int bufferSize)
+        {
+            if (this.isAccelerated)
+            {
+                return FuzzyMatcherBase.AcceleratedFuzzyMatcher_Insert(native, target, buffer, ref bufferSize);
+            }
+            else
+            {
+                return FuzzyMatcherBase.FuzzyMatcher_Insert(native, target, buffer, ref bufferSize);
+            }
+        }
+
+        /// <summary>
+        /// Makes the native call to Erase method virtual so we can use normal or accelerated version.
+        /// </summary>
+        /// <param name="native">Pointer to the native FuzzyMatcher object</param>
+        /// <param name="target">index of the target to erase</param>
+        /// <param name="count">number of elements erased</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        protected virtual NativeResult NativeErase(IntPtr native, int target, out int count, StringBuilder buffer, ref int bufferSize)
+        {
+            if (this.isAccelerated)
+            {
+                return FuzzyMatcherBase.AcceleratedFuzzyMatcher_Erase(native, target, out count, buffer, ref bufferSize);
+            }
+            else
+            {
+                return FuzzyMatcherBase.FuzzyMatcher_Erase(native, target, out count, buffer, ref bufferSize);
+            }
+        }
+
+        /// <summary>
+        /// Makes the native call to Save method virtual so we can use normal or accelerated version.
+        /// </summary>
+        /// <param name="native">Pointer to the native FuzzyMatcher object</param>
+        /// <param name="path">the snapshot file</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        protected virtual NativeResult NativeSave(IntPtr native, string path, StringBuilder buffer, ref int bufferSize)
+        {
+            if (this.isAccelerated)
+            {
+                return FuzzyMatcherBase.AcceleratedFuzzyMatcher_Save(native, path, buffer, ref bufferSize);
+            }
+            else
+            {
+                return FuzzyMatcherBase.FuzzyMatcher_Save(native, path, buffer, ref bufferSize);
+            }
+        }
+
+        /// <summary>
+        /// Makes the native call to SearchStats method virtual so we can use normal or accelerated version.
+        /// </summary>
+        /// <param name="native">Pointer to the native FuzzyMatcher object</param>
+        /// <param name="enabled">whether the native library counts searches</param>
+        /// <param name="counts">array in which the searches, evaluations, nodes visited, subtrees pruned and stack high water are stored</param>
+        /// <param name="milliseconds">array in which the metric and traversal times are stored</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        protected virtual NativeResult NativeSearchStats(IntPtr native, out bool enabled, long[] counts, double[] milliseconds, StringBuilder buffer, ref int bufferSize)
+        {
+            if (this.isAccelerated)
+            {
+                return FuzzyMatcherBase.AcceleratedFuzzyMatcher_SearchStats(native, out enabled, counts, milliseconds, buffer, ref bufferSize);
+            }
+            else
+            {
+                return FuzzyMatcherBase.FuzzyMatcher_SearchStats(native, out enabled, counts, milliseconds, buffer, ref bufferSize);
+            }
+        }
+
+        /// <summary>
+        /// Makes the native call to ResetSearchStats method virtual so we can use normal or accelerated version.
+        /// </summary>
+        /// <param name="native">Pointer to the native FuzzyMatcher object</param>
+        /// <param name="buffer">buffer for error message</param>
+        /// <param name="bufferSize">size of the buffer</param>
+        /// <returns>The result of the native operation.</returns>
+        protected virtual NativeResult NativeResetSearchStats(IntPtr native, StringBuilder buffer, ref int bufferSize)
+        {
+            if (this.isAccelerated)
+            {
+                return FuzzyMatcherBase.AcceleratedFuzzyMatcher_ResetSearchStats(native, buffer, ref bufferSize);
+            }
+            else
+            {
+                return FuzzyMatcherBase.FuzzyMatcher_ResetSearchStats(native, buffer, ref bufferSize);
+            }
+        }
+
         /// <summary>
         /// Instantiate the native resource wrapped
         /// </summary>
@@ -218,7 +616,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
         /// <returns>A pointer to the native resource.</returns>
         protected override IntPtr CreateNativeResources(params object[] args)
         {
-            if (args.Length != 5)
+            if (args.Length != 6)
             {
                 throw new ArgumentException("Fuzzy matcher needs parameters to instantiate native resource.");
             }
@@ -228,6 +626,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
             var distance = args[2] as DistanceFunc;
             var extractionToPronounceable = args[3] as Func<Extraction, Pronounceable>;
             var targetToExtraction = args[4] as Func<Target, Extraction>;
+            var snapshotPath = args[5] as string;
 
             // Managed object needs to be initialized *before* creating the native fuzzy matcher.
             this.InitializeManaged(targets, distance, targetToExtraction, extractionToPronounceable);
@@ -236,28 +635,104 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
 
             IntPtr native = IntPtr.Zero;
 
+            if (snapshotPath == null)
+            {
+                NativeResourceWrapper.CallNative((buffer) =>
+                {
+                    int bufferSize = NativeResourceWrapper.BufferSize;
+                    var result = FuzzyMatcherBase.FuzzyMatcher_Create(targetsCount, this.nativeDistanceDelegate, this.isAccelerated, out native, buffer, ref bufferSize);
+                    NativeResourceWrapper.BufferSize = bufferSize;
+                    return result;
+                });
+            }
+            else
+            {
+                bool[] present = new bool[targetsCount];
+                NativeResourceWrapper.CallNative((buffer) =>
+                {
+                    int bufferSize = NativeResourceWrapper.BufferSize;
+                    var result = FuzzyMatcherBase.FuzzyMatcher_Load(snapshotPath, targetsCount, this.nativeDistanceDelegate, this.isAccelerated, present, out native, buffer, ref bufferSize);
+                    NativeResourceWrapper.BufferSize = bufferSize;
+                    return result;
+                });
+
+                // Targets missing from the snapshot were removed before it was saved.
+                for (int idx = 0; idx < targetsCount; ++idx)
+                {
+                    if (!present[idx])
+                    {
+                        this.removed.Add(idx);
+                    }
+                }
+            }
+
+            return native;
+        }
+
+        /// <summary>
+        /// Search for one query with the given native call, and collect its matches.
+        /// </summary>
+        /// <param name="query">The search target.</param>
+        /// <param name="count">The maximum number of result to return.</param>
+        /// <param name="find">The native search.</param>
+        /// <returns>The matches found.</returns>
+        private IList<Match<Target>> FindNearestWithin(Extraction query, int count, NativeFind find)
+        {
+            if (query == null)
+            {
+                throw new ArgumentNullException("query can't be null");
+            }
+
+            this.currentQueries = new Pronounceable[] { this.ToPronounceable(query) };
+
+            // the number of targets is the maximum count
+            count = Math.Max(Math.Min(count, this.Count), 1);
+
+            int[] nearestIdxs = new int[count];
+            for (int idx = 0; idx < count; ++idx)
+            {
+                nearestIdxs[idx] = -1;
+            }
+
+            double[] distances = new double[count];
             NativeResourceWrapper.CallNative((buffer) =>
             {
                 int bufferSize = NativeResourceWrapper.BufferSize;
-                var result = FuzzyMatcherBase.FuzzyMatcher_Create(targetsCount, this.nativeDistanceDelegate, this.isAccelerated, out native, buffer, ref bufferSize);
+                var result = find(count, nearestIdxs, distances, buffer, ref bufferSize);
                 NativeResourceWrapper.BufferSize = bufferSize;
                 return result;
             });
+            IList<Match<Target>> matches = new List<Match<Target>>();
+            for (int idx = 0; idx < count; ++idx)
+            {
+                if (nearestIdxs[idx] == -1)
+                {
+                    // no more matches
+                    break;
+                }
 
-            return native;
+                var match = new Match<Target>(
+                    this.targets[nearestIdxs[idx]],
+                    distances[idx]);
+
+                matches.Add(match);
+            }
+
+            this.currentQueries = null;
+            return matches;
         }
 
-        private void SetCurrentQuery(Extraction query)
+        private Pronounceable ToPronounceable(Extraction query)
         {
             if (this.extractionToPronounceable != null)
             {
-                this.currentQuery = this.extractionToPronounceable(query);
+                return this.extractionToPronounceable(query);
             }
             else
             {
                 try
                 {
-                    this.currentQuery = (Pronounceable)Convert.ChangeType(query, typeof(Pronounceable));
+                    return (Pronounceable)Convert.ChangeType(query, typeof(Pronounceable));
                 }
                 catch
                 {
@@ -268,7 +743,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
 
         private void InitializeManaged(IList<Target> targets, DistanceFunc distance, Func<Target, Extraction> targetToExtraction, Func<Extraction, Pronounceable> extractionToPronounceable)
         {
-            this.targets = targets;
+            this.targets = new List<Target>(targets);
             this.distance = distance;
             this.targetToExtraction = targetToExtraction;
             this.extractionToPronounceable = extractionToPronounceable;
@@ -278,7 +753,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
             {
                 try
                 {
-                    this.extractions = (IList<Extraction>)targets;
+                    this.extractions = this.targets as IList<Extraction> ?? this.targets.Cast<Extraction>().ToList();
                 }
                 catch
                 {
@@ -287,7 +762,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
             }
             else
             {
-                this.extractions = new Extraction[targets.Count];
+                this.extractions = new List<Extraction>(new Extraction[targets.Count]);
             }
 
             if (extractionToPronounceable == null)
@@ -296,7 +771,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
             }
             else
             {
-                this.pronounceables = new Pronounceable[targets.Count];
+                this.pronounceables = new List<Pronounceable>(new Pronounceable[targets.Count]);
             }
         }
 
@@ -318,12 +793,23 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
             }
         }
 
+        /// <summary>
+        /// Convert every target that is not yet converted, including removed ones since the native index may still compare against them.
+        /// </summary>
+        private void InitializeAllPronounceables()
+        {
+            for (int idx = 0; idx < this.targets.Count; ++idx)
+            {
+                this.GetPronounceableAt(idx);
+            }
+        }
+
         private Pronounceable GetPronounceableAt(int idx)
         {
             Pronounceable pronounceable;
-            if (idx == -1)
+            if (idx < 0)
             {
-                pronounceable = this.currentQuery;
+                pronounceable = this.currentQueries[-1 - idx];
             }
             else
             {
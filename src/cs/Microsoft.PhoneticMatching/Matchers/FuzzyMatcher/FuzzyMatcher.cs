@@ -37,5 +37,45 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher
             : base(isAccelerated, targets, distance, null, targetToExtraction)
         {
         }
+
+        private FuzzyMatcher(string snapshotPath, IList<Target> targets, DistanceFunc distance, Func<Target, Extraction> targetToExtraction, bool isAccelerated)
+            : base(snapshotPath, isAccelerated, targets, distance, null, targetToExtraction)
+        {
+        }
+
+        /// <summary>
+        /// Load a fuzzy matcher from a snapshot written by <see cref="AbstractFuzzyMatcher{Target, Extraction, Pronounceable}.Save(string)"/>, without building it again.
+        /// The snapshot is decoded into memory rather than used in place, so every loaded matcher holds its own copy of the index.
+        /// </summary>
+        /// <param name="path">The snapshot file.</param>
+        /// <param name="targets">The targets the saved matcher was built with, followed by every target added since, in order (including removed ones).</param>
+        /// <param name="distance">The distance operator the saved matcher used.</param>
+        /// <param name="targetToExtraction">The mapping the saved matcher used.</param>
+        /// <param name="isAccelerated">Whether the saved matcher was accelerated.</param>
+        /// <returns>The fuzzy matcher.</returns>
+        public static FuzzyMatcher<Target, Extraction> Load(string path, IList<Target> targets, IDistance<Extraction> distance, Func<Target, Extraction> targetToExtraction = null, bool isAccelerated = false)
+        {
+            return Load(path, targets, distance.Distance, targetToExtraction, isAccelerated);
+        }
+
+        /// <summary>
+        /// Load a fuzzy matcher from a snapshot written by <see cref="AbstractFuzzyMatcher{Target, Extraction, Pronounceable}.Save(string)"/>, without building it again.
+        /// The snapshot is decoded into memory rather than used in place, so every loaded matcher holds its own copy of the index.
+        /// </summary>
+        /// <param name="path">The snapshot file.</param>
+        /// <param name="targets">The targets the saved matcher was built with, followed by every target added since, in order (including removed ones).</param>
+        /// <param name="distance">The distance delegate the saved matcher used.</param>
+        /// <param name="targetToExtraction">The mapping the saved matcher used.</param>
+        /// <param name="isAccelerated">Whether the saved matcher was accelerated.</param>
+        /// <returns>The fuzzy matcher.</returns>
+        public static FuzzyMatcher<Target, Extraction> Load(string path, IList<Target> targets, DistanceFunc distance, Func<Target, Extraction> targetToExtraction = null, bool isAccelerated = false)
+        {
+            if (path == null)
+            {
+                throw new ArgumentNullException("path can't be null");
+            }
+
+            return new FuzzyMatcher<Target, Extraction>(path, targets, distance, targetToExtraction, isAccelerated);
+        }
     }
 }
@@ -37,6 +37,54 @@ namespace Microsoft.PhoneticMatching.Matchers
         [DllImport("maluubaspeech-csharp.dll")]
         protected static extern NativeResult AcceleratedFuzzyMatcher_FindNearestWithin(IntPtr native, int count, double limit, [In, Out] int[] nearestIdx, [In, Out] double[] distances, StringBuilder buffer, ref int bufferSize);
 
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_FindNearestWithinApproximate(IntPtr native, int count, double limit, int maxEvaluations, double timeoutMilliseconds, double epsilon, [MarshalAs(UnmanagedType.I1)] out bool exact, [In, Out] int[] nearestIdx, [In, Out] double[] distances, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_FindNearestWithinApproximate(IntPtr native, int count, double limit, int maxEvaluations, double timeoutMilliseconds, double epsilon, [MarshalAs(UnmanagedType.I1)] out bool exact, [In, Out] int[] nearestIdx, [In, Out] double[] distances, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_FindNearestWithinBatch(IntPtr native, int queryCount, int count, double limit, [In, Out] int[] nearestIdx, [In, Out] double[] distances, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_FindNearestWithinBatch(IntPtr native, int queryCount, int count, double limit, [In, Out] int[] nearestIdx, [In, Out] double[] distances, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_Insert(IntPtr native, int target, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_Insert(IntPtr native, int target, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_Erase(IntPtr native, int target, out int count, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_Erase(IntPtr native, int target, out int count, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_Save(IntPtr native, string path, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_Save(IntPtr native, string path, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_SearchStats(IntPtr native, [MarshalAs(UnmanagedType.I1)] out bool enabled, [In, Out] long[] counts, [In, Out] double[] milliseconds, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_SearchStats(IntPtr native, [MarshalAs(UnmanagedType.I1)] out bool enabled, [In, Out] long[] counts, [In, Out] double[] milliseconds, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_ResetSearchStats(IntPtr native, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_ResetSearchStats(IntPtr native, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult AcceleratedFuzzyMatcher_TreeShape(IntPtr native, [In, Out] long[] counts, [In, Out] double[] values, StringBuilder buffer, ref int bufferSize);
+
+        [DllImport("maluubaspeech-csharp.dll")]
+        protected static extern NativeResult FuzzyMatcher_Load(string path, int count, DistanceDelegate distance, bool isAccelerated, [In, Out, MarshalAs(UnmanagedType.LPArray, ArraySubType = UnmanagedType.I1)] bool[] present, out IntPtr fuzzyMatcher, StringBuilder errorMsg, ref int bufferSize);
+
         /// <summary>
         /// Delete the native pointer using the type specified in native bindings.
         /// </summary>
@@ -5,6 +5,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher.Normalized
 {
     using System;
     using System.Collections.Generic;
+    using System.Linq;
     using PhoneticMatching.Distance;
 
     /// <summary>
@@ -29,7 +30,7 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher.Normalized
         {
             this.phoneticWeightPercentage = phoneticWeightPercentage;
 
-            Func<Target, DistanceInput> targetToExtraction = (target) =>
+            Func<Target, string> targetToPhrase = (target) =>
             {
                 string phrase = targetToExtractionPhrase == null ? target as string : targetToExtractionPhrase(target);
                 if (phrase == null)
@@ -37,7 +38,23 @@ namespace Microsoft.PhoneticMatching.Matchers.FuzzyMatcher.Normalized
                     throw new InvalidCastException($"Can't cast Target type [{typeof(Target)}] to Extraction type [string]. You must provide a conversion function 'targetToExtractionPhrase'.");
                 }
 
-                return new DistanceInput(phrase, this.pronouncer.Pronounce(phrase));
+                return phrase;
+            };
+
+            // Pronounce the targets in bulk, in parallel, rather than one by one as the matcher reaches them.
+            var phrases = targets.Select(targetToPhrase).Distinct().ToList();
+            var pronunciations = phrases.Zip(this.pronouncer.PronounceAll(phrases), (phrase, pronunciation) => new { phrase, pronunciation }).ToDictionary(pair => pair.phrase, pair => pair.pronunciation);
+
+            Func<Target, DistanceInput> targetToExtraction = (target) =>
+            {
+                string phrase = targetToPhrase(target);
+                EnPronunciation pronunciation;
+                if (!pronunciations.TryGetValue(phrase, out pronunciation))
+                {
+                    pronunciation = this.pronouncer.Pronounce(phrase);
+                }
+
+                return new DistanceInput(phrase, pronunciation);
             };
             this.GenericFuzzyMatcher = new FuzzyMatcher<Target, DistanceInput>(targets, new EnHybridDistance(phoneticWeightPercentage), targetToExtraction, isAccelerated);
         }
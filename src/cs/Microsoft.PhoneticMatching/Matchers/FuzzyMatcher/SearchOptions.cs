@@ -0,0 +1,28 @@
+﻿// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+namespace Microsoft.PhoneticMatching.Matchers
+{
+    using System;
+
+    /// <summary>
+    /// Limits that trade the accuracy of a fuzzy matcher search for its speed. A search that reaches one returns the best matches found so far.
+    /// </summary>
+    public class SearchOptions
+    {
+        /// <summary>
+        /// Gets or sets the most distances to compute. 0 for no limit.
+        /// </summary>
+        public int MaxEvaluations { get; set; }
+
+        /// <summary>
+        /// Gets or sets the most time to search for, or null for no limit.
+        /// </summary>
+        public TimeSpan? Timeout { get; set; }
+
+        /// <summary>
+        /// Gets or sets the approximation factor of an accelerated matcher. Parts of its index that can't hold a match closer than the current __k__th match divided by 1 + Epsilon are skipped.
+        /// </summary>
+        public double Epsilon { get; set; }
+    }
+}
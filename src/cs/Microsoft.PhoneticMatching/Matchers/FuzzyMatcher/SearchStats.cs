@@ -0,0 +1,53 @@
+﻿// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+namespace Microsoft.PhoneticMatching.Matchers
+{
+    using System;
+
+    /// <summary>
+    /// What a fuzzy matcher's searches have done. Only counted when the native library is built with MALUUBA_SEARCH_STATS=1, otherwise every count is 0.
+    /// </summary>
+    public class SearchStats
+    {
+        /// <summary>
+        /// Gets a value indicating whether the native library counts searches at all.
+        /// </summary>
+        public bool IsEnabled { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of searches.
+        /// </summary>
+        public long Searches { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of distances computed.
+        /// </summary>
+        public long Evaluations { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of subtrees, or targets of an unaccelerated matcher, expanded.
+        /// </summary>
+        public long NodesVisited { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of subtrees, or targets of an unaccelerated matcher, skipped by their bounds.
+        /// </summary>
+        public long SubtreesPruned { get; internal set; }
+
+        /// <summary>
+        /// Gets the most pending subtrees any one search held at once.
+        /// </summary>
+        public long StackHighWater { get; internal set; }
+
+        /// <summary>
+        /// Gets the time spent computing distances.
+        /// </summary>
+        public TimeSpan MetricTime { get; internal set; }
+
+        /// <summary>
+        /// Gets the rest of the time spent searching.
+        /// </summary>
+        public TimeSpan TraversalTime { get; internal set; }
+    }
+}
@@ -0,0 +1,56 @@
+﻿// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+namespace Microsoft.PhoneticMatching.Matchers
+{
+    /// <summary>
+    /// The shape of an accelerated fuzzy matcher's vantage point tree.
+    /// </summary>
+    public class TreeShape
+    {
+        /// <summary>
+        /// Gets the number of static trees the index is split into.
+        /// </summary>
+        public long Trees { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of targets in the index, including removed ones that still guide searches.
+        /// </summary>
+        public long Nodes { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of leaf buckets.
+        /// </summary>
+        public long Leaves { get; internal set; }
+
+        /// <summary>
+        /// Gets the depth of the deepest leaf bucket.
+        /// </summary>
+        public long MaxDepth { get; internal set; }
+
+        /// <summary>
+        /// Gets the mean depth of the targets.
+        /// </summary>
+        public double MeanDepth { get; internal set; }
+
+        /// <summary>
+        /// Gets the fraction of splits whose halves share a boundary distance, so neither can be pruned for some queries.
+        /// </summary>
+        public double TiedSplits { get; internal set; }
+
+        /// <summary>
+        /// Gets the smallest distance from a vantage point to the outside half of its subtree.
+        /// </summary>
+        public double MinRadius { get; internal set; }
+
+        /// <summary>
+        /// Gets the median distance from a vantage point to the outside half of its subtree.
+        /// </summary>
+        public double MedianRadius { get; internal set; }
+
+        /// <summary>
+        /// Gets the largest distance from a vantage point to the outside half of its subtree.
+        /// </summary>
+        public double MaxRadius { get; internal set; }
+    }
+}
@@ -0,0 +1,41 @@
+﻿// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+namespace Microsoft.PhoneticMatching
+{
+    /// <summary>
+    /// What the pronunciation cache shared by every <see cref="EnPronouncer"/> has done and holds.
+    /// </summary>
+    public class PronunciationCacheStats
+    {
+        /// <summary>
+        /// Gets the number of pronunciations found in the cache.
+        /// </summary>
+        public long Hits { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of pronunciations not found in the cache.
+        /// </summary>
+        public long Misses { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of pronunciations evicted to stay within the budget.
+        /// </summary>
+        public long Evictions { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of pronunciations held.
+        /// </summary>
+        public long Entries { get; internal set; }
+
+        /// <summary>
+        /// Gets the estimated memory held by the cache, in bytes.
+        /// </summary>
+        public long Bytes { get; internal set; }
+
+        /// <summary>
+        /// Gets the memory budget of the cache, in bytes.
+        /// </summary>
+        public long Budget { get; internal set; }
+    }
+}
@@ -4,6 +4,8 @@
 namespace PhoneticMatchingTests
 {
     using System;
+    using System.Linq;
+    using System.Threading.Tasks;
     using Microsoft.PhoneticMatching;
     using Microsoft.VisualStudio.TestTools.UnitTesting;
 
@@ -19,6 +21,80 @@ namespace PhoneticMatchingTests
             Assert.AreEqual("ðɪsɪzətɛst", pronunciation.Ipa);
         }
 
+        [TestMethod]
+        public void GivenPhrases_ExpectPronounceAllInOrder()
+        {
+            var phrases = new string[] { "This, is a test.", "Main Street", "This, is a test.", "Main Street" };
+            var pronunciations = this.pronouncer.PronounceAll(phrases);
+
+            Assert.AreEqual(phrases.Length, pronunciations.Count);
+            for (int i = 0; i < phrases.Length; ++i)
+            {
+                Assert.AreEqual(this.pronouncer.Pronounce(phrases[i]).Ipa, pronunciations[i].Ipa);
+            }
+
+            Assert.AreEqual(0, this.pronouncer.PronounceAll(new string[0]).Count);
+        }
+
+        [TestMethod]
+        public void GivenCacheBudget_ExpectRepeatedTextsToHit()
+        {
+            EnPronouncer.ClearCache();
+            EnPronouncer.SetCacheBudget(1 << 20);
+            try
+            {
+                var before = EnPronouncer.GetCacheStats();
+                var first = this.pronouncer.Pronounce("This, is a test.");
+                var second = this.pronouncer.Pronounce("This, is a test.");
+                var after = EnPronouncer.GetCacheStats();
+
+                Assert.AreEqual(first.Ipa, second.Ipa);
+                Assert.AreEqual(1, after.Misses - before.Misses);
+                Assert.AreEqual(1, after.Hits - before.Hits);
+                Assert.AreEqual(1, after.Entries);
+                Assert.IsTrue(after.Bytes > 0);
+                Assert.AreEqual(1 << 20, after.Budget);
+            }
+            finally
+            {
+                EnPronouncer.SetCacheBudget(0);
+            }
+
+            Assert.AreEqual(0, EnPronouncer.GetCacheStats().Entries);
+        }
+
+        [TestMethod]
+        public void GivenNegativeCacheBudget_ExpectException()
+        {
+            Assert.ThrowsException<ArgumentException>(() =>
+            {
+                EnPronouncer.SetCacheBudget(-1);
+            });
+        }
+
+        [TestMethod]
+        public void GivenConcurrentCallers_ExpectSamePronunciations()
+        {
+            var phrases = Enumerable.Range(0, 100).Select(i => string.Format("Call {0} at {1} Main Street.", i, 17 * i)).ToArray();
+            var expected = phrases.Select(phrase => this.pronouncer.Pronounce(phrase).Ipa).ToArray();
+
+            var actual = new string[16, phrases.Length];
+            Parallel.For(0, 16 * phrases.Length, new ParallelOptions { MaxDegreeOfParallelism = 16 }, i =>
+            {
+                var caller = i / phrases.Length;
+                var phrase = (i + caller) % phrases.Length;
+                actual[caller, phrase] = this.pronouncer.Pronounce(phrases[phrase]).Ipa;
+            });
+
+            for (int caller = 0; caller < 16; ++caller)
+            {
+                for (int phrase = 0; phrase < phrases.Length; ++phrase)
+                {
+                    Assert.AreEqual(expected[phrase], actual[caller, phrase]);
+                }
+            }
+        }
+
         [TestMethod]
         public void GivenNullArgument_ExpectException()
         {
@@ -26,6 +102,11 @@ namespace PhoneticMatchingTests
             {
                 var pronunciation = this.pronouncer.Pronounce(null);
             });
+
+            Assert.ThrowsException<ArgumentNullException>(() =>
+            {
+                var pronunciations = this.pronouncer.PronounceAll(new string[] { "Main Street", null });
+            });
         }
     }
 }
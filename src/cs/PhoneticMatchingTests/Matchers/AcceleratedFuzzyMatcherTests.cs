@@ -76,6 +76,41 @@ namespace PhoneticMatchingTests.Matchers
             BaseFuzzyMatcherTester.GivenZeroThresholdAndExactTarget_ExpectPositiveMatch(matcher);
         }
 
+        [TestMethod]
+        public void GivenAddedAndRemovedTargets_ExpectMatchesToFollow()
+        {
+            var matcher = new AcceleratedFuzzyMatcher<string, string>(this.TargetStrings, this.StringDistance);
+            BaseFuzzyMatcherTester.GivenAddedAndRemovedTargets_ExpectMatchesToFollow(matcher);
+        }
+
+        [TestMethod]
+        public void GivenBatchOfQueries_ExpectSameMatchesAsSingleQueries()
+        {
+            var matcher = new AcceleratedFuzzyMatcher<string, string>(this.TargetStrings, this.StringDistance);
+            BaseFuzzyMatcherTester.GivenBatchOfQueries_ExpectSameMatchesAsSingleQueries(matcher);
+        }
+
+        [TestMethod]
+        public void GivenSearchLimits_ExpectApproximateMatches()
+        {
+            var matcher = new AcceleratedFuzzyMatcher<string, string>(this.TargetStrings, this.StringDistance);
+            BaseFuzzyMatcherTester.GivenSearchLimits_ExpectApproximateMatches(matcher);
+        }
+
+        [TestMethod]
+        public void GivenSearchStats_ExpectCountsToFollowSearches()
+        {
+            var matcher = new AcceleratedFuzzyMatcher<string, string>(this.TargetStrings, this.StringDistance);
+            BaseFuzzyMatcherTester.GivenSearchStats_ExpectCountsToFollowSearches(matcher, true);
+        }
+
+        [TestMethod]
+        public void GivenSavedMatcher_ExpectLoadedMatchesToFollow()
+        {
+            var matcher = new AcceleratedFuzzyMatcher<string, string>(this.TargetStrings, this.StringDistance);
+            BaseFuzzyMatcherTester.GivenSavedMatcher_ExpectLoadedMatchesToFollow(this.TargetStrings, matcher, (path, targets) => FuzzyMatcher<string, string>.Load(path, targets, this.StringDistance, isAccelerated: true));
+        }
+
         [TestMethod]
         public void GivenZeroThresholdAndWrongTarget_ExpectNull()
         {
@@ -4,11 +4,14 @@
 namespace PhoneticMatchingTests.Matchers
 {
     using System;
+    using System.Collections.Generic;
+    using System.IO;
     using System.Linq;
     using Microsoft.VisualStudio.TestTools.UnitTesting;
     using Microsoft.PhoneticMatching;
     using Microsoft.PhoneticMatching.Distance;
     using Microsoft.PhoneticMatching.Matchers;
+    using Microsoft.PhoneticMatching.Matchers.FuzzyMatcher;
 
     public class BaseFuzzyMatcherTester : BaseContactMatcherTester
     {
@@ -90,6 +93,113 @@ namespace PhoneticMatchingTests.Matchers
             Assert.IsNull(match);
         }
 
+        protected static void GivenAddedAndRemovedTargets_ExpectMatchesToFollow<T>(T matcher) where T : AbstractFuzzyMatcher<string, string, string>
+        {
+            var count = matcher.Count;
+            matcher.Add("Jon Bee");
+            Assert.AreEqual(count + 1, matcher.Count);
+            Assert.AreEqual("Jon Bee", matcher.FindNearest("jon bee").Element);
+
+            Assert.IsTrue(matcher.Remove("Jon Bee"));
+            Assert.IsFalse(matcher.Remove("Jon Bee"));
+            Assert.AreEqual(count, matcher.Count);
+            Assert.AreNotEqual("Jon Bee", matcher.FindNearest("jon bee").Element);
+
+            Assert.IsTrue(matcher.Remove("John B"));
+            Assert.AreEqual("John C", matcher.FindNearest("John B").Element);
+        }
+
+        protected static void GivenBatchOfQueries_ExpectSameMatchesAsSingleQueries<T>(T matcher) where T : AbstractFuzzyMatcher<string, string, string>
+        {
+            var queries = new[] { "andrew smith", "jon", "jenny", "andru" };
+            var batch = matcher.FindNearestWithinBatch(queries, 0.5, 2);
+            Assert.AreEqual(queries.Length, batch.Count);
+            for (int idx = 0; idx < queries.Length; ++idx)
+            {
+                var expected = matcher.FindNearestWithin(queries[idx], 0.5, 2);
+                CollectionAssert.AreEqual(expected.Select(match => match.Element).ToList(), batch[idx].Select(match => match.Element).ToList());
+                CollectionAssert.AreEqual(expected.Select(match => match.Distance).ToList(), batch[idx].Select(match => match.Distance).ToList());
+            }
+
+            Assert.AreEqual(0, matcher.FindNearestWithinBatch(new string[0], 0.5, 2).Count);
+        }
+
+        protected static void GivenSearchLimits_ExpectApproximateMatches<T>(T matcher) where T : AbstractFuzzyMatcher<string, string, string>
+        {
+            foreach (var query in new[] { "andrew smith", "jon", "jenny" })
+            {
+                bool isExact;
+                var expected = matcher.FindNearestWithin(query, 0.5, 2);
+                var unlimited = matcher.FindNearestWithin(query, 0.5, 2, new SearchOptions(), out isExact);
+                Assert.IsTrue(isExact);
+                CollectionAssert.AreEqual(expected.Select(match => match.Distance).ToList(), unlimited.Select(match => match.Distance).ToList());
+
+                var limited = matcher.FindNearestWithin(query, 0.5, 2, new SearchOptions() { MaxEvaluations = 1 }, out isExact);
+                Assert.IsFalse(isExact);
+                Assert.IsTrue(limited.Count <= 1);
+            }
+        }
+
+        protected static void GivenSearchStats_ExpectCountsToFollowSearches<T>(T matcher, bool isAccelerated) where T : AbstractFuzzyMatcher<string, string, string>
+        {
+            matcher.ResetSearchStats();
+            matcher.FindNearestWithin("andrew smith", 0.5, 2);
+            matcher.FindNearest("jon");
+
+            var stats = matcher.GetSearchStats();
+            if (stats.IsEnabled)
+            {
+                Assert.AreEqual(2, stats.Searches);
+                Assert.IsTrue(stats.Evaluations > 0);
+                Assert.IsTrue(stats.NodesVisited > 0);
+            }
+            else
+            {
+                Assert.AreEqual(0, stats.Searches);
+                Assert.AreEqual(0, stats.Evaluations);
+            }
+
+            matcher.ResetSearchStats();
+            Assert.AreEqual(0, matcher.GetSearchStats().Searches);
+
+            var shape = matcher.GetTreeShape();
+            if (isAccelerated)
+            {
+                Assert.AreEqual(matcher.Count, shape.Nodes);
+                Assert.IsTrue(shape.Leaves > 0);
+            }
+            else
+            {
+                Assert.IsNull(shape);
+            }
+        }
+
+        protected static void GivenSavedMatcher_ExpectLoadedMatchesToFollow<T>(IList<string> targets, T matcher, Func<string, IList<string>, AbstractFuzzyMatcher<string, string, string>> load) where T : AbstractFuzzyMatcher<string, string, string>
+        {
+            matcher.Add("Jon Bee");
+            Assert.IsTrue(matcher.Remove("John B"));
+
+            var path = Path.GetTempFileName();
+            try
+            {
+                matcher.Save(path);
+                var loaded = load(path, targets.Concat(new[] { "Jon Bee" }).ToList());
+                Assert.AreEqual(matcher.Count, loaded.Count);
+                foreach (var query in new[] { "jon bee", "John B", "andrew smith", "jenny" })
+                {
+                    var expected = matcher.FindNearest(query, 3);
+                    var actual = loaded.FindNearest(query, 3);
+                    CollectionAssert.AreEqual(expected.Select(match => match.Distance).ToList(), actual.Select(match => match.Distance).ToList());
+                }
+
+                Assert.IsFalse(loaded.Remove("John B"));
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+        }
+
         protected static void GivenContactFuzzyMatcher_ExpectPositiveMatch<T>(T matcher) where T : IFuzzyMatcher<TestContact, TestContact>
         {
             var match = matcher.FindNearest(FullnameToTestContact("andrew smith"));
@@ -0,0 +1,802 @@
+/**
+ * @file
+ * Burkhard-Keller trees, for metrics with small integer distances.
+ *
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ */
+
+#ifndef MALUUBA_BKTREE_HPP
+#define MALUUBA_BKTREE_HPP
+
+#include "maluuba/debug.hpp"
+#include "maluuba/metric.hpp"
+#include "maluuba/searchstats.hpp"
+#include "maluuba/snapshot.hpp"
+#include "maluuba/vptree.hpp"
+#include "maluuba/xtd/optional.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace maluuba
+{
+  /**
+   * A BK-tree.  Each node's children are keyed by their exact distance to it,
+   * so the metric must only return non-negative integers, like unit-cost
+   * Levenshtein distance.  Where a vantage point tree splits each subtree in
+   * two at a median that ties make uninformative, a BK-tree has a child per
+   * distance, and a search only visits the children whose key is within the
+   * search radius of the target's distance to their parent.
+   *
+   * Elements can be inserted and erased after construction.  Erased elements
+   * stay in place to guide searches until half of the tree is erased, at
+   * which point it is rebuilt.
+   *
+   * @tparam T  The type of element to store.
+   * @tparam Metric  The metric used to compare elements.
+   */
+  template <typename T, typename Metric>
+  class BkTree
+  {
+  public:
+    using value_type = T;
+    using distance_type = MetricResult<Metric, T>;
+    using size_type = std::size_t;
+
+  private:
+    /** Marks the absence of a node. */
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * The links of a node, stored apart from its element.
+     */
+    struct Node
+    {
+      /** The distance to the parent, which tells siblings apart. */
+      std::size_t key = 0;
+      /** The largest key of the children. */
+      std::size_t max_key = 0;
+      /** The child with the smallest key. */
+      std::size_t first_child = none;
+      /** The sibling with the next larger key. */
+      std::size_t next_sibling = none;
+      bool erased = false;
+    };
+
+  public:
+    BkTree() = default;
+
+    explicit BkTree(Metric metric)
+      : m_metric{std::move(metric)}
+    { }
+
+    template <typename Iterator>
+    explicit BkTree(Iterator first, Iterator last, Metric metric = Metric{})
+      : m_metric{std::move(metric)}
+    {
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+      relayout();
+    }
+
+    bool
+    empty() const
+    {
+      return m_size == 0;
+    }
+
+    /**
+     * @return The number of elements in the tree, not counting erased ones.
+     */
+    size_type
+    size() const
+    {
+      return m_size;
+    }
+
+    /**
+     * Insert an element into the tree.  Matches found before the insertion
+     * are invalidated.
+     *
+     * @throws std::invalid_argument  If the metric gives a distance that isn't
+     *                                a non-negative integer.
+     */
+    void
+    insert(T element)
+    {
+      if (m_nodes.empty()) {
+        m_nodes.emplace_back();
+      } else {
+        std::size_t parent = 0;
+        while (true) {
+          auto key = to_key(m_metric(m_elements[parent], element));
+          auto child = find_child(parent, key);
+          if (child == none) {
+            add_child(parent, key);
+            break;
+          }
+          parent = child;
+        }
+      }
+
+      m_elements.push_back(std::move(element));
+      ++m_size;
+    }
+
+    /**
+     * Erase the elements at distance zero from @p key for which @p pred
+     * returns @c true.  Matches found before the erasure are invalidated.
+     *
+     * @param key  The key to look up.
+     * @param pred  A predicate that picks which of the elements equivalent to
+     *              @p key to erase.
+     * @return The number of elements erased.
+     */
+    template <typename U, typename Predicate>
+    size_type
+    erase(const U& key, Predicate pred)
+    {
+      // Lookups for erasure aren't counted as searches
+      SearchStatsCounter uncounted;
+      SearchContext context;
+      std::vector<std::size_t> found;
+      visit(key, 0, [&](std::size_t i, distance_type) {
+        if (pred(m_elements[i])) {
+          found.push_back(i);
+        }
+      }, context, uncounted);
+
+      for (auto i : found) {
+        m_nodes[i].erased = true;
+      }
+      m_size -= found.size();
+      m_erased += found.size();
+
+      if (m_erased > 0 && m_erased >= m_size) {
+        rebuild();
+      }
+      return found.size();
+    }
+
+    /**
+     * Erase the elements equal to @p element, which must be at distance zero
+     * from it.
+     *
+     * @return The number of elements erased.
+     */
+    size_type
+    erase(const T& element)
+    {
+      return erase(element, [&element](const T& other) { return other == element; });
+    }
+
+    /**
+     * Save the tree's structure to a snapshot, so it can be loaded without
+     * computing any distances.
+     *
+     * @param writer  The snapshot to write to.
+     * @param write_element  Called as <code>write_element(writer, element)</code>
+     *                       for each element, including erased ones.
+     */
+    template <typename ElementWriter>
+    void
+    save(SnapshotWriter& writer, ElementWriter&& write_element) const
+    {
+      std::vector<std::size_t> parents(m_nodes.size());
+      for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        for (auto child = m_nodes[i].first_child; child != none; child = m_nodes[child].next_sibling) {
+          parents[child] = i;
+        }
+      }
+
+      writer.write_u64(m_nodes.size());
+      for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        writer.write_u64(parents[i]);
+        writer.write_u64(m_nodes[i].key);
+        writer.write_u8(m_nodes[i].erased);
+        write_element(writer, m_elements[i]);
+      }
+    }
+
+    /**
+     * Load a tree saved by @c save().
+     *
+     * @param reader  The snapshot to read from.
+     * @param read_element  Called as <code>read_element(reader)</code> to read
+     *                      each element written by @c save().
+     * @param metric  The metric, which must match the saved tree's.
+     * @throws std::runtime_error  If the snapshot is malformed.
+     */
+    template <typename ElementReader>
+    static BkTree
+    load(SnapshotReader& reader, ElementReader&& read_element, Metric metric = Metric{})
+    {
+      BkTree tree{std::move(metric)};
+
+      // Each node takes at least 17 bytes
+      constexpr std::size_t node_size = 17;
+      auto count = reader.read_count(node_size);
+      tree.m_nodes.reserve(count);
+      tree.m_elements.reserve(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        auto parent = reader.read_u64();
+        auto key = reader.read_u64();
+        if (i == 0) {
+          tree.m_nodes.emplace_back();
+        } else {
+          // Parents come first, and siblings have distinct keys
+          check(parent < i && tree.find_child(parent, key) == none, "Malformed snapshot.");
+          tree.add_child(parent, key);
+        }
+
+        auto erased = reader.read_u8() != 0;
+        tree.m_nodes.back().erased = erased;
+        tree.m_elements.push_back(read_element(reader));
+        if (erased) {
+          ++tree.m_erased;
+        } else {
+          ++tree.m_size;
+        }
+      }
+
+      return tree;
+    }
+
+    /**
+     * A near match found in the tree.
+     */
+    class Match
+    {
+    public:
+      Match() = default;
+
+      Match(const T& element, distance_type distance)
+        : m_element{&element}, m_distance{distance}
+      { }
+
+      /**
+       * @return The found element.
+       */
+      const T&
+      element() const
+      {
+        return *m_element;
+      }
+
+      /**
+       * @return The metric distance from the target to this element.
+       */
+      distance_type
+      distance() const
+      {
+        return m_distance;
+      }
+
+    private:
+      friend bool
+      operator<(const Match& lhs, const Match& rhs)
+      {
+        return lhs.distance() < rhs.distance();
+      }
+
+      const T* m_element;
+      distance_type m_distance;
+    };
+
+  private:
+    /**
+     * An entry in the search stack.
+     */
+    struct StackEntry
+    {
+      /** The node to visit. */
+      std::size_t node;
+      /** A lower bound for the distance to any element in its subtree. */
+      distance_type bound;
+    };
+
+  public:
+    /**
+     * Scratch space for searches, like @c VpTree::SearchContext.  Keep one
+     * per thread.
+     */
+    class SearchContext
+    {
+    private:
+      friend class BkTree;
+
+      std::vector<StackEntry> m_stack;
+      /** A max-heap of the matches found so far, sorted once the search ends. */
+      std::vector<Match> m_matches;
+    };
+
+    /**
+     * Find the nearest element in the tree.
+     *
+     * @param target  The search target.
+     * @param options  The limits on the search.  The traversal order doesn't
+     *                 apply to BK-trees.
+     * @param[out] exact  If not null, set to whether the match is guaranteed
+     *                    to be the closest despite the limits in @p options.
+     * @return The closest match to @p target, or @c nullopt if the tree is
+     *         empty.
+     */
+    template <typename U>
+    xtd::optional<Match>
+    find_nearest(const U& target, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      auto matches = find_k_nearest(target, 1, options, exact);
+      if (matches.empty()) {
+        return xtd::nullopt;
+      } else {
+        return matches[0];
+      }
+    }
+
+    /**
+     * Find the nearest element in the tree.
+     *
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @param options  The limits on the search.
+     * @param[out] exact  If not null, set to whether the match is guaranteed
+     *                    to be the closest despite the limits in @p options.
+     * @return The closest match to @p target within @p limit, or @c nullopt if
+     *         no match is found.
+     */
+    template <typename U>
+    xtd::optional<Match>
+    find_nearest_within(const U& target, distance_type limit, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      auto matches = find_k_nearest_within(target, 1, limit, options, exact);
+      if (matches.empty()) {
+        return xtd::nullopt;
+      } else {
+        return matches[0];
+      }
+    }
+
+    /**
+     * Find the @p k nearest elements in the tree.
+     *
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @param options  The limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The @p k nearest elements in the tree to @p target.
+     */
+    template <typename U>
+    std::vector<Match>
+    find_k_nearest(const U& target, size_type k, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      SearchContext context;
+      search(target, k, distance_type{}, false, options, exact, context);
+      return std::move(context.m_matches);
+    }
+
+    /**
+     * Find the @p k nearest elements in the tree, passing them to @p sink
+     * rather than collecting them.
+     *
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @param context  The scratch space for the search.
+     * @param sink  Called as <code>sink(element, distance)</code> for each
+     *              match, nearest first.
+     * @param options  The limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The number of matches.
+     */
+    template <typename U, typename Sink>
+    size_type
+    find_k_nearest(const U& target, size_type k, SearchContext& context, Sink&& sink, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      search(target, k, distance_type{}, false, options, exact, context);
+      return emit(context, sink);
+    }
+
+    /**
+     * Find the @p k nearest elements in the tree.
+     *
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param options  The limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The @p k nearest elements in the tree to @p target within @p limit.
+     */
+    template <typename U>
+    std::vector<Match>
+    find_k_nearest_within(const U& target, size_type k, distance_type limit, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      SearchContext context;
+      search(target, k, limit, true, options, exact, context);
+      return std::move(context.m_matches);
+    }
+
+    /**
+     * Find the @p k nearest elements in the tree, passing them to @p sink
+     * rather than collecting them.
+     *
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param context  The scratch space for the search.
+     * @param sink  Called as <code>sink(element, distance)</code> for each
+     *              match, nearest first.
+     * @param options  The limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The number of matches.
+     */
+    template <typename U, typename Sink>
+    size_type
+    find_k_nearest_within(const U& target, size_type k, distance_type limit, SearchContext& context, Sink&& sink, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      search(target, k, limit, true, options, exact, context);
+      return emit(context, sink);
+    }
+
+    /**
+     * Find every element within a distance of a target.
+     *
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @return The elements within @p limit of @p target, nearest first.
+     */
+    template <typename U>
+    std::vector<Match>
+    find_all_within(const U& target, distance_type limit) const
+    {
+      std::vector<Match> matches;
+      visit_within(target, limit, [&](const T& element, distance_type distance) {
+        matches.emplace_back(element, distance);
+      });
+      std::stable_sort(matches.begin(), matches.end());
+      return matches;
+    }
+
+    /**
+     * Call <code>visitor(element, distance)</code> for every element within
+     * a distance of a target, in no particular order, without collecting
+     * them.  The tree must not be modified until the visit returns.
+     *
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @param visitor  Called for each match.
+     */
+    template <typename U, typename Visitor>
+    void
+    visit_within(const U& target, distance_type limit, Visitor&& visitor) const
+    {
+      SearchContext context;
+      visit_within(target, limit, context, std::forward<Visitor>(visitor));
+    }
+
+    /**
+     * Like <code>visit_within(target, limit, visitor)</code>, with the
+     * scratch space in @p context.
+     */
+    template <typename U, typename Visitor>
+    void
+    visit_within(const U& target, distance_type limit, SearchContext& context, Visitor&& visitor) const
+    {
+      visit(target, limit, [&](std::size_t i, distance_type distance) {
+        visitor(m_elements[i], distance);
+      }, context, m_stats);
+    }
+
+    /**
+     * @return The counts of every search since construction or the last
+     *         @c reset_search_stats(), all zero unless built with
+     *         @c MALUUBA_SEARCH_STATS.
+     */
+    SearchStats
+    search_stats() const
+    {
+      return m_stats.stats();
+    }
+
+    /**
+     * Zero the counts returned by @c search_stats().
+     */
+    void
+    reset_search_stats()
+    {
+      m_stats.reset();
+    }
+
+  private:
+    std::vector<Node> m_nodes;
+    std::vector<T> m_elements;
+    size_type m_size = 0;
+    size_type m_erased = 0;
+    Metric m_metric;
+    mutable SearchStatsCounter m_stats;
+
+    /**
+     * @return The key for a child at @p distance from its parent.
+     * @throws std::invalid_argument  If @p distance isn't a non-negative
+     *                                integer.
+     */
+    static std::size_t
+    to_key(distance_type distance)
+    {
+      auto key = static_cast<std::size_t>(distance);
+      check<std::invalid_argument>(!(distance < distance_type{}) && static_cast<distance_type>(key) == distance,
+          "BK-trees need non-negative integer distances.");
+      return key;
+    }
+
+    /** @return The child of @p parent with the given @p key, or @c none. */
+    std::size_t
+    find_child(std::size_t parent, std::size_t key) const
+    {
+      auto child = m_nodes[parent].first_child;
+      while (child != none && m_nodes[child].key < key) {
+        child = m_nodes[child].next_sibling;
+      }
+      return child != none && m_nodes[child].key == key ? child : none;
+    }
+
+    /** Append a node, linked in among the children of @p parent in key order. */
+    void
+    add_child(std::size_t parent, std::size_t key)
+    {
+      auto index = m_nodes.size();
+      Node node;
+      node.key = key;
+
+      auto* link = &m_nodes[parent].first_child;
+      while (*link != none && m_nodes[*link].key < key) {
+        link = &m_nodes[*link].next_sibling;
+      }
+      node.next_sibling = *link;
+      *link = index;
+      m_nodes[parent].max_key = std::max(m_nodes[parent].max_key, key);
+
+      m_nodes.push_back(node);
+    }
+
+    /** Rebuild the tree from its live elements. */
+    void
+    rebuild()
+    {
+      auto nodes = std::move(m_nodes);
+      auto elements = std::move(m_elements);
+      m_nodes.clear();
+      m_elements.clear();
+      m_size = 0;
+      m_erased = 0;
+
+      for (std::size_t i = 0; i < nodes.size(); ++i) {
+        if (!nodes[i].erased) {
+          insert(std::move(elements[i]));
+        }
+      }
+      relayout();
+    }
+
+    /**
+     * Store the nodes in breadth-first order, so each node's children are
+     * adjacent in memory.  Insertion order scatters them.
+     */
+    void
+    relayout()
+    {
+      std::vector<std::size_t> order;
+      order.reserve(m_nodes.size());
+      if (!m_nodes.empty()) {
+        order.push_back(0);
+      }
+      for (std::size_t i = 0; i < order.size(); ++i) {
+        for (auto child = m_nodes[order[i]].first_child; child != none; child = m_nodes[child].next_sibling) {
+          order.push_back(child);
+        }
+      }
+
+      std::vector<std::size_t> position(m_nodes.size());
+      for (std::size_t i = 0; i < order.size(); ++i) {
+        position[order[i]] = i;
+      }
+      auto moved = [&](std::size_t i) { return i == none ? none : position[i]; };
+
+      std::vector<Node> nodes;
+      std::vector<T> elements;
+      nodes.reserve(m_nodes.size());
+      elements.reserve(m_elements.size());
+      for (auto i : order) {
+        auto node = m_nodes[i];
+        node.first_child = moved(node.first_child);
+        node.next_sibling = moved(node.next_sibling);
+        nodes.push_back(node);
+        elements.push_back(std::move(m_elements[i]));
+      }
+      m_nodes = std::move(nodes);
+      m_elements = std::move(elements);
+    }
+
+    /** @return The lower bound a child's key gives for the distance to its subtree. */
+    static distance_type
+    child_bound(const Node& child, distance_type distance)
+    {
+      auto key = static_cast<distance_type>(child.key);
+      return distance > key ? distance - key : key - distance;
+    }
+
+    /**
+     * The largest distance to @p node that can still affect a search with
+     * radius @p tau.  Beyond it, the node is not a match and every child is
+     * pruned, so a bounded metric may stop early.
+     */
+    static distance_type
+    search_limit(const Node& node, distance_type tau)
+    {
+      auto max_key = static_cast<distance_type>(node.max_key);
+      if (tau > std::numeric_limits<distance_type>::max() - max_key) {
+        return std::numeric_limits<distance_type>::max();
+      } else {
+        return tau + max_key;
+      }
+    }
+
+    /**
+     * Pass the matches of the last search with @p context to @p sink.
+     *
+     * @return The number of matches.
+     */
+    template <typename Sink>
+    static size_type
+    emit(const SearchContext& context, Sink& sink)
+    {
+      for (const auto& match : context.m_matches) {
+        sink(match.element(), match.distance());
+      }
+      return context.m_matches.size();
+    }
+
+    /**
+     * Find the @p k nearest elements, like @c VpTree::search().
+     */
+    template <typename U>
+    void
+    search(const U& target, size_type k, distance_type tau, bool limited, const VpTreeSearchOptions& options, bool* exact, SearchContext& context) const
+    {
+      SearchRecorder recorder{m_stats};
+      auto& matches = context.m_matches;
+      matches.clear();
+      auto pruning = [&] { return limited || matches.size() == k; };
+      auto add_match = [&](const T& element, distance_type distance) {
+        if (!pruning() || distance <= tau) {
+          if (matches.size() == k) {
+            std::pop_heap(matches.begin(), matches.end());
+            matches.pop_back();
+          }
+          matches.emplace_back(element, distance);
+          std::push_heap(matches.begin(), matches.end());
+          if (matches.size() == k) {
+            tau = matches.front().distance();
+          }
+        }
+      };
+
+      auto relaxation = 1.0 + options.epsilon;
+      VpTreeSearchBudget budget{options};
+      bool approximated = false;
+      auto pruned = [&](distance_type bound) {
+        if (pruning() && bound*relaxation > tau) {
+          recorder.prune();
+          approximated |= !(bound > tau);
+          return true;
+        }
+        return false;
+      };
+
+      auto& stack = context.m_stack;
+      stack.clear();
+      if (!m_nodes.empty()) {
+        stack.push_back({0, distance_type{}});
+      }
+
+      while (!stack.empty() && !budget.exhausted()) {
+        auto entry = stack.back();
+        stack.pop_back();
+        if (pruned(entry.bound)) {
+          continue;
+        }
+
+        budget.take(1);
+        recorder.visit();
+        const auto& node = m_nodes[entry.node];
+        const auto& element = m_elements[entry.node];
+        auto distance = recorder.metric(1, [&] {
+          return pruning() ? bounded_distance(m_metric, element, target, search_limit(node, tau)) : m_metric(element, target);
+        });
+        if (!node.erased) {
+          add_match(element, distance);
+        }
+
+        // Visit the children with the closest keys first
+        auto first = stack.size();
+        for (auto child = node.first_child; child != none; child = m_nodes[child].next_sibling) {
+          auto bound = child_bound(m_nodes[child], distance);
+          if (!pruned(bound)) {
+            stack.push_back({child, bound});
+          } else if (static_cast<distance_type>(m_nodes[child].key) > distance) {
+            // Later siblings have even larger keys
+            break;
+          }
+        }
+        std::sort(stack.begin() + first, stack.end(), [](const StackEntry& lhs, const StackEntry& rhs) {
+          return lhs.bound > rhs.bound;
+        });
+        recorder.stack(stack.size());
+      }
+
+      if (exact) {
+        // Exact unless something that could still hold a match was skipped
+        *exact = !approximated && std::all_of(stack.begin(), stack.end(), [&](const StackEntry& entry) {
+          return pruning() && entry.bound > tau;
+        });
+      }
+
+      std::sort_heap(matches.begin(), matches.end());
+    }
+
+    /**
+     * Call @p visitor with the index of every element that isn't erased and
+     * is within @p limit of @p target, along with its distance.
+     */
+    template <typename U, typename Visitor>
+    void
+    visit(const U& target, distance_type limit, Visitor&& visitor, SearchContext& context, SearchStatsCounter& counter) const
+    {
+      SearchRecorder recorder{counter};
+      auto& stack = context.m_stack;
+      stack.clear();
+      if (!m_nodes.empty()) {
+        stack.push_back({0, distance_type{}});
+      }
+
+      while (!stack.empty()) {
+        auto i = stack.back().node;
+        stack.pop_back();
+
+        recorder.visit();
+        const auto& node = m_nodes[i];
+        auto distance = recorder.metric(1, [&] { return bounded_distance(m_metric, m_elements[i], target, search_limit(node, limit)); });
+        if (!node.erased && distance <= limit) {
+          visitor(i, distance);
+        }
+
+        for (auto child = node.first_child; child != none; child = m_nodes[child].next_sibling) {
+          auto bound = child_bound(m_nodes[child], distance);
+          if (bound <= limit) {
+            stack.push_back({child, bound});
+          } else {
+            recorder.prune();
+            if (static_cast<distance_type>(m_nodes[child].key) > distance) {
+              break;
+            }
+          }
+        }
+        recorder.stack(stack.size());
+      }
+    }
+  };
+}
+
+#endif // MALUUBA_BKTREE_HPP
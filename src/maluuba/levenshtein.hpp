@@ -14,10 +14,13 @@
 
 #include "maluuba/metric.hpp"
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <memory>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace maluuba
 {
@@ -44,6 +47,15 @@ namespace maluuba
       return m_cost;
     }
 
+    /**
+     * @return The constant cost.
+     */
+    T
+    cost() const
+    {
+      return m_cost;
+    }
+
   private:
     T m_cost;
   };
@@ -69,6 +81,16 @@ namespace maluuba
     template <typename T, typename U>
     using ResultType = MetricResult<SubstitutionMetric, ValueType<T>, ValueType<U>>;
 
+    template <typename T>
+    using IsByte = std::integral_constant<bool, std::is_integral<ValueType<T>>::value && sizeof(ValueType<T>) == 1>;
+
+    /** Whether the unit-cost bit-parallel kernel applies to these sequences. */
+    template <typename T, typename U>
+    using IsBitParallel = std::integral_constant<bool,
+        std::is_same<SubstitutionMetric, EqualityMetric>::value
+        && std::is_same<CostFunction, ConstantCost<int>>::value
+        && IsByte<T>::value && IsByte<U>::value>;
+
   public:
     /**
      * Create a @c LevenshteinDistance.
@@ -86,13 +108,98 @@ namespace maluuba
     ResultType<T, U>
     operator()(const T& t_seq, const U& u_seq) const
     {
+      return distance<false>(t_seq, u_seq, 0);
+    }
+
+    /**
+     * Compute the distance, abandoning the computation once every entry of a
+     * row exceeds @p limit.
+     *
+     * @return The exact distance if it is at most @p limit, otherwise a lower
+     *         bound for the distance that exceeds @p limit.
+     */
+    template <typename T, typename U, typename Limit>
+    ResultType<T, U>
+    operator()(const T& t_seq, const U& u_seq, Limit limit) const
+    {
+      return distance<true>(t_seq, u_seq, limit);
+    }
+
+    /**
+     * Compute the distance from each sequence in [@p first, @p last) to
+     * @p query.  Unit-cost byte strings share a single bit-vector encoding of
+     * the query across all the targets.
+     *
+     * @return The end of the output range.
+     */
+    template <typename T, typename Iterator, typename OutputIterator>
+    OutputIterator
+    distance_many(const T& query, Iterator first, Iterator last, OutputIterator out) const
+    {
+      return batch_distance<false>(query, first, last, out, 0);
+    }
+
+    /**
+     * Like @c distance_many(query, first, last, out), but distances greater
+     * than @p limit may be reported as any lower bound that also exceeds
+     * @p limit.
+     */
+    template <typename T, typename Iterator, typename OutputIterator, typename Limit>
+    OutputIterator
+    distance_many(const T& query, Iterator first, Iterator last, OutputIterator out, Limit limit) const
+    {
+      return batch_distance<true>(query, first, last, out, limit);
+    }
+
+  private:
+    using Word = std::uint64_t;
+    static constexpr std::size_t word_bits = 64;
+
+    SubstitutionMetric m_sub_metric;
+    CostFunction m_cost;
+
+    /** @return The length difference of two sequences, a lower bound for unit-cost distance. */
+    template <typename T, typename U>
+    static int
+    length_difference(const T& t_seq, const U& u_seq)
+    {
+      return t_seq.size() > u_seq.size() ? t_seq.size() - u_seq.size() : u_seq.size() - t_seq.size();
+    }
+
+    template <bool Bounded, typename T, typename U, typename Limit>
+    ResultType<T, U>
+    distance(const T& t_seq, const U& u_seq, Limit limit) const
+    {
+      if constexpr (IsBitParallel<T, U>::value) {
+        if (m_cost.cost() == 1) {
+          if (Bounded) {
+            // The length difference is a cheap lower bound
+            auto diff = length_difference(t_seq, u_seq);
+            if (diff > limit) {
+              return diff;
+            }
+          }
+          return bit_parallel_distance(t_seq, u_seq);
+        }
+      }
+
       // Wagner-Fischer algorithm with two active rows
 
       using Number = ResultType<T, U>;
 
+      // Short sequences (the common case) keep both rows on the stack
+      constexpr std::size_t small_cols = 64;
+      Number small_rows[2][small_cols];
+      std::unique_ptr<Number[]> heap_rows;
+
       auto cols = u_seq.size() + 1;
-      auto row0 = std::make_unique<Number[]>(cols);
-      auto row1 = std::make_unique<Number[]>(cols);
+      Number* row0 = small_rows[0];
+      Number* row1 = small_rows[1];
+      if (cols > small_cols) {
+        heap_rows = std::make_unique<Number[]>(2*cols);
+        row0 = heap_rows.get();
+        row1 = row0 + cols;
+      }
 
       Number initial_cost{};
       std::size_t i = 0;
@@ -107,24 +214,193 @@ namespace maluuba
         auto t_cost = m_cost(t);
         row1[0] = row0[0] + t_cost;
 
+        auto row_min = row1[0];
         i = 1;
         for (const auto& u : u_seq) {
           auto sub_cost = row0[i - 1] + m_sub_metric(t, u);
           auto del_cost = row0[i] + t_cost;
           auto ins_cost = row1[i - 1] + m_cost(u);
           row1[i] = std::min(sub_cost, std::min(del_cost, ins_cost));
+          row_min = std::min(row_min, row1[i]);
           ++i;
         }
 
+        if (Bounded && row_min > limit) {
+          // Costs are non-negative, so no later row can do better
+          return row_min;
+        }
+
         std::swap(row0, row1);
       }
 
       return row0[cols - 1];
     }
 
-  private:
-    SubstitutionMetric m_sub_metric;
-    CostFunction m_cost;
+    template <bool Bounded, typename T, typename Iterator, typename OutputIterator, typename Limit>
+    OutputIterator
+    batch_distance(const T& query, Iterator first, Iterator last, OutputIterator out, Limit limit) const
+    {
+      using U = std::decay_t<decltype(*first)>;
+      if constexpr (IsBitParallel<U, T>::value) {
+        if (m_cost.cost() == 1 && !query.empty() && query.size() <= word_bits) {
+          Word peq[256] = {};
+          bit_parallel_encode(peq, query);
+          for (; first != last; ++first) {
+            const auto& target = *first;
+            if (Bounded) {
+              auto diff = length_difference(target, query);
+              if (diff > limit) {
+                *out++ = diff;
+                continue;
+              }
+            }
+            *out++ = bit_parallel_scan(peq, query.size(), target);
+          }
+          return out;
+        }
+      }
+
+      for (; first != last; ++first) {
+        *out++ = distance<Bounded>(*first, query, limit);
+      }
+      return out;
+    }
+
+    /**
+     * Encode a pattern of at most 64 bytes as one bit mask per byte value,
+     * with bit i set where the pattern has that value at index i.
+     */
+    template <typename T>
+    static void
+    bit_parallel_encode(Word peq[256], const T& pattern)
+    {
+      std::size_t i = 0;
+      for (auto c : pattern) {
+        peq[static_cast<unsigned char>(c)] |= Word{1} << i++;
+      }
+    }
+
+    /**
+     * Compute the unit-cost edit distance between a non-empty pattern of
+     * length @p m <= 64, encoded by @c bit_parallel_encode(), and @p text.
+     */
+    template <typename T>
+    static int
+    bit_parallel_scan(const Word peq[256], std::size_t m, const T& text)
+    {
+      // Track the score at the last real row, ignoring the unused high bits
+      auto last_bit = Word{1} << (m - 1);
+      int score = m;
+
+      Word pv = ~Word{0};
+      Word mv = 0;
+      for (auto c : text) {
+        auto eq = peq[static_cast<unsigned char>(c)];
+        auto xv = eq | mv;
+        auto xh = (((eq & pv) + pv) ^ pv) | eq;
+        auto ph = mv | ~(xh | pv);
+        auto mh = pv & xh;
+        if (ph & last_bit) {
+          ++score;
+        } else if (mh & last_bit) {
+          --score;
+        }
+        // The first row is D[0][j] = j, so every column starts with a +1
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+      }
+      return score;
+    }
+
+    /**
+     * Unit-cost edit distance between byte sequences, using Myers' bit-vector
+     * algorithm (as formulated by Hyyrö for global distance).  Each column of
+     * the DP matrix is encoded as vertical +1/-1 deltas packed into 64-bit
+     * words, one word per 64 elements of the shorter sequence.
+     */
+    template <typename T, typename U>
+    static int
+    bit_parallel_distance(const T& t_seq, const U& u_seq)
+    {
+      if (t_seq.size() < u_seq.size()) {
+        return bit_parallel_distance(u_seq, t_seq);
+      }
+
+      constexpr Word high_bit = Word{1} << (word_bits - 1);
+
+      // The shorter sequence is the "pattern", encoded by rows
+      const auto& pattern = u_seq;
+      const auto& text = t_seq;
+
+      std::size_t m = pattern.size();
+      if (m == 0) {
+        return text.size();
+      }
+
+      auto blocks = (m + word_bits - 1)/word_bits;
+      // Track the score at the last real row, ignoring the unused high bits
+      auto last_bit = Word{1} << ((m - 1)%word_bits);
+      int score = m;
+
+      if (blocks == 1) {
+        Word peq[256] = {};
+        bit_parallel_encode(peq, pattern);
+        return bit_parallel_scan(peq, m, text);
+      }
+
+      std::vector<Word> peq(256*blocks);
+      std::size_t i = 0;
+      for (auto c : pattern) {
+        peq[static_cast<unsigned char>(c)*blocks + i/word_bits] |= Word{1} << (i%word_bits);
+        ++i;
+      }
+
+      std::vector<Word> pvs(blocks, ~Word{0});
+      std::vector<Word> mvs(blocks, 0);
+      for (auto c : text) {
+        const auto* eqs = &peq[static_cast<unsigned char>(c)*blocks];
+
+        // Horizontal delta entering each block from above
+        int hin = 1;
+        for (std::size_t b = 0; b < blocks; ++b) {
+          auto eq = eqs[b];
+          auto pv = pvs[b];
+          auto mv = mvs[b];
+
+          auto xv = eq | mv;
+          if (hin < 0) {
+            eq |= 1;
+          }
+          auto xh = (((eq & pv) + pv) ^ pv) | eq;
+          auto ph = mv | ~(xh | pv);
+          auto mh = pv & xh;
+
+          auto out_bit = b + 1 == blocks ? last_bit : high_bit;
+          int hout = 0;
+          if (ph & out_bit) {
+            hout = 1;
+          } else if (mh & out_bit) {
+            hout = -1;
+          }
+
+          ph <<= 1;
+          mh <<= 1;
+          if (hin < 0) {
+            mh |= 1;
+          } else if (hin > 0) {
+            ph |= 1;
+          }
+          pvs[b] = mh | ~(xv | ph);
+          mvs[b] = ph & xv;
+
+          hin = hout;
+        }
+        score += hin;
+      }
+      return score;
+    }
   };
 }
 
@@ -0,0 +1,252 @@
+/**
+ * @file
+ * A thread-safe, memory-bounded LRU cache.
+ *
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ */
+
+#ifndef MALUUBA_LRUCACHE_HPP
+#define MALUUBA_LRUCACHE_HPP
+
+#include "maluuba/xtd/optional.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace maluuba
+{
+  /**
+   * Counts of what an @c LruCache has done and holds.
+   */
+  struct CacheStats
+  {
+    /** The number of lookups that found their key. */
+    std::size_t hits = 0;
+    /** The number of lookups that didn't. */
+    std::size_t misses = 0;
+    /** The number of entries evicted to stay within the budget. */
+    std::size_t evictions = 0;
+    /** The number of entries held. */
+    std::size_t entries = 0;
+    /** The estimated memory held by the entries, in bytes. */
+    std::size_t bytes = 0;
+  };
+
+  /**
+   * A cache that evicts its least recently used entries to keep its memory
+   * under a budget.  The keys are split between independently locked shards,
+   * each with its own share of the budget, so that threads using different
+   * keys rarely wait for each other.
+   *
+   * @tparam Key  The type of key.
+   * @tparam Value  The type of cached value, copied out of the cache on hits.
+   * @tparam Hash  The hash function for keys.
+   */
+  template <typename Key, typename Value, typename Hash = std::hash<Key>>
+  class LruCache
+  {
+  public:
+    /**
+     * Create a cache.
+     *
+     * @param budget  The memory budget in bytes, or 0 to cache nothing.
+     * @param shards  The number of shards.
+     */
+    explicit LruCache(std::size_t budget = 0, std::size_t shards = 16)
+      : m_shards{std::make_unique<Shard[]>(std::max<std::size_t>(shards, 1))},
+        m_shard_count{std::max<std::size_t>(shards, 1)},
+        m_budget{budget}
+    { }
+
+    /**
+     * @return The memory budget in bytes.
+     */
+    std::size_t
+    budget() const
+    {
+      return m_budget.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Change the memory budget, evicting entries until they fit.  A budget of
+     * 0 empties the cache and disables it.
+     */
+    void
+    set_budget(std::size_t budget)
+    {
+      m_budget = budget;
+      for (std::size_t i = 0; i < m_shard_count; ++i) {
+        auto& shard = m_shards[i];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        evict(shard, shard_budget());
+      }
+    }
+
+    /**
+     * Look up a key, marking it as recently used.
+     *
+     * @return A copy of the value cached for @p key, or @c nullopt if there
+     *         isn't one or the cache is disabled.
+     */
+    xtd::optional<Value>
+    find(const Key& key)
+    {
+      if (budget() == 0) {
+        return xtd::nullopt;
+      }
+
+      auto& shard = shard_for(key);
+      std::lock_guard<std::mutex> lock{shard.mutex};
+      auto it = shard.index.find(key);
+      if (it == shard.index.end()) {
+        ++shard.misses;
+        return xtd::nullopt;
+      }
+
+      ++shard.hits;
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+      return it->second->value;
+    }
+
+    /**
+     * Cache a value, replacing any already cached for its key, and evict the
+     * least recently used entries if they no longer fit.  Values larger than
+     * a shard's share of the budget aren't cached.
+     *
+     * @param key  The key.
+     * @param value  The value.
+     * @param cost  The heap memory owned by @p key and @p value, in bytes.  The
+     *              cache adds its own overhead per entry.
+     */
+    void
+    insert(const Key& key, Value value, std::size_t cost)
+    {
+      auto limit = shard_budget();
+      cost += entry_overhead;
+      if (cost > limit) {
+        return;
+      }
+
+      auto& shard = shard_for(key);
+      std::lock_guard<std::mutex> lock{shard.mutex};
+      auto it = shard.index.find(key);
+      if (it != shard.index.end()) {
+        shard.bytes -= it->second->cost;
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+      }
+
+      shard.entries.push_front(Entry{key, std::move(value), cost});
+      shard.index.emplace(key, shard.entries.begin());
+      shard.bytes += cost;
+      evict(shard, limit);
+    }
+
+    /**
+     * Remove every entry, keeping the counts of hits, misses and evictions.
+     */
+    void
+    clear()
+    {
+      for (std::size_t i = 0; i < m_shard_count; ++i) {
+        auto& shard = m_shards[i];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        shard.index.clear();
+        shard.entries.clear();
+        shard.bytes = 0;
+      }
+    }
+
+    /**
+     * @return The counts for every shard.
+     */
+    CacheStats
+    stats() const
+    {
+      CacheStats stats;
+      for (std::size_t i = 0; i < m_shard_count; ++i) {
+        auto& shard = m_shards[i];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.entries += shard.index.size();
+        stats.bytes += shard.bytes;
+      }
+      return stats;
+    }
+
+  private:
+    struct Entry
+    {
+      Key key;
+      Value value;
+      /** The memory charged for this entry. */
+      std::size_t cost;
+    };
+
+    using EntryList = std::list<Entry>;
+    using Index = std::unordered_map<Key, typename EntryList::iterator, Hash>;
+
+    /** The memory used by an entry besides what its key and value own. */
+    static constexpr std::size_t entry_overhead = sizeof(Entry) + sizeof(typename Index::value_type) + 5*sizeof(void*);
+
+    struct Shard
+    {
+      mutable std::mutex mutex;
+      /** The entries, most recently used first. */
+      EntryList entries;
+      Index index;
+      std::size_t bytes = 0;
+      std::size_t hits = 0;
+      std::size_t misses = 0;
+      std::size_t evictions = 0;
+    };
+
+    std::unique_ptr<Shard[]> m_shards;
+    std::size_t m_shard_count;
+    std::atomic<std::size_t> m_budget;
+
+    /** @return Each shard's share of the budget. */
+    std::size_t
+    shard_budget() const
+    {
+      return budget()/m_shard_count;
+    }
+
+    /** @return The shard that holds @p key. */
+    Shard&
+    shard_for(const Key& key) const
+    {
+      // Mix the hash so that the shards don't only see its low bits, which
+      // the index's buckets also use
+      std::uint64_t hash = Hash{}(key);
+      hash ^= hash >> 31;
+      hash *= 0x9E3779B97F4A7C15ULL;
+      return m_shards[(hash >> 32) % m_shard_count];
+    }
+
+    /** Evict the least recently used entries of @p shard until it fits in @p limit. */
+    static void
+    evict(Shard& shard, std::size_t limit)
+    {
+      while (shard.bytes > limit) {
+        auto& entry = shard.entries.back();
+        shard.bytes -= entry.cost;
+        shard.index.erase(entry.key);
+        shard.entries.pop_back();
+        ++shard.evictions;
+      }
+    }
+  };
+}
+
+#endif // MALUUBA_LRUCACHE_HPP
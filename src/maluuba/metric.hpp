@@ -22,6 +22,74 @@ namespace maluuba
   template <typename Metric, typename T = int, typename U = T>
   using MetricResult = std::result_of_t<Metric(T, U)>;
 
+  /**
+   * Detects metrics that accept a third argument limiting the distance of
+   * interest, i.e. <code>metric(t, u, limit)</code>.
+   */
+  template <typename Metric, typename T, typename U, typename Limit, typename = void>
+  struct IsBoundedMetric: std::false_type
+  { };
+
+  template <typename Metric, typename T, typename U, typename Limit>
+  struct IsBoundedMetric<Metric, T, U, Limit, std::void_t<decltype(std::declval<const Metric&>()(
+      std::declval<const T&>(), std::declval<const U&>(), std::declval<Limit>()))>>
+    : std::true_type
+  { };
+
+  /**
+   * Compute the distance between @p t and @p u, allowing the metric to give up
+   * early once the distance is known to exceed @p limit.  Metrics without a
+   * three-argument overload are evaluated in full.
+   *
+   * @return The exact distance if it is at most @p limit, otherwise a lower
+   *         bound for the distance that exceeds @p limit.
+   */
+  template <typename Metric, typename T, typename U, typename Limit>
+  MetricResult<Metric, T, U>
+  bounded_distance(const Metric& metric, const T& t, const U& u, Limit limit)
+  {
+    if constexpr (IsBoundedMetric<Metric, T, U, Limit>::value) {
+      return metric(t, u, limit);
+    } else {
+      return metric(t, u);
+    }
+  }
+
+  /**
+   * Detects metrics that can compute the distances from one query to many
+   * targets at once, i.e. <code>metric.distance_many(query, first, last, out, limit)</code>.
+   */
+  template <typename Metric, typename T, typename Iterator, typename OutputIterator, typename Limit, typename = void>
+  struct IsBatchMetric: std::false_type
+  { };
+
+  template <typename Metric, typename T, typename Iterator, typename OutputIterator, typename Limit>
+  struct IsBatchMetric<Metric, T, Iterator, OutputIterator, Limit, std::void_t<decltype(std::declval<const Metric&>().distance_many(
+      std::declval<const T&>(), std::declval<Iterator>(), std::declval<Iterator>(), std::declval<OutputIterator>(), std::declval<Limit>()))>>
+    : std::true_type
+  { };
+
+  /**
+   * Compute the distance from each element of [@p first, @p last) to @p query,
+   * in batches if the metric supports it, otherwise one at a time with
+   * @c bounded_distance().
+   *
+   * @return The end of the output range.
+   */
+  template <typename Metric, typename T, typename Iterator, typename OutputIterator, typename Limit>
+  OutputIterator
+  distance_many(const Metric& metric, const T& query, Iterator first, Iterator last, OutputIterator out, Limit limit)
+  {
+    if constexpr (IsBatchMetric<Metric, T, Iterator, OutputIterator, Limit>::value) {
+      return metric.distance_many(query, first, last, out, limit);
+    } else {
+      for (; first != last; ++first) {
+        *out++ = bounded_distance(metric, *first, query, limit);
+      }
+      return out;
+    }
+  }
+
   /**
    * Equality distance metric.
    *
@@ -0,0 +1,297 @@
+/**
+ * @file
+ * Pivot tables, for skipping distance computations with precomputed bounds.
+ *
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ */
+
+#ifndef MALUUBA_PIVOTTABLE_HPP
+#define MALUUBA_PIVOTTABLE_HPP
+
+#include "maluuba/metric.hpp"
+#include "maluuba/searchstats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace maluuba
+{
+  /**
+   * Counts of the distance computations made and avoided by the searches of a
+   * @c PivotTable.
+   */
+  struct PivotTableStats
+  {
+    /** The number of distances computed, including those to the pivots. */
+    std::size_t evaluations = 0;
+    /** The number of elements skipped without computing their distance. */
+    std::size_t avoided = 0;
+  };
+
+  /**
+   * A table of the distances from each element of a sequence to a few pivot
+   * elements, in the style of LAESA.  Searches compute the distances from
+   * their target to the pivots once, then skip every element whose distances
+   * to the pivots prove, by the triangle inequality, that it is too far from
+   * the target to match.
+   *
+   * The table doesn't own the elements: its rows follow the order of a
+   * sequence kept by its user, who must add and remove rows alongside the
+   * elements.
+   *
+   * @tparam T  The type of element to index.
+   * @tparam Metric  The metric used to compare elements.
+   */
+  template <typename T, typename Metric>
+  class PivotTable
+  {
+  public:
+    using value_type = T;
+    using distance_type = MetricResult<Metric, T>;
+
+    /**
+     * Scratch space for scans, reused from one scan to the next so that they
+     * don't allocate.  Keep one per thread.
+     */
+    class ScanContext
+    {
+    private:
+      friend class PivotTable;
+
+      /** The distances from the target to each pivot. */
+      std::vector<distance_type> m_query;
+      /** The lower bound for each row, with its index. */
+      std::vector<std::pair<distance_type, std::size_t>> m_order;
+    };
+
+    PivotTable() = default;
+
+    /**
+     * Build a pivot table for the elements in [@p first, @p last).  Each
+     * pivot is the element with the greatest sum of distances to the pivots
+     * chosen before it, which spreads them out.  Building computes
+     * <code>pivots * (last - first)</code> distances.
+     *
+     * @param first  The first element.
+     * @param last  The end of the elements.
+     * @param metric  The distance metric.
+     * @param pivots  The number of pivots, capped at the number of elements.
+     */
+    template <typename Iterator>
+    PivotTable(Iterator first, Iterator last, const Metric& metric, std::size_t pivots)
+      : m_size{static_cast<std::size_t>(std::distance(first, last))}
+    {
+      auto count = std::min(pivots, m_size);
+      m_pivots.reserve(count);
+      m_distances.resize(m_size*count);
+
+      std::vector<distance_type> sums(m_size);
+      std::vector<bool> chosen(m_size);
+      std::size_t next = 0;
+      for (std::size_t j = 0; j < count; ++j) {
+        chosen[next] = true;
+        m_pivots.push_back(first[next]);
+
+        for (std::size_t i = 0; i < m_size; ++i) {
+          auto distance = metric(first[i], m_pivots.back());
+          m_distances[i*count + j] = distance;
+          sums[i] += distance;
+        }
+
+        for (std::size_t i = 0; i < m_size; ++i) {
+          if (!chosen[i] && (chosen[next] || sums[i] > sums[next])) {
+            next = i;
+          }
+        }
+      }
+    }
+
+    PivotTable(PivotTable&& other) noexcept
+      : m_pivots{std::move(other.m_pivots)},
+        m_distances{std::move(other.m_distances)},
+        m_size{other.m_size},
+        m_evaluations{other.m_evaluations.load()},
+        m_avoided{other.m_avoided.load()}
+    { }
+
+    PivotTable&
+    operator=(PivotTable&& other) noexcept
+    {
+      m_pivots = std::move(other.m_pivots);
+      m_distances = std::move(other.m_distances);
+      m_size = other.m_size;
+      m_evaluations = other.m_evaluations.load();
+      m_avoided = other.m_avoided.load();
+      return *this;
+    }
+
+    /**
+     * @return The number of rows, i.e. indexed elements.
+     */
+    std::size_t
+    size() const
+    {
+      return m_size;
+    }
+
+    /**
+     * @return The number of pivots.
+     */
+    std::size_t
+    pivots() const
+    {
+      return m_pivots.size();
+    }
+
+    /**
+     * Add a row for an element appended to the sequence.
+     */
+    void
+    push_back(const T& element, const Metric& metric)
+    {
+      for (const auto& pivot : m_pivots) {
+        m_distances.push_back(metric(element, pivot));
+      }
+      ++m_size;
+    }
+
+    /**
+     * Remove the rows of the elements removed from the sequence, keeping the
+     * order of the others.
+     *
+     * @param removed  Whether each row's element was removed.
+     */
+    void
+    erase_rows(const std::vector<bool>& removed)
+    {
+      auto count = m_pivots.size();
+      std::size_t kept = 0;
+      for (std::size_t i = 0; i < m_size; ++i) {
+        if (!removed[i]) {
+          std::copy_n(m_distances.begin() + i*count, count, m_distances.begin() + kept*count);
+          ++kept;
+        }
+      }
+      m_size = kept;
+      m_distances.resize(m_size*count);
+    }
+
+    /**
+     * Scan the sequence for matches to a target, skipping the elements the
+     * pivots prove are too far away.  Elements are visited in order of their
+     * lower bounds, so a shrinking bound excludes the rest sooner.
+     *
+     * @param elements  The start of the sequence.
+     * @param target  The search target.
+     * @param metric  The distance metric.
+     * @param bound  Called as <code>bound()</code> before each element for the
+     *               distance beyond which elements don't match, which may
+     *               shrink as the scan goes.
+     * @param visitor  Called as <code>visitor(i, distance)</code> for each
+     *                 element that wasn't skipped, with its
+     *                 @c bounded_distance() to @p target.  Returns whether to
+     *                 keep scanning.
+     * @param context  The scratch space for the scan.
+     * @param recorder  Counts the rows visited and skipped.
+     * @return The number of elements visited or skipped, which is @c size()
+     *         unless @p visitor stopped the scan.
+     */
+    template <typename U, typename Iterator, typename Bound, typename Visitor>
+    std::size_t
+    scan(Iterator elements, const U& target, const Metric& metric, Bound&& bound, Visitor&& visitor, ScanContext& context, SearchRecorder& recorder) const
+    {
+      auto count = m_pivots.size();
+      auto& query = context.m_query;
+      query.clear();
+      query.reserve(count);
+      for (const auto& pivot : m_pivots) {
+        query.push_back(recorder.metric(1, [&] { return metric(pivot, target); }));
+      }
+
+      // Once one element's lower bound exceeds the bound, so do the rest
+      auto& order = context.m_order;
+      order.clear();
+      order.reserve(m_size);
+      auto row = m_distances.data();
+      for (std::size_t i = 0; i < m_size; ++i, row += count) {
+        order.emplace_back(lower_bound(query, row), i);
+      }
+      std::sort(order.begin(), order.end());
+
+      std::size_t scanned = 0, avoided = 0;
+      while (scanned < m_size) {
+        auto limit = bound();
+        const auto& next = order[scanned];
+        if (next.first > limit) {
+          avoided = m_size - scanned;
+          scanned = m_size;
+          break;
+        }
+
+        ++scanned;
+        recorder.visit();
+        auto distance = recorder.metric(1, [&] { return bounded_distance(metric, elements[next.second], target, limit); });
+        if (!visitor(next.second, distance)) {
+          break;
+        }
+      }
+      recorder.prune(avoided);
+
+      m_evaluations += count + scanned - avoided;
+      m_avoided += avoided;
+      return scanned;
+    }
+
+    /**
+     * @return The distance computations made and avoided by every scan so far.
+     */
+    PivotTableStats
+    stats() const
+    {
+      PivotTableStats stats;
+      stats.evaluations = m_evaluations.load();
+      stats.avoided = m_avoided.load();
+      return stats;
+    }
+
+    /**
+     * Reset the counts returned by @c stats().
+     */
+    void
+    reset_stats()
+    {
+      m_evaluations = 0;
+      m_avoided = 0;
+    }
+
+  private:
+    std::vector<T> m_pivots;
+    /** The distances from each element to each pivot, one row per element. */
+    std::vector<distance_type> m_distances;
+    std::size_t m_size = 0;
+    mutable std::atomic<std::size_t> m_evaluations{0};
+    mutable std::atomic<std::size_t> m_avoided{0};
+
+    /**
+     * @return The lower bound the pivots give for the distance between the
+     *         element with the distances in @p row and the target with the
+     *         distances in @p query.
+     */
+    static distance_type
+    lower_bound(const std::vector<distance_type>& query, const distance_type* row)
+    {
+      distance_type bound{};
+      for (std::size_t j = 0; j < query.size(); ++j) {
+        auto difference = query[j] > row[j] ? query[j] - row[j] : row[j] - query[j];
+        bound = std::max(bound, difference);
+      }
+      return bound;
+    }
+  };
+}
+
+#endif // MALUUBA_PIVOTTABLE_HPP
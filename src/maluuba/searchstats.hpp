@@ -0,0 +1,251 @@
+/**
+ * @file
+ * Instrumentation counters for metric space searches.
+ *
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ */
+
+#ifndef MALUUBA_SEARCHSTATS_HPP
+#define MALUUBA_SEARCHSTATS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Define as 1 to count what searches do.  Otherwise the counters compile to
+ * nothing, and @c SearchStatsCounter::stats() always returns zeros.
+ */
+#ifndef MALUUBA_SEARCH_STATS
+#  define MALUUBA_SEARCH_STATS 0
+#endif
+
+namespace maluuba
+{
+  /**
+   * What one or more searches did, to tell a slow tree from a slow metric.
+   */
+  struct SearchStats
+  {
+    /** The number of searches. */
+    std::size_t searches = 0;
+    /** The number of distances computed. */
+    std::size_t evaluations = 0;
+    /** The number of subtrees, or elements of a linear scan, expanded. */
+    std::size_t nodes_visited = 0;
+    /** The number of subtrees, or elements of a linear scan, skipped by their bounds. */
+    std::size_t subtrees_pruned = 0;
+    /** The most pending subtrees any one search held at once. */
+    std::size_t stack_high_water = 0;
+    /** The time spent computing distances. */
+    std::chrono::nanoseconds metric_time{0};
+    /** The rest of the time spent searching. */
+    std::chrono::nanoseconds traversal_time{0};
+  };
+
+  /**
+   * Accumulates the @c SearchStats of every search of an index, from any
+   * number of threads.  Copies take a snapshot of the counts.
+   */
+  class SearchStatsCounter
+  {
+  public:
+    /** Whether searches are counted at all. */
+    static constexpr bool enabled = MALUUBA_SEARCH_STATS;
+
+    SearchStatsCounter() = default;
+
+    SearchStatsCounter(const SearchStatsCounter& other)
+    {
+      *this = other;
+    }
+
+    SearchStatsCounter&
+    operator=(const SearchStatsCounter& other)
+    {
+#if MALUUBA_SEARCH_STATS
+      auto stats = other.stats();
+      reset();
+      add(stats);
+#else
+      static_cast<void>(other);
+#endif
+      return *this;
+    }
+
+    /**
+     * Add the counts of one or more searches.
+     */
+    void
+    add(const SearchStats& stats)
+    {
+#if MALUUBA_SEARCH_STATS
+      m_searches += stats.searches;
+      m_evaluations += stats.evaluations;
+      m_nodes_visited += stats.nodes_visited;
+      m_subtrees_pruned += stats.subtrees_pruned;
+      m_metric_nanoseconds += stats.metric_time.count();
+      m_traversal_nanoseconds += stats.traversal_time.count();
+
+      auto high_water = m_stack_high_water.load();
+      while (high_water < stats.stack_high_water && !m_stack_high_water.compare_exchange_weak(high_water, stats.stack_high_water)) { }
+#else
+      static_cast<void>(stats);
+#endif
+    }
+
+    /**
+     * @return The counts since construction or the last @c reset().
+     */
+    SearchStats
+    stats() const
+    {
+      SearchStats stats;
+#if MALUUBA_SEARCH_STATS
+      stats.searches = m_searches.load();
+      stats.evaluations = m_evaluations.load();
+      stats.nodes_visited = m_nodes_visited.load();
+      stats.subtrees_pruned = m_subtrees_pruned.load();
+      stats.stack_high_water = m_stack_high_water.load();
+      stats.metric_time = std::chrono::nanoseconds{m_metric_nanoseconds.load()};
+      stats.traversal_time = std::chrono::nanoseconds{m_traversal_nanoseconds.load()};
+#endif
+      return stats;
+    }
+
+    /**
+     * Zero the counts.
+     */
+    void
+    reset()
+    {
+#if MALUUBA_SEARCH_STATS
+      m_searches = 0;
+      m_evaluations = 0;
+      m_nodes_visited = 0;
+      m_subtrees_pruned = 0;
+      m_stack_high_water = 0;
+      m_metric_nanoseconds = 0;
+      m_traversal_nanoseconds = 0;
+#endif
+    }
+
+  private:
+#if MALUUBA_SEARCH_STATS
+    std::atomic<std::size_t> m_searches{0};
+    std::atomic<std::size_t> m_evaluations{0};
+    std::atomic<std::size_t> m_nodes_visited{0};
+    std::atomic<std::size_t> m_subtrees_pruned{0};
+    std::atomic<std::size_t> m_stack_high_water{0};
+    std::atomic<std::chrono::nanoseconds::rep> m_metric_nanoseconds{0};
+    std::atomic<std::chrono::nanoseconds::rep> m_traversal_nanoseconds{0};
+#endif
+  };
+
+  /**
+   * Counts what a single search does, and adds it to a @c SearchStatsCounter
+   * when the search returns.  Every method is empty unless
+   * @c MALUUBA_SEARCH_STATS is set.
+   */
+  class SearchRecorder
+  {
+  public:
+    explicit SearchRecorder(SearchStatsCounter& counter)
+#if MALUUBA_SEARCH_STATS
+      : m_counter{counter},
+        m_start{std::chrono::steady_clock::now()}
+    {
+      m_stats.searches = 1;
+    }
+#else
+    {
+      static_cast<void>(counter);
+    }
+#endif
+
+    SearchRecorder(const SearchRecorder&) = delete;
+    SearchRecorder& operator=(const SearchRecorder&) = delete;
+
+    ~SearchRecorder()
+    {
+#if MALUUBA_SEARCH_STATS
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+      m_stats.traversal_time = std::max(elapsed - m_stats.metric_time, std::chrono::nanoseconds{0});
+      m_counter.add(m_stats);
+#endif
+    }
+
+    /** Count @p count expanded subtrees. */
+    void
+    visit(std::size_t count = 1)
+    {
+#if MALUUBA_SEARCH_STATS
+      m_stats.nodes_visited += count;
+#else
+      static_cast<void>(count);
+#endif
+    }
+
+    /** Count @p count skipped subtrees. */
+    void
+    prune(std::size_t count = 1)
+    {
+#if MALUUBA_SEARCH_STATS
+      m_stats.subtrees_pruned += count;
+#else
+      static_cast<void>(count);
+#endif
+    }
+
+    /** Note the current number of pending subtrees. */
+    void
+    stack(std::size_t size)
+    {
+#if MALUUBA_SEARCH_STATS
+      m_stats.stack_high_water = std::max(m_stats.stack_high_water, size);
+#else
+      static_cast<void>(size);
+#endif
+    }
+
+    /**
+     * Call @p compute, which computes @p evaluations distances, and time it.
+     *
+     * @return The result of @p compute().
+     */
+    template <typename Compute>
+    decltype(auto)
+    metric(std::size_t evaluations, Compute&& compute)
+    {
+#if MALUUBA_SEARCH_STATS
+      m_stats.evaluations += evaluations;
+      auto start = std::chrono::steady_clock::now();
+      struct Timer
+      {
+        SearchStats& stats;
+        std::chrono::steady_clock::time_point start;
+
+        ~Timer()
+        {
+          stats.metric_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        }
+      } timer{m_stats, start};
+#else
+      static_cast<void>(evaluations);
+#endif
+      return std::forward<Compute>(compute)();
+    }
+
+  private:
+#if MALUUBA_SEARCH_STATS
+    SearchStatsCounter& m_counter;
+    std::chrono::steady_clock::time_point m_start;
+    SearchStats m_stats;
+#endif
+  };
+}
+
+#endif // MALUUBA_SEARCHSTATS_HPP
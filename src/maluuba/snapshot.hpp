@@ -0,0 +1,249 @@
+/**
+ * @file
+ * Binary snapshots of built data structures.
+ *
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ */
+
+#ifndef MALUUBA_SNAPSHOT_HPP
+#define MALUUBA_SNAPSHOT_HPP
+
+#include "maluuba/debug.hpp"
+#include "maluuba/xtd/string_view.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace maluuba
+{
+  /**
+   * The snapshot file format.  Snapshots start with a magic number and a
+   * version, followed by whatever the saved structures write.  Every value is
+   * stored little-endian, whatever the host, so snapshots can move between
+   * machines.
+   *
+   * Snapshots are a serialization format, not an index to search in place.
+   * The targets of a loaded matcher are built from the caller's objects, and
+   * pronunciations own their phones, so nothing could point into the file.
+   * Snapshots are therefore read with a plain stream and decoded into ordinary
+   * heap structures.  Loading skips pronouncing the targets and building the
+   * index, but still takes time linear in the number of targets, and
+   * processes that load the same snapshot each hold their own copy.
+   */
+  namespace snapshot
+  {
+    /** Identifies a snapshot file. */
+    constexpr char magic[8] = {'M', 'L', 'B', 'S', 'N', 'A', 'P', '\0'};
+    /** The current format version.  Readers reject any other version. */
+    constexpr std::uint32_t version = 4;
+
+    static_assert(std::numeric_limits<double>::is_iec559, "Snapshots store IEEE 754 doubles.");
+
+    /**
+     * Read a whole snapshot file into memory.
+     *
+     * @param path  The path to the file.
+     * @return The contents of the file.
+     * @throws std::runtime_error  If the file can't be read.
+     */
+    inline std::string
+    read_file(const std::string& path)
+    {
+      std::ifstream stream{path, std::ios::binary};
+      check(stream.is_open(), "Failed to open " + path);
+      std::string data{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+      check(!stream.bad(), "Failed to read " + path);
+      return data;
+    }
+  }
+
+  /**
+   * Writes a snapshot to a stream.
+   */
+  class SnapshotWriter
+  {
+  public:
+    /**
+     * Start a snapshot by writing its header.
+     */
+    explicit SnapshotWriter(std::ostream& stream)
+      : m_stream{stream}
+    {
+      m_stream.write(snapshot::magic, sizeof(snapshot::magic));
+      write_u32(snapshot::version);
+    }
+
+    void
+    write_u8(std::uint8_t value)
+    {
+      write_le(value);
+    }
+
+    void
+    write_u32(std::uint32_t value)
+    {
+      write_le(value);
+    }
+
+    void
+    write_u64(std::uint64_t value)
+    {
+      write_le(value);
+    }
+
+    void
+    write_f64(double value)
+    {
+      std::uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      write_le(bits);
+    }
+
+    void
+    write_string(xtd::string_view value)
+    {
+      write_u64(value.size());
+      m_stream.write(value.data(), value.size());
+    }
+
+    /**
+     * @throws std::runtime_error  If any write failed.
+     */
+    void
+    finish()
+    {
+      m_stream.flush();
+      check(static_cast<bool>(m_stream), "Failed to write snapshot.");
+    }
+
+  private:
+    std::ostream& m_stream;
+
+    template <typename U>
+    void
+    write_le(U value)
+    {
+      char bytes[sizeof(U)];
+      for (std::size_t i = 0; i < sizeof(U); ++i) {
+        bytes[i] = static_cast<char>(value >> (8*i));
+      }
+      m_stream.write(bytes, sizeof(U));
+    }
+  };
+
+  /**
+   * Reads a snapshot from memory, usually the contents of a file read by
+   * @c snapshot::read_file().  Reads past the end of the data throw rather than
+   * reading out of bounds.
+   */
+  class SnapshotReader
+  {
+  public:
+    /**
+     * Start reading a snapshot by checking its header.
+     *
+     * @throws std::runtime_error  If @p data isn't a snapshot of the current
+     *                             version.
+     */
+    explicit SnapshotReader(xtd::string_view data)
+      : m_data{data}
+    {
+      auto magic = take(sizeof(snapshot::magic));
+      check(std::memcmp(magic, snapshot::magic, sizeof(snapshot::magic)) == 0, "Not a snapshot.");
+      check(read_u32() == snapshot::version, "Unsupported snapshot version.");
+    }
+
+    std::uint8_t
+    read_u8()
+    {
+      return read_le<std::uint8_t>();
+    }
+
+    std::uint32_t
+    read_u32()
+    {
+      return read_le<std::uint32_t>();
+    }
+
+    std::uint64_t
+    read_u64()
+    {
+      return read_le<std::uint64_t>();
+    }
+
+    double
+    read_f64()
+    {
+      auto bits = read_le<std::uint64_t>();
+      double value;
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+
+    /**
+     * @return The next string, pointing into the snapshot's data.
+     */
+    xtd::string_view
+    read_string()
+    {
+      auto size = read_u64();
+      check(size <= m_data.size(), "Truncated snapshot.");
+      return {take(size), static_cast<std::size_t>(size)};
+    }
+
+    /**
+     * Read a count of items that each take at least @p item_size bytes,
+     * rejecting counts the remaining data can't hold before anything is
+     * allocated for them.
+     */
+    std::size_t
+    read_count(std::size_t item_size = 1)
+    {
+      auto count = read_u64();
+      check(count <= m_data.size()/item_size, "Truncated snapshot.");
+      return count;
+    }
+
+    /**
+     * @return Whether the whole snapshot has been read.
+     */
+    bool
+    at_end() const
+    {
+      return m_data.empty();
+    }
+
+  private:
+    xtd::string_view m_data;
+
+    const char*
+    take(std::size_t size)
+    {
+      check(size <= m_data.size(), "Truncated snapshot.");
+      auto result = m_data.data();
+      m_data.remove_prefix(size);
+      return result;
+    }
+
+    template <typename U>
+    U
+    read_le()
+    {
+      auto bytes = take(sizeof(U));
+      U value = 0;
+      for (std::size_t i = 0; i < sizeof(U); ++i) {
+        value |= static_cast<U>(static_cast<unsigned char>(bytes[i])) << (8*i);
+      }
+      return value;
+    }
+  };
+}
+
+#endif // MALUUBA_SNAPSHOT_HPP
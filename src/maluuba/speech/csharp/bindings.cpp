@@ -13,8 +13,14 @@
 #include "maluuba/speech/phoneticdistance.hpp"
 #include "maluuba/speech/pronouncer.hpp"
 #include "maluuba/speech/pronunciation.hpp"
+#include "maluuba/snapshot.hpp"
 #include "maluuba/unicode.hpp"
+#include "maluuba/xtd/string_view.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <string>
 #include <stdexcept>
 #include <vector>
@@ -94,6 +100,76 @@ CheckPointer(void* ptr)
     }
 }
 
+/* Snapshots of the fuzzy matchers store target indices; the managed side keeps the targets themselves. */
+template <typename Matcher>
+void 
+SaveSnapshot(const Matcher& matcher, const bool isAccelerated, const char* path)
+{
+    std::ofstream stream{path, std::ios::binary};
+    maluuba::check(stream.is_open(), std::string{"Failed to open "} + path);
+
+    maluuba::SnapshotWriter writer{stream};
+    writer.write_u8(isAccelerated);
+    matcher.save(writer, [](maluuba::SnapshotWriter& writer, int target) {
+        writer.write_u64(target);
+    });
+    writer.finish();
+}
+
+/* Approximate searches take their limits as plain values: 0 evaluations or a negative timeout for no limit. */
+maluuba::VpTreeSearchOptions 
+MakeSearchOptions(const int maxEvaluations, const double timeoutMilliseconds, const double epsilon)
+{
+    maluuba::check<std::invalid_argument>(maxEvaluations >= 0, "maxEvaluations must be >= 0");
+    maluuba::check<std::invalid_argument>(epsilon >= 0, "epsilon must be >= 0");
+
+    maluuba::VpTreeSearchOptions options;
+    options.max_evaluations = maxEvaluations;
+    if (timeoutMilliseconds >= 0) {
+        std::chrono::duration<double, std::milli> timeout{timeoutMilliseconds};
+        options.deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    }
+    options.epsilon = epsilon;
+    return options;
+}
+
+/* Searches reuse a context per thread and write their matches straight into the managed arrays, so they don't allocate. */
+template <typename Matcher>
+Result 
+FindNearestElements(const Matcher& matcher, int capacity, double limit, const maluuba::VpTreeSearchOptions& options, bool* exact, int* nearestIdxs, double* distances)
+{
+    thread_local typename Matcher::SearchContext context;
+
+    size_t idx = 0;
+    matcher.find_k_nearest_within(-1, capacity, limit, context, [&](int element, double distance) {
+        nearestIdxs[idx] = element;
+        distances[idx] = distance;
+        ++idx;
+    }, options, exact);
+
+    return Result::SUCCESS;
+}
+
+/* Search stats go out as plain arrays: searches, evaluations, nodes visited, subtrees pruned and stack high water, then the metric and traversal times in milliseconds. */
+template <typename Matcher>
+void 
+CopySearchStats(const Matcher& matcher, bool* enabled, std::int64_t* counts, double* milliseconds)
+{
+    CheckPointer(enabled);
+    CheckPointer(counts);
+    CheckPointer(milliseconds);
+
+    auto stats = matcher.search_stats();
+    *enabled = maluuba::SearchStatsCounter::enabled;
+    counts[0] = stats.searches;
+    counts[1] = stats.evaluations;
+    counts[2] = stats.nodes_visited;
+    counts[3] = stats.subtrees_pruned;
+    counts[4] = stats.stack_high_water;
+    milliseconds[0] = std::chrono::duration<double, std::milli>{stats.metric_time}.count();
+    milliseconds[1] = std::chrono::duration<double, std::milli>{stats.traversal_time}.count();
+}
+
 extern "C" 
 {
     /*
@@ -118,7 +194,7 @@ extern "C"
     {
         try {
             CheckPointer(ptr);
-            *distance = (*ptr)(std::string(a), std::string(b));
+            *distance = (*ptr)(maluuba::xtd::string_view(a), maluuba::xtd::string_view(b));
             return Result::SUCCESS;
         } catch (const std::exception&) {
             return HandleException(buffer, bufferSize);
@@ -190,8 +266,8 @@ extern "C"
     {
         try {
             CheckPointer(ptr);
-            std::string a_string(a_phrase);
-            std::string b_string(b_phrase);
+            maluuba::xtd::string_view a_string(a_phrase);
+            maluuba::xtd::string_view b_string(b_phrase);
             *distance = (*ptr)(a_string, *a_pronunciation, b_string, *b_pronunciation);
             return Result::SUCCESS;
         } catch (const std::exception&) {
@@ -235,6 +311,22 @@ extern "C"
         }
     }
 
+    DLL_PUBLIC 
+    Result 
+    EnPronouncer_PronounceAll(EnPronouncer* ptr, const char** phrases, const int count, /*out*/ EnPronunciation** natives, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            auto pronunciations = ptr->pronounce_all(std::vector<std::string>(phrases, phrases + count));
+            for (int i = 0; i < count; ++i) {
+                natives[i] = new EnPronunciation(std::move(pronunciations[i]));
+            }
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
     DLL_PUBLIC 
     Result 
     EnPronouncer_Delete(EnPronouncer* native, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
@@ -242,6 +334,51 @@ extern "C"
         return NativeDelete(native, buffer, bufferSize);
     }
 
+    DLL_PUBLIC 
+    Result 
+    EnPronouncer_SetCacheBudget(std::int64_t bytes, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            maluuba::check<std::invalid_argument>(bytes >= 0, "bytes must be >= 0");
+            EnPronouncer::set_cache_budget(bytes);
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    /* The counts go out as hits, misses, evictions, entries, bytes and budget. */
+    DLL_PUBLIC 
+    Result 
+    EnPronouncer_CacheStats(std::int64_t* counts, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(counts);
+            auto stats = EnPronouncer::cache_stats();
+            counts[0] = stats.hits;
+            counts[1] = stats.misses;
+            counts[2] = stats.evictions;
+            counts[3] = stats.entries;
+            counts[4] = stats.bytes;
+            counts[5] = EnPronouncer::cache_budget();
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    EnPronouncer_ClearCache(/*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            EnPronouncer::clear_cache();
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
     /*
      * EnPronunciation
      */
@@ -403,12 +540,79 @@ extern "C"
         return NativeDelete(native, buffer, bufferSize);
     }
 
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_FindNearestWithin(LinearFuzzyMatcher<int, CALLBACK>* ptr, int capacity, double limit, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            return FindNearestElements(*ptr, capacity, limit, {}, nullptr, nearestIdxs, distances);
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_FindNearestWithin(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, int capacity, double limit, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            return FindNearestElements(*ptr, capacity, limit, {}, nullptr, nearestIdxs, distances);
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_FindNearestWithinApproximate(LinearFuzzyMatcher<int, CALLBACK>* ptr, int capacity, double limit, int maxEvaluations, double timeoutMilliseconds, double epsilon, /*out*/ bool* exact, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            CheckPointer(exact);
+            auto options = MakeSearchOptions(maxEvaluations, timeoutMilliseconds, epsilon);
+            return FindNearestElements(*ptr, capacity, limit, options, exact, nearestIdxs, distances);
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_FindNearestWithinApproximate(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, int capacity, double limit, int maxEvaluations, double timeoutMilliseconds, double epsilon, /*out*/ bool* exact, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            CheckPointer(exact);
+            auto options = MakeSearchOptions(maxEvaluations, timeoutMilliseconds, epsilon);
+            return FindNearestElements(*ptr, capacity, limit, options, exact, nearestIdxs, distances);
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    /* The queries of a batch are passed to the distance callback as -1, -2, ..., -queryCount. */
+    std::vector<int>
+    BatchQueries(int queryCount)
+    {
+        std::vector<int> queries;
+        for (int idx = 0; idx < queryCount; ++idx) {
+            queries.push_back(-1 - idx);
+        }
+        return queries;
+    }
+
+    /* The matches for query i go to nearestIdxs and distances from index i*capacity. */
     Result 
-    ProcessNearestElements(const std::vector<FuzzyMatcher<int>::Match>& matches, int* nearestIdxs, double* distances)
+    ProcessBatchMatches(const FuzzyMatcher<int>::BatchMatches& batch, int capacity, int* nearestIdxs, double* distances)
     {
-        for (size_t idx = 0; idx < matches.size(); ++idx) {
-            nearestIdxs[idx] = matches[idx].element();
-            distances[idx] = matches[idx].distance();
+        for (size_t query = 0; query < batch.size(); ++query) {
+            for (size_t idx = 0; idx < batch.count(query); ++idx) {
+                const auto& match = batch.matches()[batch.offset(query) + idx];
+                nearestIdxs[query*capacity + idx] = match.element();
+                distances[query*capacity + idx] = match.distance();
+            }
         }
 
         return Result::SUCCESS;
@@ -416,11 +620,11 @@ extern "C"
 
     DLL_PUBLIC 
     Result 
-    FuzzyMatcher_FindNearestWithin(LinearFuzzyMatcher<int, CALLBACK>* ptr, int capacity, double limit, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    FuzzyMatcher_FindNearestWithinBatch(LinearFuzzyMatcher<int, CALLBACK>* ptr, int queryCount, int capacity, double limit, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
     {
         try {
             CheckPointer(ptr);
-            return ProcessNearestElements(ptr->find_k_nearest_within(-1, capacity, limit), nearestIdxs, distances);
+            return ProcessBatchMatches(ptr->find_k_nearest_within_batch(BatchQueries(queryCount), capacity, limit), capacity, nearestIdxs, distances);
         } catch (const std::exception&) {
             return HandleException(buffer, bufferSize);
         }
@@ -428,11 +632,205 @@ extern "C"
 
     DLL_PUBLIC 
     Result 
-    AcceleratedFuzzyMatcher_FindNearestWithin(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, int capacity, double limit, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    AcceleratedFuzzyMatcher_FindNearestWithinBatch(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, int queryCount, int capacity, double limit, int* nearestIdxs, double* distances, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
     {
         try {
             CheckPointer(ptr);
-            return ProcessNearestElements(ptr->find_k_nearest_within(-1, capacity, limit), nearestIdxs, distances);
+            return ProcessBatchMatches(ptr->find_k_nearest_within_batch(BatchQueries(queryCount), capacity, limit), capacity, nearestIdxs, distances);
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_Insert(LinearFuzzyMatcher<int, CALLBACK>* ptr, int target, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            ptr->insert(target);
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_Insert(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, int target, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            ptr->insert(target);
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_Erase(LinearFuzzyMatcher<int, CALLBACK>* ptr, int target, /*out*/ int* count, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            CheckPointer(count);
+            *count = static_cast<int>(ptr->erase(target));
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_Erase(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, int target, /*out*/ int* count, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            CheckPointer(count);
+            *count = static_cast<int>(ptr->erase(target));
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_Save(LinearFuzzyMatcher<int, CALLBACK>* ptr, const char* path, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            SaveSnapshot(*ptr, false, path);
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_Save(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, const char* path, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            SaveSnapshot(*ptr, true, path);
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_SearchStats(LinearFuzzyMatcher<int, CALLBACK>* ptr, /*out*/ bool* enabled, std::int64_t* counts, double* milliseconds, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            CopySearchStats(*ptr, enabled, counts, milliseconds);
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_SearchStats(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, /*out*/ bool* enabled, std::int64_t* counts, double* milliseconds, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            CopySearchStats(*ptr, enabled, counts, milliseconds);
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_ResetSearchStats(LinearFuzzyMatcher<int, CALLBACK>* ptr, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            ptr->reset_search_stats();
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_ResetSearchStats(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            ptr->reset_search_stats();
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    /* The tree shape goes out as trees, nodes, leaves and max depth, then mean depth, tied splits and the min, median and max radius. */
+    DLL_PUBLIC 
+    Result 
+    AcceleratedFuzzyMatcher_TreeShape(AcceleratedFuzzyMatcher<int, CALLBACK>* ptr, std::int64_t* counts, double* values, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(ptr);
+            CheckPointer(counts);
+            CheckPointer(values);
+
+            auto shape = ptr->tree_shape();
+            counts[0] = shape.trees;
+            counts[1] = shape.nodes;
+            counts[2] = shape.leaves;
+            counts[3] = shape.max_depth;
+            values[0] = shape.mean_depth;
+            values[1] = shape.tied_splits;
+            values[2] = shape.min_radius;
+            values[3] = shape.median_radius;
+            values[4] = shape.max_radius;
+            return Result::SUCCESS;
+        } catch (const std::exception&) {
+            return HandleException(buffer, bufferSize);
+        }
+    }
+
+    /* Load a matcher over __count__ targets, marking which of them weren't removed before saving. */
+    DLL_PUBLIC 
+    Result 
+    FuzzyMatcher_Load(const char* path, const int count, CALLBACK distance, const bool isAccelerated, /*out*/ bool* present, /*out*/FuzzyMatcher<int>** ret, /*out*/ char* buffer, /*in,out*/ size_t* bufferSize)
+    {
+        try {
+            CheckPointer(present);
+            std::fill(present, present + count, false);
+
+            auto data = maluuba::snapshot::read_file(path);
+            maluuba::SnapshotReader reader{data};
+            maluuba::check(reader.read_u8() == isAccelerated, "Snapshot is of a different kind of matcher.");
+
+            auto read_index = [count, present](maluuba::SnapshotReader& reader) {
+                auto target = reader.read_u64();
+                maluuba::check(target < static_cast<std::uint64_t>(count), "Snapshot refers to a target past the end of 'targets'.");
+                present[target] = true;
+                return static_cast<int>(target);
+            };
+
+            if (isAccelerated) {
+                auto matcher = AcceleratedFuzzyMatcher<int, CALLBACK>::load(reader, read_index, distance);
+                maluuba::check(reader.at_end(), "Malformed snapshot.");
+                *ret = new AcceleratedFuzzyMatcher<int, CALLBACK>(std::move(matcher));
+            } else {
+                auto matcher = LinearFuzzyMatcher<int, CALLBACK>::load(reader, read_index, distance);
+                maluuba::check(reader.at_end(), "Malformed snapshot.");
+                *ret = new LinearFuzzyMatcher<int, CALLBACK>(std::move(matcher));
+            }
+
+            return Result::SUCCESS;
         } catch (const std::exception&) {
             return HandleException(buffer, bufferSize);
         }
@@ -12,10 +12,16 @@
 #ifndef MALUUBA_SPEECH_FUZZYMATCHER_HPP
 #define MALUUBA_SPEECH_FUZZYMATCHER_HPP
 
+#include "maluuba/bktree.hpp"
 #include "maluuba/debug.hpp"
+#include "maluuba/metric.hpp"
+#include "maluuba/pivottable.hpp"
+#include "maluuba/snapshot.hpp"
+#include "maluuba/taskpool.hpp"
 #include "maluuba/vptree.hpp"
 #include "maluuba/xtd/optional.hpp"
 #include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <limits>
 #include <utility>
@@ -73,6 +79,57 @@ namespace speech
       double m_distance;
     };
 
+    /**
+     * The matches found for a batch of queries, stored contiguously in query
+     * order.
+     */
+    class BatchMatches
+    {
+    public:
+      /**
+       * @return The number of queries.
+       */
+      size_t
+      size() const
+      {
+        return m_offsets.size() - 1;
+      }
+
+      /**
+       * @return The matches for every query, grouped by query.
+       */
+      const std::vector<Match>&
+      matches() const
+      {
+        return m_matches;
+      }
+
+      /**
+       * @return The index in @c matches() of the first match for query @p i.
+       *         The matches for query @p i end at <code>offset(i + 1)</code>.
+       */
+      size_t
+      offset(size_t i) const
+      {
+        return m_offsets[i];
+      }
+
+      /**
+       * @return The number of matches for query @p i.
+       */
+      size_t
+      count(size_t i) const
+      {
+        return m_offsets[i + 1] - m_offsets[i];
+      }
+
+    private:
+      friend class FuzzyMatcher;
+
+      std::vector<Match> m_matches;
+      std::vector<size_t> m_offsets{0};
+    };
+
     FuzzyMatcher() = default;
     virtual ~FuzzyMatcher() = default;
 
@@ -81,6 +138,56 @@ namespace speech
 
     FuzzyMatcher(FuzzyMatcher&& other) = default;
     FuzzyMatcher& operator=(FuzzyMatcher&& other) = default;
+
+  protected:
+    /**
+     * Answer a batch of queries on a pool of threads.  Each thread collects
+     * the matches for a contiguous chunk of queries, and the chunks are joined
+     * at the end.
+     *
+     * @tparam Context  The scratch space for a search, one per chunk.
+     * @param count  The number of queries.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @param search  Called as <code>search(i, context, sink)</code> to pass
+     *                the matches for query @p i to
+     *                <code>sink(element, distance)</code>.
+     */
+    template <typename Context, typename Search>
+    static BatchMatches
+    find_batch(size_t count, std::size_t threads, Search search)
+    {
+      // Enough chunks to balance uneven queries, few enough to amortize joining them
+      constexpr std::size_t chunks_per_thread = 4;
+
+      TaskPool pool{threads};
+      auto chunk_count = std::min(count, pool.size()*chunks_per_thread);
+      std::vector<BatchMatches> chunks(chunk_count);
+      for (std::size_t c = 0; c < chunk_count; ++c) {
+        pool.spawn([&, c] {
+          auto& chunk = chunks[c];
+          Context context;
+          auto sink = [&](const T& element, double distance) {
+            chunk.m_matches.emplace_back(element, distance);
+          };
+          for (auto i = count*c/chunk_count; i < count*(c + 1)/chunk_count; ++i) {
+            search(i, context, sink);
+            chunk.m_offsets.push_back(chunk.m_matches.size());
+          }
+        });
+      }
+      pool.wait();
+
+      BatchMatches result;
+      result.m_offsets.reserve(count + 1);
+      for (const auto& chunk : chunks) {
+        auto base = result.m_matches.size();
+        result.m_matches.insert(result.m_matches.end(), chunk.m_matches.begin(), chunk.m_matches.end());
+        for (auto i = chunk.m_offsets.begin() + 1; i != chunk.m_offsets.end(); ++i) {
+          result.m_offsets.push_back(base + *i);
+        }
+      }
+      return result;
+    }
   };
 
   /**
@@ -93,20 +200,575 @@ namespace speech
   class LinearFuzzyMatcher: public FuzzyMatcher<Target>
   {
     using Match = typename FuzzyMatcher<Target>::Match;
+    using BatchMatches = typename FuzzyMatcher<Target>::BatchMatches;
 
   public:
+    /**
+     * Scratch space for searches, reused from one search to the next so that
+     * they don't allocate.  A context can serve any matcher of this type, but
+     * only one search at a time: keep one per thread.
+     */
+    class SearchContext
+    {
+    private:
+      friend class LinearFuzzyMatcher;
+
+      /** A max-heap of the matches found so far, sorted once the search ends. */
+      std::vector<Match> m_matches;
+      typename PivotTable<Target, DistanceMetric>::ScanContext m_scan;
+    };
+
     LinearFuzzyMatcher() = default;
 
     template <typename Iterator>
-    explicit LinearFuzzyMatcher(Iterator begin, Iterator end, DistanceMetric distance)
-      : m_targets{begin, end},
-        m_distance{std::move(distance)}
+    explicit LinearFuzzyMatcher(Iterator begin, Iterator end, DistanceMetric distance)
+      : m_targets{begin, end},
+        m_distance{std::move(distance)}
+    { }
+
+    /**
+     * Create a @c LinearFuzzyMatcher that skips the targets a @c PivotTable
+     * proves are too far from the search target.  This pays off when the
+     * metric is expensive, at the cost of <code>pivots</code> distance
+     * computations per search and per target up front.
+     *
+     * @param pivots  The number of pivots, chosen among the initial targets.
+     */
+    template <typename Iterator>
+    explicit LinearFuzzyMatcher(Iterator begin, Iterator end, DistanceMetric distance, std::size_t pivots)
+      : m_targets{begin, end},
+        m_distance{std::move(distance)}
+    {
+      build_pivots(pivots);
+    }
+
+    virtual ~LinearFuzzyMatcher() = default;
+
+    LinearFuzzyMatcher(LinearFuzzyMatcher&& other) = default;
+    LinearFuzzyMatcher& operator=(LinearFuzzyMatcher&& other) = default;
+
+    /**
+     * @return true iff size == 0
+     */
+    virtual bool
+    empty() const
+    {
+      return m_targets.empty();
+    }
+
+    /**
+     * @return The number of targets.
+     */
+    virtual size_t
+    size() const
+    {
+      return m_targets.size();
+    }
+
+    /**
+     * Add a target.  Matches found before the insertion are invalidated.
+     */
+    void
+    insert(Target target)
+    {
+      if (m_pivots.pivots() > 0) {
+        m_pivots.push_back(target, m_distance);
+      }
+      m_targets.push_back(std::move(target));
+    }
+
+    /**
+     * Remove the targets at distance zero from @p key for which @p pred
+     * returns @c true.  Matches found before the erasure are invalidated.
+     *
+     * @return The number of targets removed.
+     */
+    template <typename T, typename Predicate>
+    size_t
+    erase(const T& key, Predicate pred)
+    {
+      std::vector<bool> removed(m_targets.size());
+      size_t kept = 0;
+      for (size_t i = 0; i < m_targets.size(); ++i) {
+        removed[i] = pred(m_targets[i]) && m_distance(m_targets[i], key) == 0;
+        if (!removed[i]) {
+          if (kept != i) {
+            m_targets[kept] = std::move(m_targets[i]);
+          }
+          ++kept;
+        }
+      }
+      size_t count = m_targets.size() - kept;
+      m_targets.erase(m_targets.begin() + kept, m_targets.end());
+      if (m_pivots.pivots() > 0) {
+        m_pivots.erase_rows(removed);
+      }
+      return count;
+    }
+
+    /**
+     * Remove the targets equal to @p target, which must be at distance zero
+     * from it.
+     *
+     * @return The number of targets removed.
+     */
+    size_t
+    erase(const Target& target)
+    {
+      return erase(target, [&target](const Target& other) { return other == target; });
+    }
+
+    /**
+     * Choose new pivots among the current targets, replacing any pivot table,
+     * e.g. after loading a snapshot, which doesn't save them.  Targets
+     * inserted later are added to the table, but the pivots stay the same.
+     *
+     * @param pivots  The number of pivots, or 0 to drop the pivot table.
+     */
+    void
+    build_pivots(std::size_t pivots)
+    {
+      m_pivots = PivotTable<Target, DistanceMetric>{m_targets.cbegin(), m_targets.cend(), m_distance, pivots};
+    }
+
+    /**
+     * @return The distance computations made and avoided by searches through
+     *         the pivot table since it was built.
+     */
+    PivotTableStats
+    pivot_stats() const
+    {
+      return m_pivots.stats();
+    }
+
+    /**
+     * @return The counts of every search since construction or the last
+     *         @c reset_search_stats(), all zero unless built with
+     *         @c MALUUBA_SEARCH_STATS.  Each target compared counts as a
+     *         visited node, and each target the pivot table skips as a pruned
+     *         one.
+     */
+    SearchStats
+    search_stats() const
+    {
+      return m_stats.stats();
+    }
+
+    /**
+     * Zero the counts returned by @c search_stats().
+     */
+    void
+    reset_search_stats()
+    {
+      m_stats.reset();
+    }
+
+    /**
+     * Save the targets to a snapshot.
+     *
+     * @param writer  The snapshot to write to.
+     * @param write_target  Called as <code>write_target(writer, target)</code>
+     *                      for each target.
+     */
+    template <typename TargetWriter>
+    void
+    save(SnapshotWriter& writer, TargetWriter&& write_target) const
+    {
+      writer.write_u64(m_targets.size());
+      for (const auto& target : m_targets) {
+        write_target(writer, target);
+      }
+    }
+
+    /**
+     * Load a matcher saved by @c save().
+     *
+     * @param reader  The snapshot to read from.
+     * @param read_target  Called as <code>read_target(reader)</code> to read
+     *                     each target written by @c save().
+     * @param distance  The distance metric.
+     * @throws std::runtime_error  If the snapshot is malformed.
+     */
+    template <typename TargetReader>
+    static LinearFuzzyMatcher
+    load(SnapshotReader& reader, TargetReader&& read_target, DistanceMetric distance)
+    {
+      std::vector<Target> targets;
+      auto count = reader.read_count();
+      targets.reserve(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        targets.push_back(read_target(reader));
+      }
+      return LinearFuzzyMatcher{std::move(targets), std::move(distance)};
+    }
+
+    /**
+     * Find the nearest element.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @return The closest match to @p target, or @c nullopt if the matcher was empty.
+     */
+    template <typename T>
+    xtd::optional<Match>
+    find_nearest(const T& target) const
+    {
+      auto matches = find_k_nearest_within(target, 1, std::numeric_limits<double>::infinity());
+      if (matches.empty()) {
+        return xtd::nullopt;
+      } else {
+        return matches.front();
+      }
+    }
+
+    /**
+     * Find the nearest element.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @return The closest match to @p target within @p limit, or @c nullopt if
+     *         no match is found.
+     */
+    template <typename T>
+    xtd::optional<Match>
+    find_nearest_within(const T& target, double limit) const
+    {
+      auto matches = find_k_nearest_within(target, 1, limit);
+      if (matches.empty()) {
+        return xtd::nullopt;
+      } else {
+        return matches.front();
+      }
+    }
+
+    /**
+     * Find the @p k nearest elements.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @return The @p k nearest elements to @p target.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_k_nearest(const T& target, size_t k) const
+    {
+      return find_k_nearest_within(target, k, std::numeric_limits<double>::infinity());
+    }
+
+    /**
+     * Find the @p k nearest elements.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @return The @p k nearest elements to @p target within @p limit.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_k_nearest_within(const T& target, size_t k, double limit) const
+    {
+      return find_k_nearest_within(target, k, limit, VpTreeSearchOptions{});
+    }
+
+    /**
+     * Find the @p k nearest elements, within the evaluation and time limits
+     * of @p options.  The other options don't apply to a linear scan.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param options  The limits on the search.
+     * @param[out] exact  If not null, set to whether every target was
+     *                    compared.
+     * @return The @p k nearest elements to @p target within @p limit, among
+     *         those compared.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_k_nearest_within(const T& target, size_t k, double limit, const VpTreeSearchOptions& options, bool* exact = nullptr) const
+    {
+      check(k > 0, "k must be > 0");
+
+      SearchContext context;
+      search(target, k, limit, options, exact, context);
+      return std::move(context.m_matches);
+    }
+
+    /**
+     * Find the @p k nearest elements, passing them to @p sink rather than
+     * collecting them.  Once the buffers in @p context have grown to fit,
+     * this doesn't allocate.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param context  The scratch space for the search.
+     * @param sink  Called as <code>sink(element, distance)</code> for each
+     *              match, nearest first.
+     * @param options  The limits on the search.
+     * @param[out] exact  If not null, set to whether every target was
+     *                    compared.
+     * @return The number of matches.
+     */
+    template <typename T, typename Sink>
+    size_t
+    find_k_nearest_within(const T& target, size_t k, double limit, SearchContext& context, Sink&& sink, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      check(k > 0, "k must be > 0");
+
+      search(target, k, limit, options, exact, context);
+      for (const auto& match : context.m_matches) {
+        sink(match.element(), match.distance());
+      }
+      return context.m_matches.size();
+    }
+
+    /**
+     * Find every element within a distance of a target.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @return The elements within @p limit of @p target, nearest first.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_all_within(const T& target, double limit) const
+    {
+      std::vector<Match> matches;
+      visit_within(target, limit, [&](const Target& element, double distance) {
+        matches.emplace_back(element, distance);
+      });
+      std::stable_sort(matches.begin(), matches.end());
+      return matches;
+    }
+
+    /**
+     * Call <code>visitor(element, distance)</code> for every element within
+     * a distance of a target, in no particular order, without collecting
+     * them.  The matcher must not be modified until the visit returns.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @param visitor  Called for each match.
+     */
+    template <typename T, typename Visitor>
+    void
+    visit_within(const T& target, double limit, Visitor&& visitor) const
+    {
+      SearchRecorder recorder{m_stats};
+      if (m_pivots.pivots() > 0) {
+        typename PivotTable<Target, DistanceMetric>::ScanContext context;
+        m_pivots.scan(m_targets.cbegin(), target, m_distance, [&] { return limit; }, [&](size_t i, double distance) {
+          if (distance <= limit) {
+            visitor(m_targets[i], distance);
+          }
+          return true;
+        }, context, recorder);
+      } else if constexpr (IsBatchMetric<DistanceMetric, T, TargetIterator, double*, double>::value) {
+        constexpr std::size_t block_size = 64;
+        double distances[block_size];
+        for (auto block = m_targets.cbegin(); block != m_targets.cend();) {
+          auto block_end = block + std::min<std::size_t>(block_size, m_targets.cend() - block);
+          recorder.visit(block_end - block);
+          recorder.metric(block_end - block, [&] {
+            distance_many(m_distance, target, block, block_end, distances, limit);
+          });
+          for (auto i = block; i != block_end; ++i) {
+            if (distances[i - block] <= limit) {
+              visitor(*i, distances[i - block]);
+            }
+          }
+          block = block_end;
+        }
+      } else {
+        for (const auto& element : m_targets) {
+          recorder.visit();
+          auto distance = recorder.metric(1, [&] { return bounded_distance(m_distance, element, target, limit); });
+          if (distance <= limit) {
+            visitor(element, distance);
+          }
+        }
+      }
+    }
+
+    /**
+     * Find the @p k nearest elements to each of a batch of queries, in
+     * parallel.  @c DistanceMetric must be safe to call concurrently.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param queries  The search targets.
+     * @param k The maximum number of result to return per query.
+     * @param limit  The maximum distance to a match.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @return The @p k nearest elements to each query within @p limit.
+     */
+    template <typename T>
+    BatchMatches
+    find_k_nearest_within_batch(const std::vector<T>& queries, size_t k, double limit, std::size_t threads = 0) const
+    {
+      check(k > 0, "k must be > 0");
+      return this->template find_batch<SearchContext>(queries.size(), threads, [&](size_t i, SearchContext& context, auto& sink) {
+        find_k_nearest_within(queries[i], k, limit, context, sink);
+      });
+    }
+
+    /**
+     * Find the @p k nearest elements to each of a batch of queries, each with
+     * its own limit, in parallel.  @c DistanceMetric must be safe to call
+     * concurrently.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param queries  The search targets.
+     * @param k The maximum number of result to return per query.
+     * @param limits  The maximum distance to a match for each query.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @return The @p k nearest elements to each query within its limit.
+     */
+    template <typename T>
+    BatchMatches
+    find_k_nearest_within_batch(const std::vector<T>& queries, size_t k, const std::vector<double>& limits, std::size_t threads = 0) const
+    {
+      check(k > 0, "k must be > 0");
+      check(limits.size() == queries.size(), "Expected one limit per query.");
+      return this->template find_batch<SearchContext>(queries.size(), threads, [&](size_t i, SearchContext& context, auto& sink) {
+        find_k_nearest_within(queries[i], k, limits[i], context, sink);
+      });
+    }
+
+  private:
+    using TargetIterator = typename std::vector<Target>::const_iterator;
+
+    std::vector<Target> m_targets;
+    DistanceMetric m_distance;
+    /** Rows for each target if the matcher has pivots, otherwise empty. */
+    PivotTable<Target, DistanceMetric> m_pivots;
+    mutable SearchStatsCounter m_stats;
+
+    explicit LinearFuzzyMatcher(std::vector<Target> targets, DistanceMetric distance)
+      : m_targets{std::move(targets)},
+        m_distance{std::move(distance)}
+    { }
+
+    /**
+     * Find the @p k nearest elements, leaving them in
+     * <code>context.m_matches</code>, nearest first.
+     */
+    template <typename T>
+    void
+    search(const T& target, size_t k, double limit, const VpTreeSearchOptions& options, bool* exact, SearchContext& context) const
+    {
+      SearchRecorder recorder{m_stats};
+      VpTreeSearchBudget budget{options};
+      auto scanned = m_targets.cbegin();
+      auto& matches = context.m_matches;
+      matches.clear();
+      if (m_pivots.pivots() > 0) {
+        auto rows = m_pivots.scan(m_targets.cbegin(), target, m_distance, [&] { return bound(matches, k, limit); }, [&](size_t i, double current) {
+          budget.take(1);
+          add_match(matches, k, limit, m_targets[i], current);
+          return !budget.exhausted();
+        }, context.m_scan, recorder);
+        scanned += rows;
+      } else if constexpr (IsBatchMetric<DistanceMetric, T, TargetIterator, double*, double>::value) {
+        // Score whole blocks of targets at once, pruned by the bound at the
+        // start of each block
+        constexpr std::size_t block_size = 64;
+        double distances[block_size];
+        while (scanned != m_targets.cend() && !budget.exhausted()) {
+          auto block = scanned;
+          auto block_end = block + budget.take(std::min<std::size_t>(block_size, m_targets.cend() - block));
+          recorder.visit(block_end - block);
+          recorder.metric(block_end - block, [&] {
+            distance_many(m_distance, target, block, block_end, distances, bound(matches, k, limit));
+          });
+          for (auto i = block; i != block_end; ++i) {
+            add_match(matches, k, limit, *i, distances[i - block]);
+          }
+          scanned = block_end;
+        }
+      } else {
+        for (; scanned != m_targets.cend() && !budget.exhausted(); ++scanned) {
+          budget.take(1);
+          recorder.visit();
+          auto current = recorder.metric(1, [&] { return bounded_distance(m_distance, *scanned, target, bound(matches, k, limit)); });
+          add_match(matches, k, limit, *scanned, current);
+        }
+      }
+      std::sort_heap(matches.begin(), matches.end());
+
+      if (exact) {
+        *exact = scanned == m_targets.cend();
+      }
+    }
+
+    /** @return The distance beyond which a target cannot enter @p matches. */
+    static double
+    bound(const std::vector<Match>& matches, size_t k, double limit)
+    {
+      return matches.size() < k ? limit : std::min(limit, matches.front().distance());
+    }
+
+    /** Add a target to the max-heap @p matches of the @p k nearest, if it belongs there. */
+    static void
+    add_match(std::vector<Match>& matches, size_t k, double limit, const Target& possible_match, double current)
+    {
+      if (current <= limit) {
+        if (matches.size() < k || current < matches.front().distance()) {
+          if (matches.size() >= k) {
+            std::pop_heap(matches.begin(), matches.end());
+            matches.pop_back();
+          }
+          matches.emplace_back(possible_match, current);
+          std::push_heap(matches.begin(), matches.end());
+        }
+      }
+    }
+  };
+
+  /**
+   * A fuzzy matcher that compares the target to a precomputed data structure of the stored elements
+   * to minimize the number of comparisons.
+   *
+   * @tparam Target  The type of element to store.
+   * @tparam DistanceMetric  The metric used to compare elements.
+   */
+  template <typename Target, typename DistanceMetric>
+  class AcceleratedFuzzyMatcher: public FuzzyMatcher<Target>
+  {
+    using Match = typename FuzzyMatcher<Target>::Match;
+    using BatchMatches = typename FuzzyMatcher<Target>::BatchMatches;
+
+  public:
+    /** Scratch space for searches.  Keep one per thread. */
+    using SearchContext = typename VpTree<Target, DistanceMetric>::SearchContext;
+
+    AcceleratedFuzzyMatcher() = default;
+
+    template <typename Iterator>
+    explicit AcceleratedFuzzyMatcher(Iterator begin, Iterator end, DistanceMetric distance)
+      : m_vptree{begin, end, std::move(distance)}
+    { }
+
+    /**
+     * Create an @c AcceleratedFuzzyMatcher, building its index with the given
+     * @p options (e.g. on several threads).
+     */
+    template <typename Iterator>
+    explicit AcceleratedFuzzyMatcher(Iterator begin, Iterator end, DistanceMetric distance, const VpTreeOptions& options)
+      : m_vptree{begin, end, std::move(distance), options}
     { }
 
-    virtual ~LinearFuzzyMatcher() = default;
+    virtual ~AcceleratedFuzzyMatcher() = default;
 
-    LinearFuzzyMatcher(LinearFuzzyMatcher&& other) = default;
-    LinearFuzzyMatcher& operator=(LinearFuzzyMatcher&& other) = default;
+    AcceleratedFuzzyMatcher(AcceleratedFuzzyMatcher&& other) = default;
+    AcceleratedFuzzyMatcher& operator=(AcceleratedFuzzyMatcher&& other) = default;
 
     /**
      * @return true iff size == 0
@@ -114,16 +776,112 @@ namespace speech
     virtual bool
     empty() const
     {
-      return m_targets.empty();
+      return m_vptree.empty();
     }
 
     /**
-     * @return The number of targets constructed with.
+     * @return The number of targets.
      */
     virtual size_t
     size() const
     {
-      return m_targets.size();
+      return m_vptree.size();
+    }
+
+    /**
+     * Add a target, without rebuilding the whole index.  Matches found before
+     * the insertion are invalidated.
+     */
+    void
+    insert(Target target)
+    {
+      m_vptree.insert(std::move(target));
+    }
+
+    /**
+     * Remove the targets at distance zero from @p key for which @p pred
+     * returns @c true.  Matches found before the erasure are invalidated.
+     *
+     * @return The number of targets removed.
+     */
+    template <typename T, typename Predicate>
+    size_t
+    erase(const T& key, Predicate pred)
+    {
+      return m_vptree.erase(key, std::move(pred));
+    }
+
+    /**
+     * Remove the targets equal to @p target, which must be at distance zero
+     * from it.
+     *
+     * @return The number of targets removed.
+     */
+    size_t
+    erase(const Target& target)
+    {
+      return m_vptree.erase(target);
+    }
+
+    /**
+     * @return The counts of every search since construction or the last
+     *         @c reset_search_stats(), all zero unless built with
+     *         @c MALUUBA_SEARCH_STATS.
+     */
+    SearchStats
+    search_stats() const
+    {
+      return m_vptree.search_stats();
+    }
+
+    /**
+     * Zero the counts returned by @c search_stats().
+     */
+    void
+    reset_search_stats()
+    {
+      m_vptree.reset_search_stats();
+    }
+
+    /**
+     * @return The shape of the index.
+     */
+    VpTreeShape
+    tree_shape() const
+    {
+      return m_vptree.shape();
+    }
+
+    /**
+     * Save the targets and the built index to a snapshot.
+     *
+     * @param writer  The snapshot to write to.
+     * @param write_target  Called as <code>write_target(writer, target)</code>
+     *                      for each target.
+     */
+    template <typename TargetWriter>
+    void
+    save(SnapshotWriter& writer, TargetWriter&& write_target) const
+    {
+      m_vptree.save(writer, std::forward<TargetWriter>(write_target));
+    }
+
+    /**
+     * Load a matcher saved by @c save(), without rebuilding its index.
+     *
+     * @param reader  The snapshot to read from.
+     * @param read_target  Called as <code>read_target(reader)</code> to read
+     *                     each target written by @c save().
+     * @param distance  The distance metric, which must match the saved one.
+     * @param threads  The number of threads for rebuilds after later
+     *                 insertions and erasures.
+     * @throws std::runtime_error  If the snapshot is malformed.
+     */
+    template <typename TargetReader>
+    static AcceleratedFuzzyMatcher
+    load(SnapshotReader& reader, TargetReader&& read_target, DistanceMetric distance, std::size_t threads = 1)
+    {
+      return AcceleratedFuzzyMatcher{VpTree<Target, DistanceMetric>::load(reader, std::forward<TargetReader>(read_target), std::move(distance), threads)};
     }
 
     /**
@@ -193,56 +951,182 @@ namespace speech
     template <typename T>
     std::vector<Match>
     find_k_nearest_within(const T& target, size_t k, double limit) const
+    {
+      return find_k_nearest_within(target, k, limit, VpTreeSearchOptions{});
+    }
+
+    /**
+     * Find the @p k nearest elements, possibly approximately.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param options  How to search, and the limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The @p k nearest elements to @p target within @p limit, as far
+     *         as the search got.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_k_nearest_within(const T& target, size_t k, double limit, const VpTreeSearchOptions& options, bool* exact = nullptr) const
+    {
+      SearchContext context;
+      std::vector<Match> results;
+      find_k_nearest_within(target, k, limit, context, [&](const Target& element, double distance) {
+        results.emplace_back(element, distance);
+      }, options, exact);
+      return results;
+    }
+
+    /**
+     * Find the @p k nearest elements, passing them to @p sink rather than
+     * collecting them.  Once the buffers in @p context have grown to fit,
+     * this doesn't allocate.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param context  The scratch space for the search.
+     * @param sink  Called as <code>sink(element, distance)</code> for each
+     *              match, nearest first.
+     * @param options  How to search, and the limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The number of matches.
+     */
+    template <typename T, typename Sink>
+    size_t
+    find_k_nearest_within(const T& target, size_t k, double limit, SearchContext& context, Sink&& sink, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
     {
       check(k > 0, "k must be > 0");
+      return m_vptree.find_k_nearest_within(target, k, limit, context, std::forward<Sink>(sink), options, exact);
+    }
 
-      std::vector<Match> matches;
-      for (const auto& possible_match: m_targets) {
-        auto current = m_distance(possible_match, target);
-        if (current <= limit) {
-          if (matches.size() < k || current < matches.front().distance()) {
-            if (matches.size() >= k) {
-              std::pop_heap(matches.begin(), matches.end());
-              matches.pop_back();
-            }
-            matches.emplace_back(possible_match, current);
-            std::push_heap(matches.begin(), matches.end());
-          }
-        }
+    /**
+     * Find every element within a distance of a target.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @return The elements within @p limit of @p target, nearest first.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_all_within(const T& target, double limit) const
+    {
+      auto matches = m_vptree.find_all_within(target, limit);
+      std::vector<Match> results;
+      results.reserve(matches.size());
+      for (const auto& match: matches) {
+        results.emplace_back(match.element(), match.distance());
       }
-      std::sort_heap(matches.begin(), matches.end());
-      return matches;
+      return results;
+    }
+
+    /**
+     * Call <code>visitor(element, distance)</code> for every element within
+     * a distance of a target, in no particular order, without collecting
+     * them.  The matcher must not be modified until the visit returns.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @param visitor  Called for each match.
+     */
+    template <typename T, typename Visitor>
+    void
+    visit_within(const T& target, double limit, Visitor&& visitor) const
+    {
+      m_vptree.visit_within(target, limit, std::forward<Visitor>(visitor));
+    }
+
+    /**
+     * Find the @p k nearest elements to each of a batch of queries, in
+     * parallel.  @c DistanceMetric must be safe to call concurrently.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param queries  The search targets.
+     * @param k The maximum number of result to return per query.
+     * @param limit  The maximum distance to a match.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @return The @p k nearest elements to each query within @p limit.
+     */
+    template <typename T>
+    BatchMatches
+    find_k_nearest_within_batch(const std::vector<T>& queries, size_t k, double limit, std::size_t threads = 0) const
+    {
+      check(k > 0, "k must be > 0");
+      return this->template find_batch<SearchContext>(queries.size(), threads, [&](size_t i, SearchContext& context, auto& sink) {
+        find_k_nearest_within(queries[i], k, limit, context, sink);
+      });
+    }
+
+    /**
+     * Find the @p k nearest elements to each of a batch of queries, each with
+     * its own limit, in parallel.  @c DistanceMetric must be safe to call
+     * concurrently.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param queries  The search targets.
+     * @param k The maximum number of result to return per query.
+     * @param limits  The maximum distance to a match for each query.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @return The @p k nearest elements to each query within its limit.
+     */
+    template <typename T>
+    BatchMatches
+    find_k_nearest_within_batch(const std::vector<T>& queries, size_t k, const std::vector<double>& limits, std::size_t threads = 0) const
+    {
+      check(k > 0, "k must be > 0");
+      check(limits.size() == queries.size(), "Expected one limit per query.");
+      return this->template find_batch<SearchContext>(queries.size(), threads, [&](size_t i, SearchContext& context, auto& sink) {
+        find_k_nearest_within(queries[i], k, limits[i], context, sink);
+      });
     }
 
   private:
-    std::vector<Target> m_targets;
-    DistanceMetric m_distance;
+    VpTree<Target, DistanceMetric> m_vptree;
+
+    explicit AcceleratedFuzzyMatcher(VpTree<Target, DistanceMetric> vptree)
+      : m_vptree{std::move(vptree)}
+    { }
   };
 
   /**
-   * A fuzzy matcher that compares the target to a precomputed data structure of the stored elements
-   * to minimize the number of comparisons.
+   * A fuzzy matcher that indexes the stored elements in a @c BkTree.  This
+   * suits metrics with small integer distances, like unit-cost Levenshtein
+   * distance, which tie too often for the median splits of the
+   * @c AcceleratedFuzzyMatcher.
    *
    * @tparam Target  The type of element to store.
    * @tparam DistanceMetric  The metric used to compare elements.
    */
   template <typename Target, typename DistanceMetric>
-  class AcceleratedFuzzyMatcher: public FuzzyMatcher<Target>
+  class BkTreeFuzzyMatcher: public FuzzyMatcher<Target>
   {
     using Match = typename FuzzyMatcher<Target>::Match;
+    using BatchMatches = typename FuzzyMatcher<Target>::BatchMatches;
 
   public:
-    AcceleratedFuzzyMatcher() = default;
+    /** Scratch space for searches.  Keep one per thread. */
+    using SearchContext = typename BkTree<Target, DistanceMetric>::SearchContext;
+
+    BkTreeFuzzyMatcher() = default;
 
     template <typename Iterator>
-    explicit AcceleratedFuzzyMatcher(Iterator begin, Iterator end, DistanceMetric distance)
-      : m_vptree{begin, end, std::move(distance)}
+    explicit BkTreeFuzzyMatcher(Iterator begin, Iterator end, DistanceMetric distance)
+      : m_bktree{begin, end, std::move(distance)}
     { }
 
-    virtual ~AcceleratedFuzzyMatcher() = default;
+    virtual ~BkTreeFuzzyMatcher() = default;
 
-    AcceleratedFuzzyMatcher(AcceleratedFuzzyMatcher&& other) = default;
-    AcceleratedFuzzyMatcher& operator=(AcceleratedFuzzyMatcher&& other) = default;
+    BkTreeFuzzyMatcher(BkTreeFuzzyMatcher&& other) = default;
+    BkTreeFuzzyMatcher& operator=(BkTreeFuzzyMatcher&& other) = default;
 
     /**
      * @return true iff size == 0
@@ -250,16 +1134,101 @@ namespace speech
     virtual bool
     empty() const
     {
-      return m_vptree.empty();
+      return m_bktree.empty();
     }
 
     /**
-     * @return The number of targets constructed with.
+     * @return The number of targets.
      */
     virtual size_t
     size() const
     {
-      return m_vptree.size();
+      return m_bktree.size();
+    }
+
+    /**
+     * Add a target, without rebuilding the whole index.  Matches found before
+     * the insertion are invalidated.
+     */
+    void
+    insert(Target target)
+    {
+      m_bktree.insert(std::move(target));
+    }
+
+    /**
+     * Remove the targets at distance zero from @p key for which @p pred
+     * returns @c true.  Matches found before the erasure are invalidated.
+     *
+     * @return The number of targets removed.
+     */
+    template <typename T, typename Predicate>
+    size_t
+    erase(const T& key, Predicate pred)
+    {
+      return m_bktree.erase(key, std::move(pred));
+    }
+
+    /**
+     * Remove the targets equal to @p target, which must be at distance zero
+     * from it.
+     *
+     * @return The number of targets removed.
+     */
+    size_t
+    erase(const Target& target)
+    {
+      return m_bktree.erase(target);
+    }
+
+    /**
+     * @return The counts of every search since construction or the last
+     *         @c reset_search_stats(), all zero unless built with
+     *         @c MALUUBA_SEARCH_STATS.
+     */
+    SearchStats
+    search_stats() const
+    {
+      return m_bktree.search_stats();
+    }
+
+    /**
+     * Zero the counts returned by @c search_stats().
+     */
+    void
+    reset_search_stats()
+    {
+      m_bktree.reset_search_stats();
+    }
+
+    /**
+     * Save the targets and the built index to a snapshot.
+     *
+     * @param writer  The snapshot to write to.
+     * @param write_target  Called as <code>write_target(writer, target)</code>
+     *                      for each target.
+     */
+    template <typename TargetWriter>
+    void
+    save(SnapshotWriter& writer, TargetWriter&& write_target) const
+    {
+      m_bktree.save(writer, std::forward<TargetWriter>(write_target));
+    }
+
+    /**
+     * Load a matcher saved by @c save(), without rebuilding its index.
+     *
+     * @param reader  The snapshot to read from.
+     * @param read_target  Called as <code>read_target(reader)</code> to read
+     *                     each target written by @c save().
+     * @param distance  The distance metric, which must match the saved one.
+     * @throws std::runtime_error  If the snapshot is malformed.
+     */
+    template <typename TargetReader>
+    static BkTreeFuzzyMatcher
+    load(SnapshotReader& reader, TargetReader&& read_target, DistanceMetric distance)
+    {
+      return BkTreeFuzzyMatcher{BkTree<Target, DistanceMetric>::load(reader, std::forward<TargetReader>(read_target), std::move(distance))};
     }
 
     /**
@@ -329,19 +1298,150 @@ namespace speech
     template <typename T>
     std::vector<Match>
     find_k_nearest_within(const T& target, size_t k, double limit) const
+    {
+      return find_k_nearest_within(target, k, limit, VpTreeSearchOptions{});
+    }
+
+    /**
+     * Find the @p k nearest elements, possibly approximately.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param options  How to search, and the limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The @p k nearest elements to @p target within @p limit, as far
+     *         as the search got.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_k_nearest_within(const T& target, size_t k, double limit, const VpTreeSearchOptions& options, bool* exact = nullptr) const
+    {
+      SearchContext context;
+      std::vector<Match> results;
+      find_k_nearest_within(target, k, limit, context, [&](const Target& element, double distance) {
+        results.emplace_back(element, distance);
+      }, options, exact);
+      return results;
+    }
+
+    /**
+     * Find the @p k nearest elements, passing them to @p sink rather than
+     * collecting them.  Once the buffers in @p context have grown to fit,
+     * this doesn't allocate.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param k The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param context  The scratch space for the search.
+     * @param sink  Called as <code>sink(element, distance)</code> for each
+     *              match, nearest first.
+     * @param options  How to search, and the limits on the search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The number of matches.
+     */
+    template <typename T, typename Sink>
+    size_t
+    find_k_nearest_within(const T& target, size_t k, double limit, SearchContext& context, Sink&& sink, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
     {
       check(k > 0, "k must be > 0");
+      return m_bktree.find_k_nearest_within(target, k, limit, context, std::forward<Sink>(sink), options, exact);
+    }
 
-      auto matches = m_vptree.find_k_nearest_within(target, k, limit);
+    /**
+     * Find every element within a distance of a target.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @return The elements within @p limit of @p target, nearest first.
+     */
+    template <typename T>
+    std::vector<Match>
+    find_all_within(const T& target, double limit) const
+    {
+      auto matches = m_bktree.find_all_within(target, limit);
       std::vector<Match> results;
+      results.reserve(matches.size());
       for (const auto& match: matches) {
         results.emplace_back(match.element(), match.distance());
       }
       return results;
     }
 
+    /**
+     * Call <code>visitor(element, distance)</code> for every element within
+     * a distance of a target, in no particular order, without collecting
+     * them.  The matcher must not be modified until the visit returns.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @param visitor  Called for each match.
+     */
+    template <typename T, typename Visitor>
+    void
+    visit_within(const T& target, double limit, Visitor&& visitor) const
+    {
+      m_bktree.visit_within(target, limit, std::forward<Visitor>(visitor));
+    }
+
+    /**
+     * Find the @p k nearest elements to each of a batch of queries, in
+     * parallel.  @c DistanceMetric must be safe to call concurrently.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param queries  The search targets.
+     * @param k The maximum number of result to return per query.
+     * @param limit  The maximum distance to a match.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @return The @p k nearest elements to each query within @p limit.
+     */
+    template <typename T>
+    BatchMatches
+    find_k_nearest_within_batch(const std::vector<T>& queries, size_t k, double limit, std::size_t threads = 0) const
+    {
+      check(k > 0, "k must be > 0");
+      return this->template find_batch<SearchContext>(queries.size(), threads, [&](size_t i, SearchContext& context, auto& sink) {
+        find_k_nearest_within(queries[i], k, limit, context, sink);
+      });
+    }
+
+    /**
+     * Find the @p k nearest elements to each of a batch of queries, each with
+     * its own limit, in parallel.  @c DistanceMetric must be safe to call
+     * concurrently.
+     *
+     * @tparam T  To be compatible with @c DistanceMetric.
+     * @param queries  The search targets.
+     * @param k The maximum number of result to return per query.
+     * @param limits  The maximum distance to a match for each query.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @return The @p k nearest elements to each query within its limit.
+     */
+    template <typename T>
+    BatchMatches
+    find_k_nearest_within_batch(const std::vector<T>& queries, size_t k, const std::vector<double>& limits, std::size_t threads = 0) const
+    {
+      check(k > 0, "k must be > 0");
+      check(limits.size() == queries.size(), "Expected one limit per query.");
+      return this->template find_batch<SearchContext>(queries.size(), threads, [&](size_t i, SearchContext& context, auto& sink) {
+        find_k_nearest_within(queries[i], k, limits[i], context, sink);
+      });
+    }
+
   private:
-    VpTree<Target, DistanceMetric> m_vptree;
+    BkTree<Target, DistanceMetric> m_bktree;
+
+    explicit BkTreeFuzzyMatcher(BkTree<Target, DistanceMetric> bktree)
+      : m_bktree{std::move(bktree)}
+    { }
   };
 }
 }
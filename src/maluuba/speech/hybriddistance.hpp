@@ -12,6 +12,7 @@
 #include "maluuba/speech/phoneticdistance.hpp"
 #include "maluuba/debug.hpp"
 #include "maluuba/levenshtein.hpp"
+#include "maluuba/metric.hpp"
 
 namespace maluuba
 {
@@ -66,6 +67,46 @@ namespace speech
       return phonetic_weight + string_weight;
     }
 
+    /**
+     * @return The combined phonetic and lexical distance between @p a and @p b
+     *         if it is at most @p limit, otherwise a lower bound for it that
+     *         exceeds @p limit.  The remaining budget is passed on to each
+     *         component distance.
+     */
+    template <typename StringInput, typename PhoneticInput>
+    double operator()(const StringInput& a_string, const PhoneticInput& a_pronunciation, const StringInput& b_string, const PhoneticInput& b_pronunciation, double limit) const
+    {
+      // A component that exceeds its rescaled limit only gives a lower bound.
+      // Rescaling can round, so the computation is only abandoned if the
+      // weighted sum so far is strictly over the limit; otherwise the
+      // component is computed exactly, as the unbounded distance would.
+      double string_weight = 0.0;
+      double phonetic_weight = 0.0;
+      if (m_phonetic_weight_percentage > 0.0) {
+        auto phonetic_limit = limit / m_phonetic_weight_percentage;
+        auto phonetic_distance = bounded_distance(m_phonetic_distance, a_pronunciation, b_pronunciation, phonetic_limit);
+        phonetic_weight = m_phonetic_weight_percentage * phonetic_distance;
+        if (phonetic_distance > phonetic_limit) {
+          if (phonetic_weight > limit) {
+            return phonetic_weight;
+          }
+          phonetic_weight = m_phonetic_weight_percentage * m_phonetic_distance(a_pronunciation, b_pronunciation);
+        }
+      }
+      if (m_phonetic_weight_percentage < 1.0) {
+        auto string_limit = (limit - phonetic_weight) / (1.0 - m_phonetic_weight_percentage);
+        auto string_distance = bounded_distance(m_string_distance, a_string, b_string, string_limit);
+        string_weight = (1.0 - m_phonetic_weight_percentage) * string_distance;
+        if (string_distance > string_limit) {
+          if (phonetic_weight + string_weight > limit) {
+            return phonetic_weight + string_weight;
+          }
+          string_weight = (1.0 - m_phonetic_weight_percentage) * m_string_distance(a_string, b_string);
+        }
+      }
+      return phonetic_weight + string_weight;
+    }
+
   private:
     double m_phonetic_weight_percentage;
     StringDistance m_string_distance;
@@ -112,6 +112,13 @@ namespace nodejs
       return;
     }
 
+    auto has_limit = args.Length() > 2 && !args[2]->IsUndefined();
+    if (has_limit && !args[2]->IsNumber()) {
+      isolate->ThrowException(v8::Exception::TypeError(
+          v8::String::NewFromUtf8(isolate, "Expected 'limit' to be a number.")));
+      return;
+    }
+
     auto obj = ObjectWrap::Unwrap<EnHybridDistance>(args.Holder());
     auto phrase_key = v8::String::NewFromUtf8(isolate, "phrase");
     auto pronunciation_key = v8::String::NewFromUtf8(isolate, "pronunciation");
@@ -137,7 +144,13 @@ namespace nodejs
       }
       auto a_pronunciation = node::ObjectWrap::Unwrap<EnPronunciation>(a_wrap_pronunciation.As<v8::Object>())->pronunciation();
       auto b_pronunciation = node::ObjectWrap::Unwrap<EnPronunciation>(b_wrap_pronunciation.As<v8::Object>())->pronunciation();
-      auto distance = obj->distance()(a_phrase, a_pronunciation, b_phrase, b_pronunciation);
+      double distance;
+      if (has_limit) {
+        auto limit = args[2]->NumberValue(isolate->GetCurrentContext()).FromJust();
+        distance = obj->distance()(a_phrase, a_pronunciation, b_phrase, b_pronunciation, limit);
+      } else {
+        distance = obj->distance()(a_phrase, a_pronunciation, b_phrase, b_pronunciation);
+      }
 
       args.GetReturnValue().Set(v8::Number::New(isolate, distance));
     } catch (const std::exception& e) {
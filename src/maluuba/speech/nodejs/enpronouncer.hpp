@@ -32,6 +32,11 @@ namespace nodejs
 
     static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
     static void Pronounce(const v8::FunctionCallbackInfo<v8::Value>& args);
+    static void PronounceAll(const v8::FunctionCallbackInfo<v8::Value>& args);
+    static void SetCacheBudget(const v8::FunctionCallbackInfo<v8::Value>& args);
+    static void CacheStats(const v8::FunctionCallbackInfo<v8::Value>& args);
+    static void ClearCache(const v8::FunctionCallbackInfo<v8::Value>& args);
+    static void CheckLexiconIndex(const v8::FunctionCallbackInfo<v8::Value>& args);
     static v8::Persistent<v8::Function> s_constructor;
     speech::EnPronouncer m_pronouncer;
   };
@@ -3,7 +3,9 @@
 
 #include "maluuba/speech/nodejs/enpronouncer.hpp"
 #include "maluuba/speech/nodejs/enpronunciation.hpp"
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace maluuba
 {
@@ -30,6 +32,11 @@ namespace nodejs
     tpl->InstanceTemplate()->SetInternalFieldCount(1);
 
     NODE_SET_PROTOTYPE_METHOD(tpl, "pronounce", Pronounce);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "pronounceAll", PronounceAll);
+    tpl->Set(isolate, "setCacheBudget", v8::FunctionTemplate::New(isolate, SetCacheBudget));
+    tpl->Set(isolate, "cacheStats", v8::FunctionTemplate::New(isolate, CacheStats));
+    tpl->Set(isolate, "clearCache", v8::FunctionTemplate::New(isolate, ClearCache));
+    tpl->Set(isolate, "checkLexiconIndex", v8::FunctionTemplate::New(isolate, CheckLexiconIndex));
 
     s_constructor.Reset(isolate, tpl->GetFunction(context).ToLocalChecked());
     exports->Set(context, v8::String::NewFromUtf8(isolate, "EnPronouncer"), tpl->GetFunction(context).ToLocalChecked());
@@ -41,7 +48,19 @@ namespace nodejs
     auto isolate = args.GetIsolate();
 
     if (args.IsConstructCall()) {
-      speech::EnPronouncer pronouncer{};
+      auto pipeline = speech::PronouncerPipeline::FULL;
+      if (args.Length() >= 1 && !args[0]->IsUndefined()) {
+        if (!args[0]->IsBoolean()) {
+          isolate->ThrowException(v8::Exception::TypeError(
+              v8::String::NewFromUtf8(isolate, "Expected lexicalOnly to be a boolean.")));
+          return;
+        }
+        if (args[0]->IsTrue()) {
+          pipeline = speech::PronouncerPipeline::LEXICAL;
+        }
+      }
+
+      speech::EnPronouncer pronouncer{pipeline};
       auto obj = new EnPronouncer(std::move(pronouncer));
       obj->Wrap(args.This());
       args.GetReturnValue().Set(args.This());
@@ -87,6 +106,120 @@ namespace nodejs
     }
   }
 
+  void
+  EnPronouncer::PronounceAll(const v8::FunctionCallbackInfo<v8::Value>& args)
+  {
+    auto isolate = args.GetIsolate();
+
+    if (args.Length() < 1) {
+      isolate->ThrowException(v8::Exception::TypeError(
+          v8::String::NewFromUtf8(isolate, "Expected 1 argument.")));
+      return;
+    }
+
+    if (!args[0]->IsArray()) {
+      isolate->ThrowException(v8::Exception::TypeError(
+          v8::String::NewFromUtf8(isolate, "Expected argument to be a string[].")));
+      return;
+    }
+
+    auto array_arg = args[0].As<v8::Array>();
+    std::vector<std::string> phrases;
+    phrases.reserve(array_arg->Length());
+    for (uint32_t i = 0; i < array_arg->Length(); ++i) {
+      auto wrap_phrase = array_arg->Get(i);
+      if (!wrap_phrase->IsString()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected argument to be a string[].")));
+        return;
+      }
+      v8::String::Utf8Value phrase{isolate, wrap_phrase};
+      phrases.emplace_back(*phrase);
+    }
+
+    auto obj = ObjectWrap::Unwrap<EnPronouncer>(args.Holder());
+    try {
+      auto pronunciations = obj->pronouncer().pronounce_all(phrases);
+
+      auto context = isolate->GetCurrentContext();
+      auto result = v8::Array::New(isolate, pronunciations.size());
+      for (size_t i = 0; i < pronunciations.size(); ++i) {
+        auto wrap = new EnPronunciation(std::move(pronunciations[i]));
+        const auto argc = 1;
+        v8::Local<v8::Value> argv[argc] = { v8::External::New(isolate, wrap) };
+        auto instance = EnPronunciation::constructor(isolate)->NewInstance(context, argc, argv).ToLocalChecked();
+        result->Set(i, instance);
+      }
+      args.GetReturnValue().Set(result);
+    } catch (const std::exception& e) {
+      isolate->ThrowException(v8::Exception::Error(
+          v8::String::NewFromUtf8(isolate, e.what())));
+      return;
+    }
+  }
+
+  void
+  EnPronouncer::SetCacheBudget(const v8::FunctionCallbackInfo<v8::Value>& args)
+  {
+    auto isolate = args.GetIsolate();
+
+    if (args.Length() < 1) {
+      isolate->ThrowException(v8::Exception::TypeError(
+          v8::String::NewFromUtf8(isolate, "Expected 1 argument.")));
+      return;
+    }
+
+    auto context = isolate->GetCurrentContext();
+    if (!args[0]->IsNumber() || args[0]->NumberValue(context).FromJust() < 0) {
+      isolate->ThrowException(v8::Exception::TypeError(
+          v8::String::NewFromUtf8(isolate, "Expected argument to be a non-negative number.")));
+      return;
+    }
+
+    speech::EnPronouncer::set_cache_budget(static_cast<std::size_t>(args[0]->NumberValue(context).FromJust()));
+  }
+
+  void
+  EnPronouncer::CacheStats(const v8::FunctionCallbackInfo<v8::Value>& args)
+  {
+    auto isolate = args.GetIsolate();
+
+    auto stats = speech::EnPronouncer::cache_stats();
+    auto result = v8::Object::New(isolate);
+    result->Set(v8::String::NewFromUtf8(isolate, "hits"), v8::Number::New(isolate, stats.hits));
+    result->Set(v8::String::NewFromUtf8(isolate, "misses"), v8::Number::New(isolate, stats.misses));
+    result->Set(v8::String::NewFromUtf8(isolate, "evictions"), v8::Number::New(isolate, stats.evictions));
+    result->Set(v8::String::NewFromUtf8(isolate, "entries"), v8::Number::New(isolate, stats.entries));
+    result->Set(v8::String::NewFromUtf8(isolate, "bytes"), v8::Number::New(isolate, stats.bytes));
+    result->Set(v8::String::NewFromUtf8(isolate, "budget"), v8::Number::New(isolate, speech::EnPronouncer::cache_budget()));
+    args.GetReturnValue().Set(result);
+  }
+
+  void
+  EnPronouncer::ClearCache(const v8::FunctionCallbackInfo<v8::Value>& args)
+  {
+    speech::EnPronouncer::clear_cache();
+  }
+
+  void
+  EnPronouncer::CheckLexiconIndex(const v8::FunctionCallbackInfo<v8::Value>& args)
+  {
+    auto isolate = args.GetIsolate();
+
+    try {
+      auto mismatches = speech::EnPronouncer::check_lexicon_index();
+      auto result = v8::Array::New(isolate, mismatches.size());
+      for (size_t i = 0; i < mismatches.size(); ++i) {
+        result->Set(i, v8::String::NewFromUtf8(isolate, mismatches[i].c_str()));
+      }
+      args.GetReturnValue().Set(result);
+    } catch (const std::exception& e) {
+      isolate->ThrowException(v8::Exception::Error(
+          v8::String::NewFromUtf8(isolate, e.what())));
+      return;
+    }
+  }
+
   const speech::EnPronouncer&
   EnPronouncer::pronouncer() const
   {
@@ -15,12 +15,21 @@
 #include "maluuba/speech/fuzzymatcher.hpp"
 #include "maluuba/speech/pronouncer.hpp"
 #include "maluuba/debug.hpp"
+#include "maluuba/snapshot.hpp"
 #include "maluuba/xtd/optional.hpp"
 #include <node.h>
 #include <node_object_wrap.h>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace maluuba
 {
@@ -38,6 +47,8 @@ namespace nodejs
       xtd::optional<NodeJsTarget> extraction;
       xtd::optional<std::string> phrase;
       xtd::optional<speech::EnPronunciation> pronunciation;
+      /** The order this target was made in, for snapshots. */
+      std::uint64_t index = 0;
 
       Target(NodeJsTarget target, NodeJsTarget extraction)
         : target{std::move(target)}, extraction{std::move(extraction)}
@@ -56,13 +67,105 @@ namespace nodejs
       { }
 
     };
+
+    /**
+     * Type-erased distance between targets.  Also accepts the matchers' pruning
+     * limit, so native metrics can abandon hopeless comparisons early.
+     */
+    class NodeDistanceMetric
+    {
+    public:
+      using Function = std::function<double(const Target&, const Target&, double)>;
+
+      NodeDistanceMetric() = default;
+
+      explicit NodeDistanceMetric(Function function)
+        : m_function{std::move(function)}
+      { }
+
+      double
+      operator()(const Target& a, const Target& b) const
+      {
+        return m_function(a, b, std::numeric_limits<double>::infinity());
+      }
+
+      double
+      operator()(const Target& a, const Target& b, double limit) const
+      {
+        return m_function(a, b, limit);
+      }
+
+    private:
+      Function m_function;
+    };
+
+    /**
+     * The user's optional mapping from targets to the input of the distance
+     * function.
+     */
+    class Extractor
+    {
+    public:
+      Extractor(v8::Isolate* isolate, v8::Local<v8::Function> extract)
+      {
+        if (!extract.IsEmpty()) {
+          m_extract.Reset(isolate, extract);
+        }
+      }
+
+      v8::Local<v8::Value>
+      operator()(v8::Isolate* isolate, v8::Local<v8::Value> target) const
+      {
+        if (m_extract.IsEmpty()) {
+          return target;
+        }
+
+        v8::Local<v8::Context> context = isolate->GetCurrentContext();
+        const auto argc = 1;
+        v8::Local<v8::Value> argv[argc] = { target };
+        return m_extract.Get(isolate)->Call(context, v8::Null(isolate), argc, argv).ToLocalChecked();
+      }
+
+    private:
+      v8::Persistent<v8::Function, v8::CopyablePersistentTraits<v8::Function>> m_extract;
+    };
   }
 
   template <template <typename, typename> typename MatcherType>
   class FuzzyMatcher: public node::ObjectWrap
   {
-    using NodeDistanceMetric = std::function<double(const Target&,const Target&)>;
     using Matcher = MatcherType<Target, NodeDistanceMetric>;
+    using MakeTarget = std::function<Target(v8::Isolate*, v8::Local<v8::Value>)>;
+    using MakeTargets = std::function<std::vector<Target>(v8::Isolate*, v8::Local<v8::Array>)>;
+    using ToTarget = std::function<Target(v8::Isolate*, v8::Local<v8::Value>, double&)>;
+
+    /**
+     * How a kind of distance stores its prepared targets in snapshots.
+     */
+    struct TargetCodec
+    {
+      /** Identifies the kind of distance. */
+      std::uint8_t distance_kind;
+      /** The distance's configuration, which must match when loading. */
+      double distance_parameter;
+      std::function<void(SnapshotWriter&, const Target&)> write;
+      /** Reads a target, given the JS object it was made from. */
+      std::function<Target(v8::Isolate*, SnapshotReader&, v8::Local<v8::Value>)> read;
+      /**
+       * The source code of a distance given as JS functions, which must match
+       * when loading, or empty for native distances.
+       */
+      std::string distance_source = {};
+    };
+
+    /** Whether the matcher is a BK-tree, which needs integer distances. */
+    static constexpr bool is_bktree = std::is_same<Matcher, BkTreeFuzzyMatcher<Target, NodeDistanceMetric>>::value;
+
+    /** Whether the matcher is a vantage point tree. */
+    static constexpr bool is_vptree = std::is_same<Matcher, AcceleratedFuzzyMatcher<Target, NodeDistanceMetric>>::value;
+
+    /** Identifies the kind of matcher in snapshots. */
+    static constexpr std::uint8_t matcher_kind = is_bktree ? 2 : is_vptree;
 
   public:
     static void Init(v8::Local<v8::Object> exports, const xtd::string_view className)
@@ -75,58 +178,194 @@ namespace nodejs
       tpl->SetClassName(localClassName);
       tpl->InstanceTemplate()->SetInternalFieldCount(1);
 
+      tpl->Set(isolate, "load", v8::FunctionTemplate::New(isolate, Load));
+
       NODE_SET_PROTOTYPE_METHOD(tpl, "empty", Empty);
       NODE_SET_PROTOTYPE_METHOD(tpl, "size", Size);
       NODE_SET_PROTOTYPE_METHOD(tpl, "nearest", Nearest);
       NODE_SET_PROTOTYPE_METHOD(tpl, "nearestWithin", NearestWithin);
       NODE_SET_PROTOTYPE_METHOD(tpl, "kNearest", KNearest);
       NODE_SET_PROTOTYPE_METHOD(tpl, "kNearestWithin", KNearestWithin);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "kNearestWithinApproximate", KNearestWithinApproximate);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "kNearestWithinBatch", KNearestWithinBatch);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "allWithin", AllWithin);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "insert", Insert);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "erase", Erase);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "save", Save);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "searchStats", SearchStatistics);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "resetSearchStats", ResetSearchStatistics);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "treeShape", TreeShape);
 
       s_constructor.Reset(isolate, tpl->GetFunction(context).ToLocalChecked());
       exports->Set(context, localClassName, tpl->GetFunction(context).ToLocalChecked());
     }
 
+    ~FuzzyMatcher() = default;
+
     const Matcher& matcher() const
     {
       return m_matcher;
     }
 
+    Matcher& matcher()
+    {
+      return m_matcher;
+    }
+
+    /**
+     * Prepare a target from the user's object.  Targets are numbered in the
+     * order they're made, to find them again when loading a snapshot.
+     */
+    Target make_target(v8::Isolate* isolate, v8::Local<v8::Value> arg)
+    {
+      auto target = m_make_target(isolate, arg);
+      target.index = m_next_index++;
+      return target;
+    }
+
     Target to_target(v8::Isolate* isolate, v8::Local<v8::Value> arg, double& threshold_scale) const
     {
       return m_to_target(isolate, arg, threshold_scale);
     }
 
   private:
-    template <typename Targets>
-    explicit FuzzyMatcher(Targets targets, NodeDistanceMetric metric, std::function<Target(v8::Isolate*, v8::Local<v8::Value>, double&)> to_target)
-      : m_matcher{std::make_move_iterator(targets.begin()), std::make_move_iterator(targets.end()), std::move(metric)},
-        m_to_target{to_target}
+    explicit FuzzyMatcher(NodeDistanceMetric metric, MakeTarget make_target, ToTarget to_target, TargetCodec codec, MakeTargets make_targets = {})
+      : m_metric{std::move(metric)},
+        m_make_target{std::move(make_target)},
+        m_make_targets{std::move(make_targets)},
+        m_to_target{std::move(to_target)},
+        m_codec{std::move(codec)}
     { }
 
-    static FuzzyMatcher<MatcherType>*
-    make_fuzzy_matcher_hybrid(v8::Isolate* isolate, v8::Local<v8::Array> arg_targets, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
+    /** Build the matcher from the user's targets. */
+    void build(v8::Isolate* isolate, v8::Local<v8::Array> arg_targets)
     {
-
-      v8::Local<v8::Context> context = isolate->GetCurrentContext();
-
-      speech::EnPronouncer pronouncer{};
       std::vector<Target> targets;
-      const auto argc = 1;
-      for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
-        auto obj = arg_targets->Get(i);
-        auto value = obj;
-        if (!arg_extract.IsEmpty()) {
-          v8::Local<v8::Value> argv[argc] = { obj };
-          value = arg_extract->Call(context, v8::Null(isolate), argc, argv).ToLocalChecked();
+      if (m_make_targets) {
+        targets = m_make_targets(isolate, arg_targets);
+        for (auto& target : targets) {
+          target.index = m_next_index++;
+        }
+      } else {
+        for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
+          targets.push_back(make_target(isolate, arg_targets->Get(i)));
         }
-        std::string phrase{*v8::String::Utf8Value{isolate, value}};
-        targets.emplace_back(NodeJsTarget(isolate, obj), phrase, pronouncer.pronounce(phrase));
       }
+      m_matcher = Matcher{std::make_move_iterator(targets.begin()), std::make_move_iterator(targets.end()), m_metric};
+    }
+
+    /**
+     * Save the matcher's prepared targets (and index, if accelerated) to a
+     * snapshot file.
+     */
+    void save(const std::string& path) const
+    {
+      std::ofstream stream{path, std::ios::binary};
+      check(stream.is_open(), "Failed to open " + path);
+
+      SnapshotWriter writer{stream};
+      writer.write_u8(matcher_kind);
+      writer.write_u8(m_codec.distance_kind);
+      writer.write_f64(m_codec.distance_parameter);
+      writer.write_string(m_codec.distance_source);
+      writer.write_u64(m_next_index);
+      m_matcher.save(writer, [this](SnapshotWriter& writer, const Target& target) {
+        writer.write_u64(target.index);
+        m_codec.write(writer, target);
+      });
+      writer.finish();
+    }
+
+    /**
+     * Load the matcher from a snapshot file, looking up each target's object
+     * in the user's targets by the number it was made with.
+     */
+    void load(v8::Isolate* isolate, const std::string& path, v8::Local<v8::Array> arg_targets)
+    {
+      auto data = snapshot::read_file(path);
+      SnapshotReader reader{data};
+      check(reader.read_u8() == matcher_kind, "Snapshot is of a different kind of matcher.");
+      check(reader.read_u8() == m_codec.distance_kind && reader.read_f64() == m_codec.distance_parameter,
+          "Snapshot was saved with a different distance.");
+      check(std::string{reader.read_string()} == m_codec.distance_source,
+          "Snapshot was saved with a different distance or extract function.");
+      m_next_index = reader.read_u64();
+
+      auto read_target = [this, isolate, arg_targets](SnapshotReader& reader) {
+        auto index = reader.read_u64();
+        check(index < arg_targets->Length(), "Snapshot refers to a target past the end of 'targets'.");
+        auto target = m_codec.read(isolate, reader, arg_targets->Get(index));
+        target.index = index;
+        return target;
+      };
+      m_matcher = Matcher::load(reader, read_target, m_metric);
+      check(reader.at_end(), "Malformed snapshot.");
+    }
+
+    static void write_phrase(SnapshotWriter& writer, const Target& target)
+    {
+      writer.write_string(*target.phrase);
+    }
+
+    static std::string read_phrase(SnapshotReader& reader)
+    {
+      return std::string{reader.read_string()};
+    }
+
+    // Phone IDs are only meaningful within a process, so pronunciations are stored as IPA
+    static void write_pronunciation(SnapshotWriter& writer, const Target& target)
+    {
+      writer.write_string(target.pronunciation->to_ipa());
+    }
+
+    static speech::EnPronunciation read_pronunciation(SnapshotReader& reader)
+    {
+      return speech::EnPronunciation::from_ipa(reader.read_string());
+    }
+
+    /**
+     * Prepare all the user's targets at once: extract their phrases, then
+     * pronounce them in parallel.
+     *
+     * @param make  Makes a target from its object, phrase and pronunciation.
+     */
+    template <typename Make>
+    static MakeTargets
+    make_pronounced_targets(v8::Isolate* isolate, v8::Local<v8::Function> arg_extract, Make make)
+    {
+      return [extract{Extractor{isolate, arg_extract}}, make](auto isolate, auto arg_targets) {
+        static speech::EnPronouncer pronouncer{};
+        std::vector<std::string> phrases;
+        phrases.reserve(arg_targets->Length());
+        for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
+          phrases.emplace_back(*v8::String::Utf8Value{isolate, extract(isolate, arg_targets->Get(i))});
+        }
+
+        auto pronunciations = pronouncer.pronounce_all(phrases);
+
+        std::vector<Target> targets;
+        targets.reserve(phrases.size());
+        for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
+          targets.push_back(make(NodeJsTarget(isolate, arg_targets->Get(i)), std::move(phrases[i]), std::move(pronunciations[i])));
+        }
+        return targets;
+      };
+    }
+
+    static FuzzyMatcher<MatcherType>*
+    make_fuzzy_matcher_hybrid(v8::Isolate* isolate, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
+    {
+      auto make_target = [extract{Extractor{isolate, arg_extract}}](auto isolate, auto obj) {
+        static speech::EnPronouncer pronouncer{};
+        std::string phrase{*v8::String::Utf8Value{isolate, extract(isolate, obj)}};
+        auto pronunciation = pronouncer.pronounce(phrase);
+        return Target(NodeJsTarget(isolate, obj), std::move(phrase), std::move(pronunciation));
+      };
 
       // copy out the native distance component.
       auto obj = ObjectWrap::Unwrap<EnHybridDistance>(arg_distance.As<v8::Object>());
-      auto metric = [distance{obj->distance()}](const auto& a, const auto& b) {
-        return distance(*a.phrase, *a.pronunciation, *b.phrase, *b.pronunciation);
+      auto metric = [distance{obj->distance()}](const auto& a, const auto& b, double limit) {
+        return distance(*a.phrase, *a.pronunciation, *b.phrase, *b.pronunciation, limit);
       };
 
       auto to_target = [phonetic_weight_percentage{obj->distance().phonetic_weight_percentage()}](auto isolate, auto arg, auto& threshold_scale) {
@@ -140,30 +379,37 @@ namespace nodejs
         return target;
       };
 
-      return new FuzzyMatcher(std::move(targets), NodeDistanceMetric{std::move(metric)}, std::move(to_target));
+      TargetCodec codec{3, obj->distance().phonetic_weight_percentage(),
+        [](auto& writer, const auto& target) {
+          write_phrase(writer, target);
+          write_pronunciation(writer, target);
+        },
+        [](auto isolate, auto& reader, auto obj) {
+          auto phrase = read_phrase(reader);
+          auto pronunciation = read_pronunciation(reader);
+          return Target(NodeJsTarget(isolate, obj), std::move(phrase), std::move(pronunciation));
+        },
+      };
+
+      auto make_targets = make_pronounced_targets(isolate, arg_extract, [](auto target, auto phrase, auto pronunciation) {
+        return Target(std::move(target), std::move(phrase), std::move(pronunciation));
+      });
+
+      return new FuzzyMatcher(NodeDistanceMetric{std::move(metric)}, std::move(make_target), std::move(to_target), std::move(codec), std::move(make_targets));
     }
 
     static FuzzyMatcher<MatcherType>*
-    make_fuzzy_matcher_string(v8::Isolate* isolate, v8::Local<v8::Array> arg_targets, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
+    make_fuzzy_matcher_string(v8::Isolate* isolate, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
     {
-      v8::Local<v8::Context> context = isolate->GetCurrentContext();
-      std::vector<Target> targets;
-      const auto argc = 1;
-      for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
-        auto obj = arg_targets->Get(i);
-        auto value = obj;
-        if (!arg_extract.IsEmpty()) {
-          v8::Local<v8::Value> argv[argc] = { obj };
-          value = arg_extract->Call(context, v8::Null(isolate), argc, argv).ToLocalChecked();;
-        }
-        std::string phrase{*v8::String::Utf8Value{isolate, value}};
-        targets.emplace_back(NodeJsTarget(isolate, obj), std::move(phrase));
-      }
+      auto make_target = [extract{Extractor{isolate, arg_extract}}](auto isolate, auto obj) {
+        std::string phrase{*v8::String::Utf8Value{isolate, extract(isolate, obj)}};
+        return Target(NodeJsTarget(isolate, obj), std::move(phrase));
+      };
 
       // copy out the native distance component.
       auto obj = ObjectWrap::Unwrap<StringDistance>(arg_distance.As<v8::Object>());
-      auto metric = [distance{obj->distance()}](const auto& a, const auto& b) {
-        return distance(*a.phrase, *b.phrase);
+      auto metric = [distance{obj->distance()}](const auto& a, const auto& b, double limit) {
+        return distance(*a.phrase, *b.phrase, limit);
       };
 
       auto to_target = [](auto isolate, auto arg, auto& threshold_scale) {
@@ -173,31 +419,29 @@ namespace nodejs
         return target;
       };
 
-      return new FuzzyMatcher(std::move(targets), NodeDistanceMetric{std::move(metric)}, std::move(to_target));
+      TargetCodec codec{1, 0.0,
+        write_phrase,
+        [](auto isolate, auto& reader, auto obj) {
+          return Target(NodeJsTarget(isolate, obj), read_phrase(reader));
+        },
+      };
+
+      return new FuzzyMatcher(NodeDistanceMetric{std::move(metric)}, std::move(make_target), std::move(to_target), std::move(codec));
     }
 
     static FuzzyMatcher<MatcherType>*
-    make_fuzzy_matcher_phone(v8::Isolate* isolate, v8::Local<v8::Array> arg_targets, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
+    make_fuzzy_matcher_phone(v8::Isolate* isolate, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
     {
-      v8::Local<v8::Context> context = isolate->GetCurrentContext();
-      speech::EnPronouncer pronouncer{};
-      std::vector<Target> targets;
-      const auto argc = 1;
-      for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
-        auto obj = arg_targets->Get(i);
-        auto value = obj;
-        if (!arg_extract.IsEmpty()) {
-          v8::Local<v8::Value> argv[argc] = { obj };
-          value = arg_extract->Call(context, v8::Null(isolate), argc, argv).ToLocalChecked();;
-        }
-        std::string phrase{*v8::String::Utf8Value{isolate, value}};
-        targets.emplace_back(NodeJsTarget(isolate, obj), pronouncer.pronounce(phrase));
-      }
+      auto make_target = [extract{Extractor{isolate, arg_extract}}](auto isolate, auto obj) {
+        static speech::EnPronouncer pronouncer{};
+        std::string phrase{*v8::String::Utf8Value{isolate, extract(isolate, obj)}};
+        return Target(NodeJsTarget(isolate, obj), pronouncer.pronounce(phrase));
+      };
 
       // copy out the native distance component.
       auto obj = ObjectWrap::Unwrap<EnPhoneticDistance>(arg_distance.As<v8::Object>());
-      auto metric = [distance{obj->distance()}](const auto& a, const auto& b) {
-        return distance(*a.pronunciation, *b.pronunciation);
+      auto metric = [distance{obj->distance()}](const auto& a, const auto& b, double limit) {
+        return distance(*a.pronunciation, *b.pronunciation, limit);
       };
 
       auto to_target = [](auto isolate, auto arg, auto& threshold_scale) {
@@ -209,28 +453,30 @@ namespace nodejs
         return target;
       };
 
-      return new FuzzyMatcher(std::move(targets), NodeDistanceMetric{std::move(metric)}, std::move(to_target));
+      TargetCodec codec{2, 0.0,
+        write_pronunciation,
+        [](auto isolate, auto& reader, auto obj) {
+          return Target(NodeJsTarget(isolate, obj), read_pronunciation(reader));
+        },
+      };
+
+      auto make_targets = make_pronounced_targets(isolate, arg_extract, [](auto target, auto, auto pronunciation) {
+        return Target(std::move(target), std::move(pronunciation));
+      });
+
+      return new FuzzyMatcher(NodeDistanceMetric{std::move(metric)}, std::move(make_target), std::move(to_target), std::move(codec), std::move(make_targets));
     }
 
     static FuzzyMatcher<MatcherType>*
-    make_fuzzy_matcher_js(v8::Isolate* isolate, v8::Local<v8::Array> arg_targets, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
+    make_fuzzy_matcher_js(v8::Isolate* isolate, v8::Local<v8::Value> arg_distance, v8::Local<v8::Function> arg_extract)
     {
-      v8::Local<v8::Context> context = isolate->GetCurrentContext();
-      std::vector<Target> targets;
-      const auto argc = 1;
-      for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
-        auto obj = arg_targets->Get(i);
-        auto value = obj;
-        if (!arg_extract.IsEmpty()) {
-          v8::Local<v8::Value> argv[argc] = { obj };
-          value = arg_extract->Call(context, v8::Null(isolate), argc, argv).ToLocalChecked();
-        }
-        targets.emplace_back(NodeJsTarget(isolate, obj), NodeJsTarget(isolate, value));
-      }
+      auto make_target = [extract{Extractor{isolate, arg_extract}}](auto isolate, auto obj) {
+        return Target(NodeJsTarget(isolate, obj), NodeJsTarget(isolate, extract(isolate, obj)));
+      };
 
       // Need persistent reference to the user's distance function that needs to be copyable.
       v8::Persistent<v8::Function, v8::CopyablePersistentTraits<v8::Function>> distance(isolate, arg_distance.As<v8::Function>());
-      auto metric = [distance{std::move(distance)}](const auto& a, const auto& b) {
+      auto metric = [distance{std::move(distance)}](const auto& a, const auto& b, double /* limit */) {
         auto isolate = v8::Isolate::GetCurrent();
         v8::Local<v8::Context> context = isolate->GetCurrentContext();
 
@@ -247,61 +493,106 @@ namespace nodejs
         return target;
       };
 
-      return new FuzzyMatcher(std::move(targets), NodeDistanceMetric{std::move(metric)}, std::move(to_target));
-    }
+      // The extraction is a JS value, so it is extracted again on load
+      TargetCodec codec{0, 0.0,
+        [](auto&, const auto&) { },
+        [make_target](auto isolate, auto&, auto obj) {
+          return make_target(isolate, obj);
+        },
+      };
 
-    ~FuzzyMatcher() = default;
+      // The saved index is only valid for the same distances between the same
+      // extractions, so identify them by their source
+      codec.distance_source = *v8::String::Utf8Value{isolate, arg_distance};
+      if (!arg_extract.IsEmpty()) {
+        codec.distance_source += '\0';
+        codec.distance_source += *v8::String::Utf8Value{isolate, arg_extract};
+      }
 
-    static void New(const v8::FunctionCallbackInfo<v8::Value>& args)
+      return new FuzzyMatcher(NodeDistanceMetric{std::move(metric)}, std::move(make_target), std::move(to_target), std::move(codec));
+    }
+
+    /**
+     * Create an empty matcher from the (targets, distance[, extract]) arguments
+     * starting at @p first.
+     *
+     * @return The matcher, or null after throwing a JS exception.
+     */
+    static std::unique_ptr<FuzzyMatcher<MatcherType>>
+    make_fuzzy_matcher(const v8::FunctionCallbackInfo<v8::Value>& args, int first)
     {
       auto isolate = args.GetIsolate();
 
-      if (args.IsConstructCall()) {
-        if (args.Length() < 2) {
+      if (args.Length() < first + 2) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected at least 2 arguments.")));
+        return nullptr;
+      }
+
+      if (!args[first]->IsArray()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 'targets' argument to be an Object[].")));
+        return nullptr;
+      }
+      v8::Local<v8::Function> arg_extract{};
+      if (args.Length() > first + 2) {
+        if (!args[first + 2]->IsFunction()) {
           isolate->ThrowException(v8::Exception::TypeError(
-              v8::String::NewFromUtf8(isolate, "Expected at least 2 arguments.")));
-          return;
+              v8::String::NewFromUtf8(isolate, "Expected 'extract' argument to be a Function.")));
+          return nullptr;
         }
+        arg_extract = args[first + 2].As<v8::Function>();
+      }
+      auto arg_distance = args[first + 1];
 
-        if (!args[0]->IsArray()) {
+      // Only the unit-cost string distance gives a BK-tree the integer distances it needs
+      if (is_bktree && !StringDistance::type(isolate)->HasInstance(arg_distance)) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 'distance' argument to be a StringDistance.")));
+        return nullptr;
+      }
+
+      // Attempt to see if the JS calls can be unwrapped into their native components
+      // to save on overhead on the distance calls, which can occur a lot.
+      std::unique_ptr<FuzzyMatcher<MatcherType>> obj;
+      if (EnHybridDistance::type(isolate)->HasInstance(arg_distance)) {
+        obj.reset(make_fuzzy_matcher_hybrid(isolate, arg_distance, arg_extract));
+      } else if (StringDistance::type(isolate)->HasInstance(arg_distance)) {
+        obj.reset(make_fuzzy_matcher_string(isolate, arg_distance, arg_extract));
+      } else if (EnPhoneticDistance::type(isolate)->HasInstance(arg_distance)) {
+        obj.reset(make_fuzzy_matcher_phone(isolate, arg_distance, arg_extract));
+      } else {
+        // User provided JS distance function.
+        if (!arg_distance->IsFunction()) {
           isolate->ThrowException(v8::Exception::TypeError(
-              v8::String::NewFromUtf8(isolate, "Expected 'targets' argument to be an Object[].")));
-          return;
+              v8::String::NewFromUtf8(isolate, "Expected 'distance' argument to be a Function.")));
+          return nullptr;
         }
-        v8::Local<v8::Function> arg_extract{};
-        if (args.Length() > 2) {
-          if (!args[2]->IsFunction()) {
-            isolate->ThrowException(v8::Exception::TypeError(
-                v8::String::NewFromUtf8(isolate, "Expected 'extract' argument to be a Function.")));
-            return;
-          }
-          arg_extract = args[2].As<v8::Function>();
+        obj.reset(make_fuzzy_matcher_js(isolate, arg_distance, arg_extract));
+      }
+      return obj;
+    }
+
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+
+      if (args.IsConstructCall()) {
+        // Wrapping a matcher made by load()
+        if (args.Length() == 1 && args[0]->IsExternal()) {
+          auto obj = static_cast<FuzzyMatcher<MatcherType>*>(args[0].As<v8::External>()->Value());
+          obj->Wrap(args.This());
+          args.GetReturnValue().Set(args.This());
+          return;
         }
-        auto arg_targets = args[0].As<v8::Array>();
-        auto arg_distance = args[1];
 
         try {
-          // Attempt to see if the JS calls can be unwrapped into their native components
-          // to save on overhead on the distance calls, which can occur a lot.
-          if (EnHybridDistance::type(isolate)->HasInstance(arg_distance)) {
-            auto obj = make_fuzzy_matcher_hybrid(isolate, arg_targets, arg_distance, arg_extract);
-            obj->Wrap(args.This());
-          } else if (StringDistance::type(isolate)->HasInstance(arg_distance)) {
-            auto obj = make_fuzzy_matcher_string(isolate, arg_targets, arg_distance, arg_extract);
-            obj->Wrap(args.This());
-          } else if (EnPhoneticDistance::type(isolate)->HasInstance(arg_distance)) {
-            auto obj = make_fuzzy_matcher_phone(isolate, arg_targets, arg_distance, arg_extract);
-            obj->Wrap(args.This());
-          } else {
-            // User provided JS distance function.
-            if (!arg_distance->IsFunction()) {
-              isolate->ThrowException(v8::Exception::TypeError(
-                  v8::String::NewFromUtf8(isolate, "Expected 'distance' argument to be a Function.")));
-              return;
-            }
-            auto obj = make_fuzzy_matcher_js(isolate, arg_targets, arg_distance, arg_extract);
-            obj->Wrap(args.This());
+          auto obj = make_fuzzy_matcher(args, 0);
+          if (!obj) {
+            return;
           }
+          obj->build(isolate, args[0].As<v8::Array>());
+          obj.release()->Wrap(args.This());
 
           args.GetReturnValue().Set(args.This());
         } catch (const std::exception& e) {
@@ -316,6 +607,60 @@ namespace nodejs
       }
     }
 
+    static void Load(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+
+      if (args.Length() < 1 || !args[0]->IsString()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 'path' argument to be a string.")));
+        return;
+      }
+      std::string path{*v8::String::Utf8Value{isolate, args[0]}};
+
+      try {
+        auto obj = make_fuzzy_matcher(args, 1);
+        if (!obj) {
+          return;
+        }
+        obj->load(isolate, path, args[1].As<v8::Array>());
+
+        auto context = isolate->GetCurrentContext();
+        const auto argc = 1;
+        v8::Local<v8::Value> argv[argc] = { v8::External::New(isolate, obj.get()) };
+        auto constructor = v8::Local<v8::Function>::New(isolate, s_constructor);
+        auto instance = constructor->NewInstance(context, argc, argv).ToLocalChecked();
+        obj.release();
+        args.GetReturnValue().Set(instance);
+      } catch (const std::exception& e) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, e.what())));
+        return;
+      }
+    }
+
+    static void Save(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+
+      if (args.Length() < 1 || !args[0]->IsString()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 'path' argument to be a string.")));
+        return;
+      }
+      std::string path{*v8::String::Utf8Value{isolate, args[0]}};
+
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+
+      try {
+        obj->save(path);
+      } catch (const std::exception& e) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, e.what())));
+        return;
+      }
+    }
+
     static void Empty(const v8::FunctionCallbackInfo<v8::Value>& args)
     {
       auto isolate = args.GetIsolate();
@@ -506,9 +851,311 @@ namespace nodejs
       }
     }
 
+    /** Read the search options from a JS object, starting any timeout now. */
+    static VpTreeSearchOptions search_options(v8::Isolate* isolate, v8::Local<v8::Object> arg_options)
+    {
+      v8::Local<v8::Context> context = isolate->GetCurrentContext();
+      VpTreeSearchOptions options;
+
+      auto max_evaluations = arg_options->Get(v8::String::NewFromUtf8(isolate, "maxEvaluations"));
+      if (max_evaluations->IsNumber()) {
+        check(max_evaluations->NumberValue(context).ToChecked() >= 0, "Expected 'maxEvaluations' to be >= 0.");
+        options.max_evaluations = static_cast<std::size_t>(max_evaluations->NumberValue(context).ToChecked());
+      }
+
+      auto timeout = arg_options->Get(v8::String::NewFromUtf8(isolate, "timeout"));
+      if (timeout->IsNumber()) {
+        std::chrono::duration<double, std::milli> milliseconds{timeout->NumberValue(context).ToChecked()};
+        options.deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(milliseconds);
+      }
+
+      auto epsilon = arg_options->Get(v8::String::NewFromUtf8(isolate, "epsilon"));
+      if (epsilon->IsNumber()) {
+        options.epsilon = epsilon->NumberValue(context).ToChecked();
+        check(options.epsilon >= 0, "Expected 'epsilon' to be >= 0.");
+      }
+
+      return options;
+    }
+
+    static void KNearestWithinApproximate(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+      v8::Local<v8::Context> context = isolate->GetCurrentContext();
+
+      if (args.Length() < 4) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 4 arguments.")));
+        return;
+      }
+
+      if (!args[1]->IsUint32()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected argument to be an integer.")));
+        return;
+      }
+      if (!args[2]->IsNumber()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected argument to be a number.")));
+        return;
+      }
+      if (!args[3]->IsObject()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 'options' argument to be an object.")));
+        return;
+      }
+
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+      double threshold_scale;
+      auto target = obj->to_target(isolate, args[0], threshold_scale);
+      auto k = args[1]->Uint32Value(context).ToChecked();
+      auto threshold = args[2]->NumberValue(context).ToChecked() * threshold_scale;
+
+      try {
+        auto options = search_options(isolate, args[3].As<v8::Object>());
+        bool exact;
+        auto matches = obj->matcher().find_k_nearest_within(target, k, threshold, options, &exact);
+
+        auto wrap_matches = v8::Array::New(isolate, matches.size());
+        for (size_t i = 0; i < matches.size(); ++i) {
+          speech::FuzzyMatcher<NodeJsTarget>::Match match(matches[i].element().target, matches[i].distance() / threshold_scale);
+          auto wrap_match = new Match(std::move(match));
+
+          const auto argc = 1;
+          v8::Local<v8::Value> argv[argc] = { v8::External::New(isolate, wrap_match) };
+          auto instance = Match::constructor(isolate)->NewInstance(context, argc, argv).ToLocalChecked();
+          wrap_matches->Set(i, instance);
+        }
+
+        auto result = v8::Object::New(isolate);
+        result->Set(v8::String::NewFromUtf8(isolate, "matches"), wrap_matches);
+        result->Set(v8::String::NewFromUtf8(isolate, "exact"), v8::Boolean::New(isolate, exact));
+        args.GetReturnValue().Set(result);
+      } catch(const std::exception& e) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, e.what())));
+        return;
+      }
+    }
+
+    static void KNearestWithinBatch(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+      v8::Local<v8::Context> context = isolate->GetCurrentContext();
+
+      if (args.Length() < 3) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 3 arguments.")));
+        return;
+      }
+
+      if (!args[0]->IsArray()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 'targets' argument to be an array.")));
+        return;
+      }
+      if (!args[1]->IsUint32()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected argument to be an integer.")));
+        return;
+      }
+      if (!args[2]->IsNumber()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected argument to be a number.")));
+        return;
+      }
+
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+      auto arg_targets = args[0].As<v8::Array>();
+      auto k = args[1]->Uint32Value(context).ToChecked();
+      auto limit = args[2]->NumberValue(context).ToChecked();
+
+      try {
+        // Prepare the queries here, since only this thread may touch JS values
+        std::vector<Target> targets;
+        std::vector<double> threshold_scales;
+        std::vector<double> thresholds;
+        for (uint32_t i = 0; i < arg_targets->Length(); ++i) {
+          double threshold_scale;
+          targets.push_back(obj->to_target(isolate, arg_targets->Get(i), threshold_scale));
+          threshold_scales.push_back(threshold_scale);
+          thresholds.push_back(limit * threshold_scale);
+        }
+
+        // A JS distance function can only be called from this thread
+        auto threads = obj->m_codec.distance_kind == 0 ? 1 : 0;
+        auto batch = obj->matcher().find_k_nearest_within_batch(targets, k, thresholds, threads);
+
+        auto wrap_batch = v8::Array::New(isolate, batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+          auto wrap_matches = v8::Array::New(isolate, batch.count(i));
+          for (size_t j = 0; j < batch.count(i); ++j) {
+            const auto& found = batch.matches()[batch.offset(i) + j];
+            speech::FuzzyMatcher<NodeJsTarget>::Match match(found.element().target, found.distance() / threshold_scales[i]);
+            auto wrap_match = new Match(std::move(match));
+
+            const auto argc = 1;
+            v8::Local<v8::Value> argv[argc] = { v8::External::New(isolate, wrap_match) };
+            auto instance = Match::constructor(isolate)->NewInstance(context, argc, argv).ToLocalChecked();
+            wrap_matches->Set(j, instance);
+          }
+          wrap_batch->Set(i, wrap_matches);
+        }
+        args.GetReturnValue().Set(wrap_batch);
+      } catch(const std::exception& e) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, e.what())));
+        return;
+      }
+    }
+
+    static void AllWithin(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+      v8::Local<v8::Context> context = isolate->GetCurrentContext();
+
+      if (args.Length() < 2) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 2 arguments.")));
+        return;
+      }
+
+      if (!args[1]->IsNumber()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected argument to be a number.")));
+        return;
+      }
+
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+      double threshold_scale;
+      auto target = obj->to_target(isolate, args[0], threshold_scale);
+      auto threshold = args[1]->NumberValue(context).ToChecked() * threshold_scale;
+
+      try {
+        auto matches = obj->matcher().find_all_within(target, threshold);
+
+        auto wrap_matches = v8::Array::New(isolate, matches.size());
+        for (size_t i = 0; i < matches.size(); ++i) {
+          speech::FuzzyMatcher<NodeJsTarget>::Match match(matches[i].element().target, matches[i].distance() / threshold_scale);
+          auto wrap_match = new Match(std::move(match));
+
+          const auto argc = 1;
+          v8::Local<v8::Value> argv[argc] = { v8::External::New(isolate, wrap_match) };
+          auto instance = Match::constructor(isolate)->NewInstance(context, argc, argv).ToLocalChecked();
+          wrap_matches->Set(i, instance);
+        }
+        args.GetReturnValue().Set(wrap_matches);
+      } catch(const std::exception& e) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, e.what())));
+        return;
+      }
+    }
+
+    static void Insert(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+
+      if (args.Length() < 1) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 1 argument.")));
+        return;
+      }
+
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+
+      try {
+        obj->matcher().insert(obj->make_target(isolate, args[0]));
+      } catch(const std::exception& e) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, e.what())));
+        return;
+      }
+    }
+
+    static void Erase(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+
+      if (args.Length() < 1) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected 1 argument.")));
+        return;
+      }
+
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+
+      try {
+        // Look up the target by its distance, then pick out this very object
+        auto key = obj->m_make_target(isolate, args[0]);
+        auto erased = obj->matcher().erase(key, [isolate, &args](const Target& target) {
+          return target.target.Get(isolate)->StrictEquals(args[0]);
+        });
+        args.GetReturnValue().Set(v8::Boolean::New(isolate, erased > 0));
+      } catch(const std::exception& e) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, e.what())));
+        return;
+      }
+    }
+
+    static void SearchStatistics(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto isolate = args.GetIsolate();
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+      auto stats = obj->matcher().search_stats();
+
+      using Milliseconds = std::chrono::duration<double, std::milli>;
+      auto result = v8::Object::New(isolate);
+      result->Set(v8::String::NewFromUtf8(isolate, "enabled"), v8::Boolean::New(isolate, SearchStatsCounter::enabled));
+      result->Set(v8::String::NewFromUtf8(isolate, "searches"), v8::Number::New(isolate, stats.searches));
+      result->Set(v8::String::NewFromUtf8(isolate, "evaluations"), v8::Number::New(isolate, stats.evaluations));
+      result->Set(v8::String::NewFromUtf8(isolate, "nodesVisited"), v8::Number::New(isolate, stats.nodes_visited));
+      result->Set(v8::String::NewFromUtf8(isolate, "subtreesPruned"), v8::Number::New(isolate, stats.subtrees_pruned));
+      result->Set(v8::String::NewFromUtf8(isolate, "stackHighWater"), v8::Number::New(isolate, stats.stack_high_water));
+      result->Set(v8::String::NewFromUtf8(isolate, "metricTime"), v8::Number::New(isolate, Milliseconds{stats.metric_time}.count()));
+      result->Set(v8::String::NewFromUtf8(isolate, "traversalTime"), v8::Number::New(isolate, Milliseconds{stats.traversal_time}.count()));
+      args.GetReturnValue().Set(result);
+    }
+
+    static void ResetSearchStatistics(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+      obj->matcher().reset_search_stats();
+    }
+
+    /** Returns the shape of a vantage point tree, or undefined for other matchers. */
+    static void TreeShape(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+      if constexpr (is_vptree) {
+        auto isolate = args.GetIsolate();
+        auto obj = ObjectWrap::Unwrap<FuzzyMatcher>(args.Holder());
+        auto shape = obj->matcher().tree_shape();
+
+        auto result = v8::Object::New(isolate);
+        result->Set(v8::String::NewFromUtf8(isolate, "trees"), v8::Number::New(isolate, shape.trees));
+        result->Set(v8::String::NewFromUtf8(isolate, "nodes"), v8::Number::New(isolate, shape.nodes));
+        result->Set(v8::String::NewFromUtf8(isolate, "leaves"), v8::Number::New(isolate, shape.leaves));
+        result->Set(v8::String::NewFromUtf8(isolate, "maxDepth"), v8::Number::New(isolate, shape.max_depth));
+        result->Set(v8::String::NewFromUtf8(isolate, "meanDepth"), v8::Number::New(isolate, shape.mean_depth));
+        result->Set(v8::String::NewFromUtf8(isolate, "tiedSplits"), v8::Number::New(isolate, shape.tied_splits));
+        result->Set(v8::String::NewFromUtf8(isolate, "minRadius"), v8::Number::New(isolate, shape.min_radius));
+        result->Set(v8::String::NewFromUtf8(isolate, "medianRadius"), v8::Number::New(isolate, shape.median_radius));
+        result->Set(v8::String::NewFromUtf8(isolate, "maxRadius"), v8::Number::New(isolate, shape.max_radius));
+        args.GetReturnValue().Set(result);
+      }
+    }
+
     static v8::Persistent<v8::Function> s_constructor;
     Matcher m_matcher;
-    std::function<Target(v8::Isolate*, v8::Local<v8::Value>, double&)> m_to_target;
+    NodeDistanceMetric m_metric;
+    MakeTarget m_make_target;
+    /** Prepares all the user's targets at once, if set, instead of one at a time. */
+    MakeTargets m_make_targets;
+    ToTarget m_to_target;
+    TargetCodec m_codec;
+    /** The index of the next target made. */
+    std::uint64_t m_next_index = 0;
   };
 
   template <template <typename, typename> typename T>
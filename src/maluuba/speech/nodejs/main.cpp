@@ -28,6 +28,7 @@ namespace nodejs
       EnPhoneticDistance::Init(exports);
       FuzzyMatcher<speech::LinearFuzzyMatcher>::Init(exports, "FuzzyMatcher");
       FuzzyMatcher<speech::AcceleratedFuzzyMatcher>::Init(exports, "AcceleratedFuzzyMatcher");
+      FuzzyMatcher<speech::BkTreeFuzzyMatcher>::Init(exports, "BkTreeFuzzyMatcher");
       EnPronouncer::Init(exports);
       EnPronunciation::Init(exports);
       Match::Init(exports);
@@ -13,6 +13,9 @@
 #define MALUUBA_SPEECH_PHONETIC_DISTANCE_HPP
 
 #include "maluuba/speech/pronunciation.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
 #include <vector>
 
 namespace maluuba
@@ -79,6 +82,36 @@ namespace speech
      * @return The phonetic distance of phonemes between @p a and @p b.
      */
     double operator()(const PronunciationVector& a, const PronunciationVector& b) const;
+
+    /**
+     * @return The phonetic distance of phonemes between the phone ID strings
+     *         @p a and @p b, using precomputed substitution costs.
+     *
+     * This is computed in single precision.  It differs from the
+     * @c PronunciationVector overload by at most
+     * <code>(a.size() + b.size()) * FLT_EPSILON</code> times the distance.
+     */
+    double operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b) const;
+
+    /**
+     * @return The phonetic distance of phonemes between the phone ID strings
+     *         @p a and @p b if it is at most @p limit, otherwise a lower bound
+     *         for it that exceeds @p limit.
+     */
+    double operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b, double limit) const;
+
+    /**
+     * Compute the phonetic distances from the phone ID string @p query to each
+     * of @p count @p targets at once, which is faster than one at a time.
+     *
+     * @param query  The query phone ID string.
+     * @param targets  The target phone ID strings.
+     * @param count  The number of targets.
+     * @param[out] distances  The @p count distances, in the same order as @p targets.
+     * @param limit  Distances greater than this may be reported as any lower
+     *               bound that also exceeds @p limit.
+     */
+    void distance_many(const std::vector<PhoneId>& query, const std::vector<PhoneId>* const* targets, std::size_t count, double* distances, double limit) const;
   };
 
   /**
@@ -91,8 +124,64 @@ namespace speech
 
     /**
      * @return The phonetic distance between English pronuncations @p a and @p b.
+     *         This is accurate to a relative error of
+     *         <code>(a.size() + b.size()) * FLT_EPSILON</code>.
      */
     double operator()(const EnPronunciation& a, const EnPronunciation& b) const;
+
+    /**
+     * @return The phonetic distance between English pronuncations @p a and @p b
+     *         if it is at most @p limit, otherwise a lower bound for it that
+     *         exceeds @p limit.
+     */
+    double operator()(const EnPronunciation& a, const EnPronunciation& b, double limit) const;
+
+    /**
+     * @return The phonetic distance between the phone ID strings @p a and @p b
+     *         (see @c Pronunciation::phone_ids()).
+     */
+    double operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b) const;
+
+    /**
+     * @return The phonetic distance between the phone ID strings @p a and @p b
+     *         if it is at most @p limit, otherwise a lower bound for it that
+     *         exceeds @p limit.
+     */
+    double operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b, double limit) const;
+
+    /**
+     * Compute the phonetic distances between @p query and each English
+     * pronunciation in [@p first, @p last).  Targets are scored together in
+     * SIMD lanes, giving the same results as calling this metric on each one.
+     *
+     * @param query  The query pronunciation.
+     * @param first  The start of the target pronunciations.
+     * @param last  The end of the target pronunciations.
+     * @param out  Receives the distance to each target, in order.
+     * @param limit  Distances greater than this may be reported as any lower
+     *               bound that also exceeds @p limit.
+     * @return The end of the output range.
+     */
+    template <typename Iterator, typename OutputIterator>
+    OutputIterator
+    distance_many(const EnPronunciation& query, Iterator first, Iterator last, OutputIterator out,
+                  double limit = std::numeric_limits<double>::infinity()) const
+    {
+      constexpr std::size_t chunk_size = 64;
+      const std::vector<PhoneId>* targets[chunk_size];
+      double distances[chunk_size];
+
+      while (first != last) {
+        std::size_t count = 0;
+        for (; first != last && count < chunk_size; ++first) {
+          const EnPronunciation& target = *first;
+          targets[count++] = &target.phone_ids();
+        }
+        PhoneticDistance::distance_many(query.phone_ids(), targets, count, distances, limit);
+        out = std::copy(distances, distances + count, out);
+      }
+      return out;
+    }
   };
 }
 }
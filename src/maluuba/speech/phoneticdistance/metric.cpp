@@ -3,7 +3,23 @@
 
 #include "maluuba/speech/phoneticdistance.hpp"
 #include "maluuba/levenshtein.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define MALUUBA_SPEECH_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define MALUUBA_SPEECH_SSE2 1
+#endif
 
 // The vector representation of English phonemes used here is described in
 // Li & MacWhinneey (2002). PatPho: A phonological pattern generator for neural networks
@@ -177,7 +193,6 @@ namespace speech
       double
       operator()(const PhonemeVector& a, const PhonemeVector& b) const
       {
-        // TODO: Precompute these or use a faster metric than L2
         auto sum_sq = 0.0;
         for (int i = 0; i < 3; ++i) {
           float diff = a[i] - b[i];
@@ -202,6 +217,528 @@ namespace speech
         }
       }
     };
+
+    /** @return @c PhonemeDistance between two phones, in single precision. */
+    float
+    substitution_cost(const PhonemeVector& a, const PhonemeVector& b)
+    {
+      return static_cast<float>(PhonemeDistance{}(a, b));
+    }
+
+    /** @return @c PhonemeCost of a phone, in single precision. */
+    float
+    indel_cost(const PhonemeVector& phoneme)
+    {
+      return static_cast<float>(PhonemeCost{}(phoneme));
+    }
+
+    /**
+     * @c PhonemeDistance and @c PhonemeCost precomputed for the first
+     * @c max_ids interned phones, indexed by @c PhoneId, and rounded to single
+     * precision.  Phone ID strings with later phones are scored with a
+     * @c LocalCostTable instead.
+     */
+    class PhonemeCostTable
+    {
+    public:
+      /** Enough IDs for every phone in typical use, in 256 KiB of costs. */
+      static constexpr std::size_t max_ids = 256;
+
+      /**
+       * @return The shared table, covering every phone interned so far that
+       *         fits.
+       */
+      static const PhonemeCostTable&
+      get()
+      {
+        static PhonemeCostTable table;
+        table.update(std::min(Phone::id_count(), max_ids));
+        return table;
+      }
+
+      /**
+       * @return Whether every phone in @p ids has its costs in this table.
+       */
+      static bool
+      covers(const std::vector<PhoneId>& ids)
+      {
+        return std::all_of(ids.begin(), ids.end(), [](PhoneId id) { return id < max_ids; });
+      }
+
+      /**
+       * @return The substitution costs, as a flat array indexed by
+       *         <code>a * stride() + b</code>.
+       */
+      const float*
+      substitutions() const
+      {
+        return &m_substitution[0][0];
+      }
+
+      std::size_t
+      stride() const
+      {
+        return max_ids;
+      }
+
+      float
+      cost(PhoneId id) const
+      {
+        return m_cost[id];
+      }
+
+    private:
+      std::mutex m_mutex;
+      std::atomic<std::size_t> m_size{0};
+      float m_substitution[max_ids][max_ids];
+      float m_cost[max_ids];
+
+      /** Fill in the entries for any newly interned phones. */
+      void
+      update(std::size_t count)
+      {
+        if (m_size.load(std::memory_order_acquire) >= count) {
+          return;
+        }
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto size = m_size.load(std::memory_order_relaxed);
+        for (; size < count; ++size) {
+          auto id = static_cast<PhoneId>(size);
+          auto v = to_vector(Phone::from_id(id));
+          m_cost[id] = indel_cost(v);
+          for (std::size_t j = 0; j <= size; ++j) {
+            auto other = static_cast<PhoneId>(j);
+            auto d = substitution_cost(v, to_vector(Phone::from_id(other)));
+            m_substitution[id][other] = d;
+            m_substitution[other][id] = d;
+          }
+        }
+        m_size.store(size, std::memory_order_release);
+      }
+    };
+
+    /**
+     * The same costs as a @c PhonemeCostTable, computed on demand for only the
+     * phones of some phone ID strings, which are renumbered densely.  This is
+     * the slow path for phones beyond @c PhonemeCostTable::max_ids.
+     */
+    class LocalCostTable
+    {
+    public:
+      /**
+       * @return @p ids renumbered for this table, adding any new phones.
+       */
+      std::vector<PhoneId>
+      add(const std::vector<PhoneId>& ids)
+      {
+        std::vector<PhoneId> local;
+        local.reserve(ids.size());
+        for (auto id : ids) {
+          auto inserted = m_local_ids.emplace(id, static_cast<PhoneId>(m_phones.size()));
+          if (inserted.second) {
+            m_phones.push_back(to_vector(Phone::from_id(id)));
+          }
+          local.push_back(inserted.first->second);
+        }
+        return local;
+      }
+
+      /** Compute the costs of every phone added so far. */
+      void
+      update()
+      {
+        auto size = m_phones.size();
+        m_cost.resize(size);
+        m_substitution.resize(size*size);
+        for (std::size_t i = 0; i < size; ++i) {
+          m_cost[i] = indel_cost(m_phones[i]);
+          for (std::size_t j = 0; j <= i; ++j) {
+            auto d = substitution_cost(m_phones[i], m_phones[j]);
+            m_substitution[i*size + j] = d;
+            m_substitution[j*size + i] = d;
+          }
+        }
+      }
+
+      const float*
+      substitutions() const
+      {
+        return m_substitution.data();
+      }
+
+      std::size_t
+      stride() const
+      {
+        return m_phones.size();
+      }
+
+      float
+      cost(PhoneId id) const
+      {
+        return m_cost[id];
+      }
+
+    private:
+      std::unordered_map<PhoneId, PhoneId> m_local_ids;
+      std::vector<PhonemeVector> m_phones;
+      std::vector<float> m_cost;
+      std::vector<float> m_substitution;
+    };
+
+    /**
+     * Weighted Levenshtein distance between phone ID strings, using the costs
+     * from a @c PhonemeCostTable or @c LocalCostTable.
+     *
+     * The DP matrix is filled one anti-diagonal at a time.  The cells of an
+     * anti-diagonal depend only on the previous two, so they are computed
+     * several at a time with SIMD instructions where available (8 lanes with
+     * AVX2, 4 with SSE2), and one at a time otherwise.  Every lane performs
+     * exactly the same single-precision operations as the scalar code, so the
+     * result does not depend on the instruction set.
+     *
+     * @tparam Bounded  Whether to stop early once the distance must exceed @p limit.
+     * @param table  The substitution and insertion/deletion costs.
+     * @param a  The first phone ID string.
+     * @param b  The second phone ID string.
+     * @param limit  If every path through two consecutive anti-diagonals already
+     *               costs more than this, stop early and return that lower bound.
+     */
+    template <bool Bounded, typename CostTable>
+    float
+    phone_id_distance(const CostTable& table, const std::vector<PhoneId>& a, const std::vector<PhoneId>& b, float limit)
+    {
+      auto m = a.size();
+      auto n = b.size();
+      auto substitutions = table.substitutions();
+      auto stride = static_cast<std::int32_t>(table.stride());
+
+      // Row i of the matrix corresponds to a[i - 1], and column j to b[j - 1].
+      // Anti-diagonals are indexed by row, so cell (i, j) on diagonal k = i + j
+      // is at position i.  Columns are stored reversed, at position n - j, so
+      // that b[j - 1] is contiguous in i along a diagonal.
+      constexpr std::size_t small_size = 64;
+      auto size = std::max(m + 1, n) + 1;
+      float small_floats[5 * small_size];
+      std::int32_t small_ints[2 * small_size];
+      std::vector<float> large_floats;
+      std::vector<std::int32_t> large_ints;
+      float* floats = small_floats;
+      std::int32_t* ints = small_ints;
+      if (size > small_size) {
+        large_floats.resize(5 * size);
+        large_ints.resize(2 * size);
+        floats = large_floats.data();
+        ints = large_ints.data();
+      } else {
+        size = small_size;
+      }
+
+      auto row_cost = floats;
+      auto col_cost = floats + size;
+      auto diag0 = floats + 2 * size;
+      auto diag1 = floats + 3 * size;
+      auto diag2 = floats + 4 * size;
+      auto row_index = ints;
+      auto col_index = ints + size;
+
+      for (std::size_t i = 1; i <= m; ++i) {
+        row_cost[i] = table.cost(a[i - 1]);
+        row_index[i] = static_cast<std::int32_t>(a[i - 1]) * stride;
+      }
+      for (std::size_t r = 0; r < n; ++r) {
+        col_cost[r] = table.cost(b[n - r - 1]);
+        col_index[r] = b[n - r - 1];
+      }
+
+      // Costs of the first row and column, accumulated as the diagonals reach them
+      float first_row = 0.0f;
+      float first_col = 0.0f;
+      diag1[0] = 0.0f;
+      auto prev_min = 0.0f;
+
+      for (std::size_t k = 1; k <= m + n; ++k) {
+        auto first = k > n ? k - n : 0;
+        auto last = std::min(k, m);
+        auto diag_min = std::numeric_limits<float>::infinity();
+
+        if (first == 0) {
+          first_row += col_cost[n - k];
+          diag2[0] = first_row;
+          diag_min = std::min(diag_min, first_row);
+          first = 1;
+        }
+        if (last == k) {
+          first_col += row_cost[k];
+          diag2[k] = first_col;
+          diag_min = std::min(diag_min, first_col);
+          --last;
+        }
+
+        // Interior cells, i in [first, last], with column position r = n - k + i
+        auto i = first;
+        auto offset = n - k;
+#if MALUUBA_SPEECH_AVX2
+        auto vmin = _mm256_set1_ps(diag_min);
+        auto simd = i + 8 <= last + 1;
+        for (; i + 8 <= last + 1; i += 8) {
+          auto up = _mm256_add_ps(_mm256_loadu_ps(diag1 + i - 1), _mm256_loadu_ps(row_cost + i));
+          auto left = _mm256_add_ps(_mm256_loadu_ps(diag1 + i), _mm256_loadu_ps(col_cost + offset + i));
+          auto index = _mm256_add_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_index + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col_index + offset + i)));
+          auto sub = _mm256_add_ps(_mm256_loadu_ps(diag0 + i - 1), _mm256_i32gather_ps(substitutions, index, sizeof(float)));
+          auto cell = _mm256_min_ps(_mm256_min_ps(up, left), sub);
+          _mm256_storeu_ps(diag2 + i, cell);
+          vmin = _mm256_min_ps(vmin, cell);
+        }
+        if (Bounded && simd) {
+          float lanes[8];
+          _mm256_storeu_ps(lanes, vmin);
+          diag_min = *std::min_element(lanes, lanes + 8);
+        }
+#elif MALUUBA_SPEECH_SSE2
+        auto vmin = _mm_set1_ps(diag_min);
+        auto simd = i + 4 <= last + 1;
+        for (; i + 4 <= last + 1; i += 4) {
+          auto up = _mm_add_ps(_mm_loadu_ps(diag1 + i - 1), _mm_loadu_ps(row_cost + i));
+          auto left = _mm_add_ps(_mm_loadu_ps(diag1 + i), _mm_loadu_ps(col_cost + offset + i));
+          auto r = row_index + i;
+          auto c = col_index + offset + i;
+          auto gathered = _mm_setr_ps(
+            substitutions[r[0] + c[0]],
+            substitutions[r[1] + c[1]],
+            substitutions[r[2] + c[2]],
+            substitutions[r[3] + c[3]]);
+          auto sub = _mm_add_ps(_mm_loadu_ps(diag0 + i - 1), gathered);
+          auto cell = _mm_min_ps(_mm_min_ps(up, left), sub);
+          _mm_storeu_ps(diag2 + i, cell);
+          vmin = _mm_min_ps(vmin, cell);
+        }
+        if (Bounded && simd) {
+          float lanes[4];
+          _mm_storeu_ps(lanes, vmin);
+          diag_min = *std::min_element(lanes, lanes + 4);
+        }
+#endif
+        for (; i <= last; ++i) {
+          auto up = diag1[i - 1] + row_cost[i];
+          auto left = diag1[i] + col_cost[offset + i];
+          auto sub = diag0[i - 1] + substitutions[row_index[i] + col_index[offset + i]];
+          auto cell = std::min(std::min(up, left), sub);
+          diag2[i] = cell;
+          diag_min = std::min(diag_min, cell);
+        }
+
+        // Every path crosses either this diagonal or the previous one
+        if (Bounded) {
+          if (diag_min > limit && prev_min > limit) {
+            return std::min(diag_min, prev_min);
+          }
+          prev_min = diag_min;
+        }
+
+        std::swap(diag0, diag1);
+        std::swap(diag1, diag2);
+      }
+
+      return diag1[m];
+    }
+
+#if MALUUBA_SPEECH_AVX2 || MALUUBA_SPEECH_SSE2
+#if MALUUBA_SPEECH_AVX2
+    constexpr std::size_t simd_lanes = 8;
+    using FloatVector = __m256;
+
+    FloatVector simd_set1(float x) { return _mm256_set1_ps(x); }
+    FloatVector simd_load(const float* p) { return _mm256_loadu_ps(p); }
+    void simd_store(float* p, FloatVector v) { _mm256_storeu_ps(p, v); }
+    FloatVector simd_add(FloatVector a, FloatVector b) { return _mm256_add_ps(a, b); }
+    FloatVector simd_min(FloatVector a, FloatVector b) { return _mm256_min_ps(a, b); }
+
+    /** @return <code>base[index[lane]]</code> in every lane. */
+    FloatVector
+    simd_gather(const float* base, const std::int32_t* index)
+    {
+      return _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index)), sizeof(float));
+    }
+#else
+    constexpr std::size_t simd_lanes = 4;
+    using FloatVector = __m128;
+
+    FloatVector simd_set1(float x) { return _mm_set1_ps(x); }
+    FloatVector simd_load(const float* p) { return _mm_loadu_ps(p); }
+    void simd_store(float* p, FloatVector v) { _mm_storeu_ps(p, v); }
+    FloatVector simd_add(FloatVector a, FloatVector b) { return _mm_add_ps(a, b); }
+    FloatVector simd_min(FloatVector a, FloatVector b) { return _mm_min_ps(a, b); }
+
+    /** @return <code>base[index[lane]]</code> in every lane. */
+    FloatVector
+    simd_gather(const float* base, const std::int32_t* index)
+    {
+      return _mm_setr_ps(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+    }
+#endif
+
+    /**
+     * Weighted Levenshtein distance from one phone ID string to many, with a
+     * different target in each SIMD lane.
+     *
+     * Targets are sorted by length and packed @c simd_lanes at a time.  The
+     * query is laid out along the rows of the DP matrix, so all the lanes
+     * advance through their targets' columns together, and each lane's result
+     * is read off once its own target ends.  The cells perform the same
+     * operations as @c phone_id_distance() (with the arguments transposed,
+     * which the metric is exactly symmetric under), so the exact results are
+     * identical.
+     *
+     * @tparam Bounded  Whether to stop early once every distance must exceed
+     *                  @p limit.  Abandoned lanes report the minimum of their
+     *                  last column, a lower bound that exceeds @p limit.
+     */
+    template <bool Bounded, typename CostTable>
+    void
+    phone_id_distance_many(const CostTable& table, const std::vector<PhoneId>& query, const std::vector<PhoneId>* const* targets, std::size_t count, double* distances, float limit)
+    {
+      constexpr auto lanes = simd_lanes;
+      auto m = query.size();
+      auto substitutions = table.substitutions();
+
+      std::vector<std::size_t> order(count);
+      for (std::size_t t = 0; t < count; ++t) {
+        order[t] = t;
+      }
+      std::stable_sort(order.begin(), order.end(), [&](std::size_t l, std::size_t r) {
+        return targets[l]->size() < targets[r]->size();
+      });
+
+      // The first column, which only depends on the query
+      std::vector<float> query_cost(m + 1);
+      std::vector<float> first_col(m + 1);
+      for (std::size_t i = 1; i <= m; ++i) {
+        query_cost[i] = table.cost(query[i - 1]);
+        first_col[i] = first_col[i - 1] + query_cost[i];
+      }
+
+      // One column of the DP matrix per lane, interleaved by row
+      std::vector<float> column((m + 1)*lanes);
+      std::vector<std::int32_t> target_index;
+      std::vector<float> target_cost;
+
+      for (std::size_t group = 0; group < count; group += lanes) {
+        auto width = std::min(lanes, count - group);
+        const std::size_t* members = &order[group];
+        auto n_max = targets[members[width - 1]]->size();
+
+        // Transpose the group's targets so that each column's phones are
+        // contiguous across lanes.  Missing lanes and positions are padded
+        // with phone 0 and never read back.
+        target_index.assign(n_max*lanes, 0);
+        target_cost.assign(n_max*lanes, 0.0f);
+        for (std::size_t lane = 0; lane < width; ++lane) {
+          const auto& target = *targets[members[lane]];
+          for (std::size_t j = 0; j < target.size(); ++j) {
+            target_index[j*lanes + lane] = target[j];
+            target_cost[j*lanes + lane] = table.cost(target[j]);
+          }
+        }
+
+        for (std::size_t i = 0; i <= m; ++i) {
+          std::fill_n(&column[i*lanes], lanes, first_col[i]);
+        }
+
+        // Lanes [0, done) have already been reported
+        std::size_t done = 0;
+        bool abandoned[simd_lanes] = {};
+        for (std::size_t j = 0; done < width; ++j) {
+          if (j > 0) {
+            auto t_cost = simd_load(&target_cost[(j - 1)*lanes]);
+            const std::int32_t* t_index = &target_index[(j - 1)*lanes];
+
+            auto diag = simd_load(&column[0]);
+            auto above = simd_add(diag, t_cost);
+            simd_store(&column[0], above);
+            auto col_min = above;
+            for (std::size_t i = 1; i <= m; ++i) {
+              // column[i] still holds the previous column's entry for this row
+              auto prev = simd_load(&column[i*lanes]);
+              auto del = simd_add(prev, t_cost);
+              auto ins = simd_add(above, simd_set1(query_cost[i]));
+              auto row = substitutions + static_cast<std::size_t>(query[i - 1])*table.stride();
+              auto sub = simd_add(diag, simd_gather(row, t_index));
+              above = simd_min(simd_min(del, ins), sub);
+              simd_store(&column[i*lanes], above);
+              if (Bounded) {
+                col_min = simd_min(col_min, above);
+              }
+              diag = prev;
+            }
+
+            if (Bounded) {
+              // Every path crosses every column
+              float mins[simd_lanes];
+              simd_store(mins, col_min);
+              for (std::size_t lane = done; lane < width; ++lane) {
+                if (!abandoned[lane] && mins[lane] > limit) {
+                  abandoned[lane] = true;
+                  distances[members[lane]] = mins[lane];
+                }
+              }
+            }
+          }
+
+          for (; done < width && targets[members[done]]->size() == j; ++done) {
+            if (!abandoned[done]) {
+              distances[members[done]] = column[m*lanes + done];
+            }
+          }
+
+          if (Bounded && std::all_of(abandoned + done, abandoned + width, [](bool a) { return a; })) {
+            break;
+          }
+        }
+      }
+    }
+#endif
+
+    template <bool Bounded>
+    float
+    phone_id_distance(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b, float limit)
+    {
+      const auto& table = PhonemeCostTable::get();
+      if (table.covers(a) && table.covers(b)) {
+        return phone_id_distance<Bounded>(table, a, b, limit);
+      }
+
+      LocalCostTable local;
+      auto local_a = local.add(a);
+      auto local_b = local.add(b);
+      local.update();
+      return phone_id_distance<Bounded>(local, local_a, local_b, limit);
+    }
+
+    template <typename CostTable>
+    void
+    phone_id_distance_many(const CostTable& table, const std::vector<PhoneId>& query, const std::vector<PhoneId>* const* targets, std::size_t count, double* distances, float limit)
+    {
+      auto bounded = limit < std::numeric_limits<float>::infinity();
+
+#if MALUUBA_SPEECH_AVX2 || MALUUBA_SPEECH_SSE2
+      if (bounded) {
+        phone_id_distance_many<true>(table, query, targets, count, distances, limit);
+      } else {
+        phone_id_distance_many<false>(table, query, targets, count, distances, limit);
+      }
+#else
+      for (std::size_t t = 0; t < count; ++t) {
+        if (bounded) {
+          distances[t] = phone_id_distance<true>(table, *targets[t], query, limit);
+        } else {
+          distances[t] = phone_id_distance<false>(table, *targets[t], query, limit);
+        }
+      }
+#endif
+    }
   }
 
   PhonemeVector::PhonemeVector(float v[3], bool syllabic)
@@ -243,5 +780,45 @@ namespace speech
     LevenshteinDistance<PhonemeDistance, PhonemeCost> metric{PhonemeDistance{}, PhonemeCost{}};
     return metric(a, b);
   }
+
+  double
+  PhoneticDistance::operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b) const
+  {
+    return phone_id_distance<false>(a, b, std::numeric_limits<float>::infinity());
+  }
+
+  double
+  PhoneticDistance::operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b, double limit) const
+  {
+    return phone_id_distance<true>(a, b, static_cast<float>(limit));
+  }
+
+  void
+  PhoneticDistance::distance_many(const std::vector<PhoneId>& query, const std::vector<PhoneId>* const* targets, std::size_t count, double* distances, double limit) const
+  {
+    const auto& table = PhonemeCostTable::get();
+    auto float_limit = static_cast<float>(limit);
+
+    auto covered = table.covers(query);
+    for (std::size_t t = 0; covered && t < count; ++t) {
+      covered = table.covers(*targets[t]);
+    }
+    if (covered) {
+      phone_id_distance_many(table, query, targets, count, distances, float_limit);
+      return;
+    }
+
+    LocalCostTable local;
+    auto local_query = local.add(query);
+    std::vector<std::vector<PhoneId>> local_targets;
+    std::vector<const std::vector<PhoneId>*> local_target_ptrs;
+    local_targets.reserve(count);
+    for (std::size_t t = 0; t < count; ++t) {
+      local_targets.push_back(local.add(*targets[t]));
+      local_target_ptrs.push_back(&local_targets.back());
+    }
+    local.update();
+    phone_id_distance_many(local, local_query, local_target_ptrs.data(), count, distances, float_limit);
+  }
 }
 }
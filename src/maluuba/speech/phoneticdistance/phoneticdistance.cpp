@@ -14,7 +14,25 @@ namespace speech
   double
   EnPhoneticDistance::operator()(const EnPronunciation& a, const EnPronunciation& b) const
   {
-    return PhoneticDistance::operator()(phonetic_embedding(a), phonetic_embedding(b));
+    return PhoneticDistance::operator()(a.phone_ids(), b.phone_ids());
+  }
+
+  double
+  EnPhoneticDistance::operator()(const EnPronunciation& a, const EnPronunciation& b, double limit) const
+  {
+    return PhoneticDistance::operator()(a.phone_ids(), b.phone_ids(), limit);
+  }
+
+  double
+  EnPhoneticDistance::operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b) const
+  {
+    return PhoneticDistance::operator()(a, b);
+  }
+
+  double
+  EnPhoneticDistance::operator()(const std::vector<PhoneId>& a, const std::vector<PhoneId>& b, double limit) const
+  {
+    return PhoneticDistance::operator()(a, b, limit);
   }
 }
 }
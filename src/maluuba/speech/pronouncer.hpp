@@ -12,14 +12,38 @@
 #ifndef MALUUBA_SPEECH_PRONOUNCER_HPP
 #define MALUUBA_SPEECH_PRONOUNCER_HPP
 
+#include "maluuba/lrucache.hpp"
 #include "maluuba/speech/pronunciation.hpp"
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace maluuba
 {
 namespace speech
 {
+  /**
+   * The flite modules an @c EnPronouncer runs.
+   */
+  enum class PronouncerPipeline
+  {
+    /**
+     * Text analysis, part of speech tagging, lexical lookup (with
+     * letter-to-sound rules for unknown words) and the post-lexical rules,
+     * which together settle the phones and their stress.  Words are looked up
+     * in a hash index of the whole lexicon, built once per process when the
+     * first such pronouncer is created, rather than by searching and decoding
+     * flite's compressed lexicon.
+     */
+    LEXICAL,
+    /**
+     * The whole synthesis pipeline, including the intonation, duration and
+     * F0 models, whose output pronunciations ignore.
+     */
+    FULL,
+  };
+
   class Pronouncer
   {
   public:
@@ -30,10 +54,30 @@ namespace speech
     Pronouncer& operator=(Pronouncer&& other) = default;
   };
 
+  /**
+   * Pronounces English texts with flite.
+   *
+   * An @c EnPronouncer is thread-safe: any number of threads may call
+   * @c pronounce() on the same pronouncer at once.  flite's utterance
+   * processing isn't known to be reentrant, so each concurrent call
+   * synthesizes with a flite voice of its own.  A pronouncer creates voices
+   * as it needs them and keeps them for reuse, so it holds as many voices as
+   * the most calls it has run at once.  flite's global initialization happens
+   * once per process, and voices are created one at a time.
+   */
   class EnPronouncer: public Pronouncer
   {
   public:
     EnPronouncer();
+
+    /**
+     * Create a pronouncer that runs the given @p pipeline.  The default
+     * constructor runs @c FULL.  @c LEXICAL is faster and is meant to produce
+     * the same pronunciations, but it's opt-in until that has been checked
+     * against a corpus.
+     */
+    explicit EnPronouncer(PronouncerPipeline pipeline);
+
     virtual ~EnPronouncer();
 
     EnPronouncer(EnPronouncer&& other);
@@ -41,8 +85,57 @@ namespace speech
 
     EnPronunciation pronounce(const std::string& text) const;
 
+    /**
+     * Pronounce many texts in parallel, each distinct text only once.
+     *
+     * @param texts  The texts to pronounce.
+     * @param threads  The number of threads, or 0 for one per hardware thread.
+     * @return The pronunciation of each text, in the same order.
+     */
+    std::vector<EnPronunciation> pronounce_all(const std::vector<std::string>& texts, std::size_t threads = 0) const;
+
+    /**
+     * Set the memory budget of the pronunciation cache, which every
+     * @c EnPronouncer in the process shares.  Texts pronounced before are
+     * looked up instead of synthesized again, and the least recently used
+     * are evicted to stay within the budget.
+     *
+     * @param bytes  The budget, or 0 (the default) to disable the cache.
+     */
+    static void set_cache_budget(std::size_t bytes);
+
+    /**
+     * @return The memory budget of the pronunciation cache.
+     */
+    static std::size_t cache_budget();
+
+    /**
+     * @return The counts of the pronunciation cache.
+     */
+    static CacheStats cache_stats();
+
+    /**
+     * Empty the pronunciation cache.
+     */
+    static void clear_cache();
+
+    /**
+     * Check the lexicon index that @c PronouncerPipeline::LEXICAL uses against
+     * flite's own lookups, for every entry in the lexicon.  This is meant for
+     * tests.
+     *
+     * @return The entries (as "pos word") that the index lacks or disagrees
+     *         with flite on.
+     * @throws std::logic_error  If the index is empty.
+     */
+    static std::vector<std::string> check_lexicon_index();
+
   private:
     struct Impl;
+
+    /** Pronounce @p text with flite, bypassing the cache. */
+    EnPronunciation synthesize(const std::string& text) const;
+
     std::unique_ptr<Impl> m_impl;
   };
 }
@@ -0,0 +1,228 @@
+/**
+ * @file
+ * Hashed index of lexicon pronunciations.
+ *
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ */
+
+#ifndef MALUUBA_SPEECH_PRONOUNCER_LEXICONINDEX_HPP
+#define MALUUBA_SPEECH_PRONOUNCER_LEXICONINDEX_HPP
+
+#include "maluuba/debug.hpp"
+#include "maluuba/xtd/string_view.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace maluuba
+{
+namespace speech
+{
+namespace internal
+{
+  /**
+   * An open-addressing hash index from words and their parts of speech to the
+   * phones a lexicon gives them.  Phones are interned, so each entry stores
+   * its word and a sequence of small phone IDs in shared arrays instead of
+   * owning its own allocations.
+   *
+   * An index is built once, with @c insert(), and only read after that, so
+   * any number of threads may look words up in a built index at once.
+   */
+  class LexiconIndex
+  {
+  public:
+    /** The ID of an interned phone. */
+    using PhoneIndex = std::uint8_t;
+
+    LexiconIndex()
+      : m_slots(16)
+    { }
+
+    /**
+     * Look up the phones of a word.
+     *
+     * @param word  The word.
+     * @param pos  Its part of speech.
+     * @param visitor  Called with each phone's name (a <tt>const std::string&</tt>)
+     *                 in order.
+     * @return Whether the word was found.
+     */
+    template <typename Visitor>
+    bool
+    find(xtd::string_view word, xtd::string_view pos, Visitor&& visitor) const
+    {
+      auto hash = hash_of(word, pos);
+      auto slot = find_slot(hash, word, pos);
+      if (slot->key_size == 0) {
+        return false;
+      }
+
+      for (std::size_t i = 0; i < slot->phones_size; ++i) {
+        visitor(m_phone_names[m_phones[slot->phones_offset + i]]);
+      }
+      return true;
+    }
+
+    /**
+     * Add the phones of a word, unless it's already indexed.  This isn't
+     * thread-safe, so an index must be built before it's shared.
+     *
+     * @param word  The word.
+     * @param pos  Its part of speech.
+     * @param phones  The names of its phones, in order.
+     */
+    void
+    insert(xtd::string_view word, xtd::string_view pos, const std::vector<std::string>& phones)
+    {
+      check_logic(!word.empty(), "Indexed words can't be empty");
+
+      auto hash = hash_of(word, pos);
+      auto slot = find_slot(hash, word, pos);
+      if (slot->key_size != 0) {
+        return;
+      }
+
+      // Intern the phones first, so a failure can't leave a partial entry
+      auto phones_offset = m_phones.size();
+      for (const auto& phone : phones) {
+        m_phones.push_back(intern(phone));
+      }
+
+      // Keep the load factor at most 1/2 so probe sequences stay short
+      if (2*(m_size + 1) > m_slots.size()) {
+        grow();
+        slot = find_slot(hash, word, pos);
+      }
+
+      slot->hash = hash;
+      slot->key_offset = m_keys.size();
+      slot->word_size = word.size();
+      slot->key_size = word.size() + pos.size();
+      m_keys.append(word.data(), word.size());
+      m_keys.append(pos.data(), pos.size());
+
+      slot->phones_offset = phones_offset;
+      slot->phones_size = phones.size();
+      ++m_size;
+    }
+
+    /**
+     * @return The number of indexed words.
+     */
+    std::size_t
+    size() const
+    {
+      return m_size;
+    }
+
+  private:
+    struct Slot
+    {
+      std::uint64_t hash = 0;
+      std::uint32_t key_offset = 0;
+      /** The length of the word and part of speech, or 0 for empty slots. */
+      std::uint32_t key_size = 0;
+      std::uint32_t word_size = 0;
+      std::uint32_t phones_offset = 0;
+      std::uint32_t phones_size = 0;
+    };
+
+    std::vector<Slot> m_slots;
+    std::size_t m_size = 0;
+    /** The words and parts of speech of every entry, back to back. */
+    std::string m_keys;
+    /** The phones of every entry, back to back. */
+    std::vector<PhoneIndex> m_phones;
+    /** The names of the interned phones. */
+    std::vector<std::string> m_phone_names;
+
+    /** FNV-1a over the word, a separator, and the part of speech. */
+    static std::uint64_t
+    hash_of(xtd::string_view word, xtd::string_view pos)
+    {
+      std::uint64_t hash = 0xCBF29CE484222325ULL;
+      auto mix = [&](unsigned char c) {
+        hash ^= c;
+        hash *= 0x100000001B3ULL;
+      };
+
+      for (auto c : word) {
+        mix(c);
+      }
+      mix('\0');
+      for (auto c : pos) {
+        mix(c);
+      }
+      return hash;
+    }
+
+    /** @return The slot that holds the key, or the empty slot where it would go. */
+    Slot*
+    find_slot(std::uint64_t hash, xtd::string_view word, xtd::string_view pos)
+    {
+      return const_cast<Slot*>(static_cast<const LexiconIndex*>(this)->find_slot(hash, word, pos));
+    }
+
+    const Slot*
+    find_slot(std::uint64_t hash, xtd::string_view word, xtd::string_view pos) const
+    {
+      // Linear probing; the size is a power of two
+      auto mask = m_slots.size() - 1;
+      for (auto i = hash & mask; ; i = (i + 1) & mask) {
+        const auto& slot = m_slots[i];
+        if (slot.key_size == 0) {
+          return &slot;
+        }
+
+        if (slot.hash == hash
+            && slot.word_size == word.size()
+            && slot.key_size == word.size() + pos.size()
+            && m_keys.compare(slot.key_offset, word.size(), word.data(), word.size()) == 0
+            && m_keys.compare(slot.key_offset + word.size(), pos.size(), pos.data(), pos.size()) == 0) {
+          return &slot;
+        }
+      }
+    }
+
+    /** Double the number of slots, rehashing the entries. */
+    void
+    grow()
+    {
+      std::vector<Slot> slots(2*m_slots.size());
+      auto mask = slots.size() - 1;
+      for (const auto& slot : m_slots) {
+        if (slot.key_size != 0) {
+          auto i = slot.hash & mask;
+          while (slots[i].key_size != 0) {
+            i = (i + 1) & mask;
+          }
+          slots[i] = slot;
+        }
+      }
+      m_slots.swap(slots);
+    }
+
+    /** @return The ID of the phone named @p name, interning it if necessary. */
+    PhoneIndex
+    intern(const std::string& name)
+    {
+      for (std::size_t i = 0; i < m_phone_names.size(); ++i) {
+        if (m_phone_names[i] == name) {
+          return i;
+        }
+      }
+
+      check_logic(m_phone_names.size() <= std::numeric_limits<PhoneIndex>::max(), "Too many distinct phones");
+      m_phone_names.push_back(name);
+      return m_phone_names.size() - 1;
+    }
+  };
+}
+}
+}
+
+#endif // MALUUBA_SPEECH_PRONOUNCER_LEXICONINDEX_HPP
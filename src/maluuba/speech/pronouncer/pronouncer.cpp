@@ -2,10 +2,19 @@
 // Licensed under the MIT License.
 
 #include "maluuba/speech/pronouncer.hpp"
+#include "lexiconindex.hpp"
+#include "maluuba/taskpool.hpp"
+#include "maluuba/xtd/optional.hpp"
+#include "maluuba/xtd/string_view.hpp"
 #include <flite/lang/cmulex/cmu_lex.h>
 #include <flite/lang/usenglish/usenglish.h>
 #include <flite.h>
 #include <memory>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace maluuba
 {
@@ -19,13 +28,177 @@ namespace speech
       return u;
     }
 
+    cst_utterance*
+    no_prosody(cst_utterance* u)
+    {
+      return u;
+    }
+
+    /**
+     * @return The CMU lexicon, initializing flite the first time.
+     */
+    cst_lexicon*
+    cmu_lexicon()
+    {
+      static cst_lexicon* lex = [] {
+        flite_init();
+        return cmu_lex_init();
+      }();
+      return lex;
+    }
+
+    /**
+     * @return The part of speech that flite's lexicon keys @p pos by: its
+     *         first letter, or "0" for none.
+     */
+    xtd::string_view
+    lexicon_pos(const char* pos)
+    {
+      if (!pos) {
+        return "0";
+      }
+      return {pos, pos[0] ? std::size_t{1} : std::size_t{0}};
+    }
+
+    /**
+     * Call <code>visit(word, pos)</code> for every entry of a compressed flite
+     * lexicon.
+     *
+     * The lexicon stores each entry as its phones (in reverse), a 255 byte,
+     * then its part of speech and word (one string), and a 0 byte.  The word
+     * may be compressed with a table of byte strings.
+     */
+    template <typename Visitor>
+    void
+    for_each_lexicon_entry(const cst_lexicon* lex, Visitor&& visit)
+    {
+      std::string key;
+      for (int p = 1; p < lex->num_bytes; ++p) {
+        if (lex->data[p - 1] != 255) {
+          continue;
+        }
+
+        key.clear();
+        for (; p < lex->num_bytes && lex->data[p] != 0; ++p) {
+          if (lex->entry_hufftable) {
+            key += lex->entry_hufftable[lex->data[p]];
+          } else {
+            key += static_cast<char>(lex->data[p]);
+          }
+        }
+
+        if (key.size() > 1) {
+          xtd::string_view entry{key};
+          visit(entry.substr(1), entry.substr(0, 1));
+        }
+      }
+    }
+
+    /**
+     * @return The names of the phones in a list from flite, which is deleted.
+     */
+    std::vector<std::string>
+    phone_names(cst_val* phones)
+    {
+      std::vector<std::string> names;
+      for (const cst_val* p = phones; p; p = val_cdr(p)) {
+        names.emplace_back(val_string(val_car(p)));
+      }
+      delete_val(phones);
+      return names;
+    }
+
+    /**
+     * Index every word in a lexicon.  The phones come from flite's own
+     * lookups, so the index agrees with them whatever the lexicon's addenda
+     * and duplicates say.
+     */
+    internal::LexiconIndex
+    build_lexicon_index(const cst_lexicon* lex)
+    {
+      internal::LexiconIndex index;
+      std::string word;
+      std::string pos;
+      for_each_lexicon_entry(lex, [&](xtd::string_view entry_word, xtd::string_view entry_pos) {
+        word.assign(entry_word.data(), entry_word.size());
+        pos.assign(entry_pos.data(), entry_pos.size());
+        if (!in_lex(lex, word.c_str(), pos.c_str(), nullptr)) {
+          return;
+        }
+
+        index.insert(word, pos, phone_names(lex_lookup(lex, word.c_str(), pos.c_str(), nullptr)));
+      });
+      return index;
+    }
+
+    /**
+     * @return The index of the CMU lexicon, built the first time.
+     */
+    const internal::LexiconIndex&
+    lexicon_index()
+    {
+      static const internal::LexiconIndex index = build_lexicon_index(cmu_lexicon());
+      return index;
+    }
+
+    /**
+     * @return The phones of a word from the lexicon index, or @c nullptr for
+     *         words flite should look up itself.
+     */
+    cst_val*
+    indexed_phones(const char* word, const char* pos)
+    {
+      cst_val* phones = nullptr;
+      auto found = lexicon_index().find(word, lexicon_pos(pos), [&](const std::string& phone) {
+        phones = cons_val(string_val(phone.c_str()), phones);
+      });
+      return found ? val_reverse(phones) : nullptr;
+    }
+
+    /**
+     * Lexical insertion that takes the phones of in-vocabulary words from the
+     * lexicon index instead of searching and decoding flite's compressed
+     * lexicon.  The phones are given to flite as explicit pronunciations of
+     * their tokens, which its own lexical insertion then syllabifies as usual.
+     */
+    cst_utterance*
+    indexed_lexical_insertion(cst_utterance* u)
+    {
+      for (auto word = relation_head(utt_relation(u, "Word")); word; word = item_next(word)) {
+        // A token's pronunciation applies to each of its words, so only tokens
+        // of a single word can take one from the index
+        auto token_word = item_as(word, "Token");
+        if (!token_word || item_prev(token_word) || item_next(token_word)) {
+          continue;
+        }
+        auto token = item_parent(token_word);
+        if (!token || item_feat_present(token, "phones")) {
+          continue;
+        }
+
+        auto phones = indexed_phones(item_feat_string(word, "name"), ffeature_string(word, "pos"));
+        if (phones) {
+          item_set(token, "phones", phones);
+        }
+      }
+
+      return default_lexical_insertion(u);
+    }
+
+    /** Serializes voice creation, which isn't known to be reentrant. */
+    std::mutex voice_mutex;
+
     cst_voice*
-    no_wave_voice()
+    no_wave_voice(PronouncerPipeline pipeline)
     {
-      flite_init();
+      cst_lexicon* lex = cmu_lexicon();
+      if (pipeline == PronouncerPipeline::LEXICAL) {
+        // Index the lexicon up front, rather than on a pronouncer's first use
+        lexicon_index();
+      }
 
+      std::lock_guard<std::mutex> lock{voice_mutex};
       cst_voice* v = new_voice();
-      cst_lexicon* lex;
 
       v->name = "no_wave_voice";
 
@@ -34,7 +207,6 @@ namespace speech
       feat_set_string(v->features, "name", "cmu_us_no_wave");
 
       // Lexicon
-      lex = cmu_lex_init();
       feat_set(v->features, "lexicon", lexicon_val(lex));
 
       // Post lexical rules
@@ -43,25 +215,180 @@ namespace speech
       // Waveform synthesis: diphone_synth
       feat_set(v->features, "wave_synth_func", uttfunc_val(&no_wave_synth));
 
+      if (pipeline == PronouncerPipeline::LEXICAL) {
+        // The segments and their stress are settled once the post-lexical
+        // rules run, so the prosody modules would only feed the waveform
+        feat_set(v->features, "intonation_func", uttfunc_val(&no_prosody));
+        feat_set(v->features, "duration_model_func", uttfunc_val(&no_prosody));
+        feat_set(v->features, "f0_model_func", uttfunc_val(&no_prosody));
+
+        feat_set(v->features, "lexical_insertion_func", uttfunc_val(&indexed_lexical_insertion));
+      }
+
       return v;
     }
+
+    /**
+     * @return The stress of the syllable that holds the segment @p s, like the
+     *         path feature "R:SylStructure.parent.stress" without parsing the
+     *         path for every segment.
+     */
+    const char*
+    syllable_stress(const cst_item* s)
+    {
+      auto syllable = item_as(s, "SylStructure");
+      if (syllable) {
+        syllable = item_parent(syllable);
+      }
+      if (syllable && item_feat_present(syllable, "stress")) {
+        return item_feat_string(syllable, "stress");
+      } else {
+        return "0";
+      }
+    }
+
+    /**
+     * Cached pronunciations are keyed by pipeline too, so pronouncers that
+     * run different pipelines never see each other's results.
+     */
+    struct CacheKey
+    {
+      PronouncerPipeline pipeline;
+      std::string text;
+
+      bool
+      operator==(const CacheKey& other) const
+      {
+        return pipeline == other.pipeline && text == other.text;
+      }
+    };
+
+    struct CacheKeyHash
+    {
+      std::size_t
+      operator()(const CacheKey& key) const
+      {
+        return std::hash<std::string>{}(key.text) ^ static_cast<std::size_t>(key.pipeline);
+      }
+    };
+
+    using PronunciationCache = LruCache<CacheKey, EnPronunciation, CacheKeyHash>;
+
+    PronunciationCache&
+    pronunciation_cache()
+    {
+      static PronunciationCache cache;
+      return cache;
+    }
+
+    /** @return An estimate of the heap memory owned by a cache entry. */
+    std::size_t
+    cache_cost(const CacheKey& key, const EnPronunciation& pronunciation)
+    {
+      // The IPA form takes one or two UTF-16 units per phone
+      return key.text.capacity() + pronunciation.size()*(sizeof(PhoneId) + 2*sizeof(char16_t));
+    }
   }
 
   Pronouncer::~Pronouncer() = default;
 
   using VoiceHandle = std::unique_ptr<cst_voice, decltype(delete_voice)*>;
 
+  /**
+   * The flite voices of a pronouncer.  Each synthesis borrows a voice that no
+   * other thread is using, creating one if they're all busy.
+   */
   struct EnPronouncer::Impl
   {
-    VoiceHandle voice;
+    PronouncerPipeline pipeline;
+    std::mutex mutex;
+    /** Every voice, busy or idle. */
+    std::vector<VoiceHandle> voices;
+    /** The idle voices, with room for all of them. */
+    std::vector<cst_voice*> idle;
 
-    Impl()
-      : voice{no_wave_voice(), delete_voice}
-    { }
+    explicit Impl(PronouncerPipeline pipeline)
+      : pipeline{pipeline}
+    {
+      release(create());
+    }
+
+    /** @return An idle voice, now busy. */
+    cst_voice*
+    acquire()
+    {
+      {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (!idle.empty()) {
+          auto voice = idle.back();
+          idle.pop_back();
+          return voice;
+        }
+      }
+
+      return create();
+    }
+
+    /** Make a voice from @c acquire() idle again. */
+    void
+    release(cst_voice* voice)
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      idle.push_back(voice);
+    }
+
+    /**
+     * Borrows a voice for as long as it lives.
+     */
+    class Lease
+    {
+    public:
+      explicit Lease(Impl& impl)
+        : m_impl{impl},
+          m_voice{impl.acquire()}
+      { }
+
+      ~Lease()
+      {
+        m_impl.release(m_voice);
+      }
+
+      Lease(const Lease&) = delete;
+      Lease& operator=(const Lease&) = delete;
+
+      cst_voice*
+      get() const
+      {
+        return m_voice;
+      }
+
+    private:
+      Impl& m_impl;
+      cst_voice* m_voice;
+    };
+
+  private:
+    /** @return A new, busy voice. */
+    cst_voice*
+    create()
+    {
+      VoiceHandle voice{no_wave_voice(pipeline), delete_voice};
+
+      std::lock_guard<std::mutex> lock{mutex};
+      // Reserve first, so release() never needs to allocate
+      voices.reserve(voices.size() + 1);
+      idle.reserve(voices.size() + 1);
+      voices.push_back(std::move(voice));
+      return voices.back().get();
+    }
   };
 
   EnPronouncer::EnPronouncer()
-    : m_impl{std::make_unique<Impl>()}
+    : EnPronouncer{PronouncerPipeline::FULL}
+  { }
+
+  EnPronouncer::EnPronouncer(PronouncerPipeline pipeline)
+    : m_impl{std::make_unique<Impl>(pipeline)}
   { }
 
   EnPronouncer::~EnPronouncer() = default;
@@ -73,12 +400,121 @@ namespace speech
 
   EnPronunciation
   EnPronouncer::pronounce(const std::string& text) const
+  {
+    auto& cache = pronunciation_cache();
+    CacheKey key{m_impl->pipeline, text};
+    auto cached = cache.find(key);
+    if (cached) {
+      return std::move(*cached);
+    }
+
+    auto pronunciation = synthesize(text);
+    if (cache.budget() > 0) {
+      cache.insert(key, pronunciation, cache_cost(key, pronunciation));
+    }
+    return pronunciation;
+  }
+
+  std::vector<EnPronunciation>
+  EnPronouncer::pronounce_all(const std::vector<std::string>& texts, std::size_t threads) const
+  {
+    // Enough chunks to balance uneven texts, few enough to amortize joining them
+    constexpr std::size_t chunks_per_thread = 4;
+
+    std::unordered_map<xtd::string_view, std::size_t> distinct_indices;
+    std::vector<const std::string*> distinct;
+    std::vector<std::size_t> indices;
+    indices.reserve(texts.size());
+    for (const auto& text : texts) {
+      auto inserted = distinct_indices.emplace(text, distinct.size());
+      if (inserted.second) {
+        distinct.push_back(&text);
+      }
+      indices.push_back(inserted.first->second);
+    }
+
+    auto count = distinct.size();
+    std::vector<xtd::optional<EnPronunciation>> pronunciations(count);
+    if (count > 0) {
+      TaskPool pool{threads};
+      auto chunk_count = std::min(count, pool.size()*chunks_per_thread);
+      for (std::size_t c = 0; c < chunk_count; ++c) {
+        pool.spawn([&, c] {
+          for (auto i = count*c/chunk_count; i < count*(c + 1)/chunk_count; ++i) {
+            pronunciations[i] = pronounce(*distinct[i]);
+          }
+        });
+      }
+      pool.wait();
+    }
+
+    std::vector<EnPronunciation> result;
+    result.reserve(texts.size());
+    for (auto i : indices) {
+      result.push_back(*pronunciations[i]);
+    }
+    return result;
+  }
+
+  void
+  EnPronouncer::set_cache_budget(std::size_t bytes)
+  {
+    pronunciation_cache().set_budget(bytes);
+  }
+
+  std::size_t
+  EnPronouncer::cache_budget()
+  {
+    return pronunciation_cache().budget();
+  }
+
+  CacheStats
+  EnPronouncer::cache_stats()
+  {
+    return pronunciation_cache().stats();
+  }
+
+  void
+  EnPronouncer::clear_cache()
+  {
+    pronunciation_cache().clear();
+  }
+
+  std::vector<std::string>
+  EnPronouncer::check_lexicon_index()
+  {
+    auto lex = cmu_lexicon();
+    const auto& index = lexicon_index();
+    check_logic(index.size() > 0, "The lexicon index is empty.");
+
+    std::vector<std::string> mismatches;
+    std::string word;
+    std::string pos;
+    std::vector<std::string> indexed;
+    for_each_lexicon_entry(lex, [&](xtd::string_view entry_word, xtd::string_view entry_pos) {
+      word.assign(entry_word.data(), entry_word.size());
+      pos.assign(entry_pos.data(), entry_pos.size());
+
+      indexed.clear();
+      auto found = index.find(word, pos, [&](const std::string& phone) {
+        indexed.push_back(phone);
+      });
+      if (!found || indexed != phone_names(lex_lookup(lex, word.c_str(), pos.c_str(), nullptr))) {
+        mismatches.push_back(pos + " " + word);
+      }
+    });
+    return mismatches;
+  }
+
+  EnPronunciation
+  EnPronouncer::synthesize(const std::string& text) const
   {
     using UtteranceHandle = std::unique_ptr<cst_utterance, decltype(delete_utterance)*>;
 
     std::vector<std::string> phonemes;
 
-    auto utt = flite_synth_text(text.c_str(), m_impl->voice.get());
+    Impl::Lease voice{*m_impl};
+    auto utt = flite_synth_text(text.c_str(), voice.get());
     UtteranceHandle utt_handle{utt, delete_utterance};
 
     for (auto s = relation_head(utt_relation(utt, "Segment")); s; s = item_next(s)) {
@@ -89,7 +525,11 @@ namespace speech
 
       if (strcmp("+", ffeature_string(s, "ph_vc")) == 0) {
         // If the phoneme is a vowel, add stress value
-        name += ffeature_string(s, "R:SylStructure.parent.stress");
+        if (m_impl->pipeline == PronouncerPipeline::LEXICAL) {
+          name += syllable_stress(s);
+        } else {
+          name += ffeature_string(s, "R:SylStructure.parent.stress");
+        }
       }
       phonemes.push_back(std::move(name));
     }
@@ -16,8 +16,10 @@
 #define MALUUBA_SPEECH_PRONUNCIATION_HPP
 
 #include "maluuba/xtd/string_view.hpp"
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -25,6 +27,11 @@ namespace maluuba
 {
 namespace speech
 {
+  /**
+   * A small, dense identifier for a distinct @c Phone.
+   */
+  using PhoneId = std::uint16_t;
+
   /**
    * Phone type (consonant or vowel).
    */
@@ -229,6 +236,24 @@ namespace speech
      */
     void syllabic(bool syllabic);
 
+    /**
+     * @return The dense ID of this phone.  Every distinct phone is interned to
+     *         a process-wide ID the first time it is seen.
+     * @throws std::length_error  If more distinct phones are in use than
+     *         @c PhoneId can represent.
+     */
+    PhoneId id() const;
+
+    /**
+     * @return The phone interned as @p id.
+     */
+    static const Phone& from_id(PhoneId id);
+
+    /**
+     * @return The number of distinct phones interned so far.
+     */
+    static std::size_t id_count();
+
   private:
     friend class Pronunciation;
     explicit Phone(std::uint16_t repr);
@@ -243,9 +268,9 @@ namespace speech
   {
   public:
     /** An iterator over the phones in a pronunciation. */
-    using iterator = std::vector<Phone>::const_iterator;
+    class iterator;
     /** Size type. */
-    using size_type = std::vector<Phone>::size_type;
+    using size_type = std::vector<PhoneId>::size_type;
 
     virtual ~Pronunciation() = 0;
 
@@ -279,12 +304,68 @@ namespace speech
      */
     std::string to_ipa() const;
 
+    /**
+     * @return The phones of this pronunciation as a string of dense IDs (see
+     *         @c Phone::id()).
+     */
+    const std::vector<PhoneId>& phone_ids() const;
+
   protected:
     Pronunciation();
     Pronunciation(std::u16string ipa);
 
     std::u16string m_ipa;
-    std::vector<Phone> m_phones;
+    std::vector<PhoneId> m_phones;
+  };
+
+  /**
+   * Random access iterator that maps the stored phone IDs back to @c Phones.
+   */
+  class Pronunciation::iterator
+  {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Phone;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Phone*;
+    using reference = const Phone&;
+
+    iterator() = default;
+
+    explicit iterator(const PhoneId* id)
+      : m_id{id}
+    { }
+
+    reference operator*() const { return Phone::from_id(*m_id); }
+    pointer operator->() const { return &**this; }
+    reference operator[](difference_type n) const { return Phone::from_id(m_id[n]); }
+
+    /**
+     * @return A pointer to the underlying phone ID.
+     */
+    const PhoneId* base() const { return m_id; }
+
+    iterator& operator++() { ++m_id; return *this; }
+    iterator& operator--() { --m_id; return *this; }
+    iterator operator++(int) { return iterator{m_id++}; }
+    iterator operator--(int) { return iterator{m_id--}; }
+    iterator& operator+=(difference_type n) { m_id += n; return *this; }
+    iterator& operator-=(difference_type n) { m_id -= n; return *this; }
+
+    friend iterator operator+(iterator it, difference_type n) { return it += n; }
+    friend iterator operator+(difference_type n, iterator it) { return it += n; }
+    friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(iterator lhs, iterator rhs) { return lhs.m_id - rhs.m_id; }
+
+    friend bool operator==(iterator lhs, iterator rhs) { return lhs.m_id == rhs.m_id; }
+    friend bool operator!=(iterator lhs, iterator rhs) { return lhs.m_id != rhs.m_id; }
+    friend bool operator<(iterator lhs, iterator rhs) { return lhs.m_id < rhs.m_id; }
+    friend bool operator>(iterator lhs, iterator rhs) { return lhs.m_id > rhs.m_id; }
+    friend bool operator<=(iterator lhs, iterator rhs) { return lhs.m_id <= rhs.m_id; }
+    friend bool operator>=(iterator lhs, iterator rhs) { return lhs.m_id >= rhs.m_id; }
+
+  private:
+    const PhoneId* m_id = nullptr;
   };
 
   /**
@@ -247,16 +247,19 @@ namespace speech
 
   Pronunciation::Pronunciation(std::u16string ipa)
   {
+    // Diacritics modify the preceding phone, so only intern once parsing is done
+    std::vector<Phone> phones;
+
     for (auto c : ipa) {
       auto repr = ipa_letter_repr(c);
       if (repr) {
-        m_phones.push_back(Phone{*repr});
-      } else if (m_phones.empty()) {
+        phones.push_back(Phone{*repr});
+      } else if (phones.empty()) {
         std::u16string cstr;
         cstr += c;
         throw std::invalid_argument("Unexpected `" + unicode_cast<std::string>(cstr) + "`.");
       } else {
-        auto& phone = m_phones.back();
+        auto& phone = phones.back();
 
         switch (c) {
           case u'\u0329': // Syllabic (under)
@@ -342,6 +345,11 @@ namespace speech
 
       m_ipa += c;
     }
+
+    m_phones.reserve(phones.size());
+    for (const auto& phone : phones) {
+      m_phones.push_back(phone.id());
+    }
   }
 
   EnPronunciation
@@ -375,7 +383,7 @@ namespace speech
 
     EnPronunciation result;
     result.m_ipa = m_ipa.substr(offset, length);
-    result.m_phones.assign(first, last);
+    result.m_phones.assign(first.base(), last.base());
     return result;
   }
 }
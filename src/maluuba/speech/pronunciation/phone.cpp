@@ -4,7 +4,12 @@
 #include "maluuba/speech/pronunciation/impl.hpp"
 #include "maluuba/speech/pronunciation.hpp"
 #include "maluuba/debug.hpp"
+#include <atomic>
 #include <cstdint>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
 
 namespace maluuba
 {
@@ -14,6 +19,40 @@ namespace speech
 
   namespace
   {
+    /** The number of distinct phones that get a @c PhoneId (one value means none). */
+    constexpr std::size_t max_phone_ids = std::numeric_limits<PhoneId>::max();
+
+    /** The number of distinct phone representations. */
+    constexpr std::size_t phone_reprs = std::numeric_limits<std::uint16_t>::max() + 1;
+
+    /**
+     * Process-wide table of interned phones.  Lookups in either direction are
+     * lock-free: the storage never reallocates, and an ID is only handed out
+     * after its phone has been published.  Only interning a new phone locks.
+     */
+    struct PhoneRegistry
+    {
+      std::mutex mutex;
+      /** One more than the ID of each phone representation, or 0 for none yet. */
+      std::atomic<PhoneId> ids[phone_reprs] = {};
+      std::vector<Phone> storage;
+      const Phone* phones;
+      std::atomic<std::size_t> count{0};
+
+      PhoneRegistry()
+      {
+        storage.reserve(max_phone_ids);
+        phones = storage.data();
+      }
+    };
+
+    PhoneRegistry&
+    phone_registry()
+    {
+      static PhoneRegistry registry;
+      return registry;
+    }
+
     void
     check_consonant(const Phone& phone)
     {
@@ -148,5 +187,42 @@ namespace speech
   {
     m_repr = phone_encode(m_repr, syllabic, syllabic_start, syllabic_end);
   }
+
+  PhoneId
+  Phone::id() const
+  {
+    auto& registry = phone_registry();
+    auto& slot = registry.ids[m_repr];
+    auto id = slot.load(std::memory_order_acquire);
+    if (id != 0) {
+      return id - 1;
+    }
+
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    id = slot.load(std::memory_order_relaxed);
+    if (id != 0) {
+      return id - 1;
+    }
+
+    auto count = registry.storage.size();
+    check<std::length_error>(count < max_phone_ids, "Too many distinct phones.");
+
+    registry.storage.push_back(*this);
+    registry.count.store(count + 1, std::memory_order_release);
+    slot.store(static_cast<PhoneId>(count + 1), std::memory_order_release);
+    return static_cast<PhoneId>(count);
+  }
+
+  const Phone&
+  Phone::from_id(PhoneId id)
+  {
+    return phone_registry().phones[id];
+  }
+
+  std::size_t
+  Phone::id_count()
+  {
+    return phone_registry().count.load(std::memory_order_acquire);
+  }
 }
 }
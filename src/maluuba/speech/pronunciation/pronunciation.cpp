@@ -16,13 +16,13 @@ namespace speech
   Pronunciation::iterator
   Pronunciation::begin() const
   {
-    return m_phones.begin();
+    return iterator{m_phones.data()};
   }
 
   Pronunciation::iterator
   Pronunciation::end() const
   {
-    return m_phones.end();
+    return iterator{m_phones.data() + m_phones.size()};
   }
 
   bool
@@ -43,6 +43,12 @@ namespace speech
     return unicode_cast<std::string>(m_ipa);
   }
 
+  const std::vector<PhoneId>&
+  Pronunciation::phone_ids() const
+  {
+    return m_phones;
+  }
+
   EnPronunciation::~EnPronunciation() = default;
 
   EnPronunciation::EnPronunciation(const EnPronunciation& other) = default;
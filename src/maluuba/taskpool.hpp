@@ -0,0 +1,257 @@
+/**
+ * @file
+ * Work-stealing task pool.
+ *
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ */
+
+#ifndef MALUUBA_TASKPOOL_HPP
+#define MALUUBA_TASKPOOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace maluuba
+{
+  /**
+   * A pool of threads that run tasks, which may spawn more tasks.  Each
+   * thread prefers the most recently spawned task from its own queue, and
+   * steals the oldest task from another thread's queue when its own is empty.
+   *
+   * The thread that calls @c wait() takes part in running tasks, so a pool of
+   * size N starts N - 1 background threads.  Every spawned task must be waited
+   * for before the pool is destroyed.
+   */
+  class TaskPool
+  {
+  public:
+    using Task = std::function<void()>;
+
+    /**
+     * Create a @c TaskPool.
+     *
+     * @param threads  The number of threads to run tasks on, including the
+     *                 caller of @c wait().  0 means one per hardware thread.
+     */
+    explicit TaskPool(std::size_t threads = 0)
+    {
+      if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+      }
+
+      m_queues.reserve(threads);
+      for (std::size_t i = 0; i < threads; ++i) {
+        m_queues.push_back(std::make_unique<Queue>());
+      }
+
+      m_threads.reserve(threads - 1);
+      for (std::size_t i = 1; i < threads; ++i) {
+        m_threads.emplace_back([this, i] { work(i); });
+      }
+    }
+
+    ~TaskPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+      }
+      m_wakeup.notify_all();
+      for (auto& thread : m_threads) {
+        thread.join();
+      }
+    }
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /**
+     * @return The number of threads that run tasks.
+     */
+    std::size_t
+    size() const
+    {
+      return m_queues.size();
+    }
+
+    /**
+     * Add a task to the pool.  Tasks spawned from inside other tasks go to the
+     * current thread's queue.
+     */
+    void
+    spawn(Task task)
+    {
+      // Count the task first, so it can't finish before it's counted
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        ++m_pending;
+        ++m_queued;
+      }
+
+      auto index = current_index();
+      {
+        std::lock_guard<std::mutex> lock{m_queues[index]->mutex};
+        m_queues[index]->tasks.push_back(std::move(task));
+      }
+      m_wakeup.notify_one();
+    }
+
+    /**
+     * Run tasks until every spawned task (including those spawned by other
+     * tasks) has completed.
+     *
+     * @throws  The first exception thrown by a task, if any.
+     */
+    void
+    wait()
+    {
+      auto previous = s_current;
+      s_current = {this, 0};
+
+      while (true) {
+        Task task;
+        if (take(0, task)) {
+          run(task);
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        if (m_pending == 0) {
+          break;
+        }
+        m_wakeup.wait(lock, [this] { return m_pending == 0 || m_queued > 0; });
+      }
+
+      s_current = previous;
+
+      std::exception_ptr error;
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        std::swap(error, m_error);
+      }
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+  private:
+    struct Queue
+    {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    /** The pool and queue index of the current thread, if it is running tasks. */
+    struct Current
+    {
+      TaskPool* pool;
+      std::size_t index;
+    };
+
+    static inline thread_local Current s_current = {nullptr, 0};
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    /** Guards the counters below, and signals changes to them. */
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    /** Tasks spawned but not yet finished. */
+    std::size_t m_pending = 0;
+    /** Tasks waiting in a queue. */
+    std::size_t m_queued = 0;
+    bool m_stop = false;
+    std::exception_ptr m_error;
+
+    std::size_t
+    current_index() const
+    {
+      return s_current.pool == this ? s_current.index : 0;
+    }
+
+    /** Take a task from our own queue, or steal one from another. */
+    bool
+    take(std::size_t index, Task& task)
+    {
+      auto count = m_queues.size();
+      for (std::size_t i = 0; i < count; ++i) {
+        auto& queue = *m_queues[(index + i)%count];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        if (queue.tasks.empty()) {
+          continue;
+        }
+
+        if (i == 0) {
+          task = std::move(queue.tasks.back());
+          queue.tasks.pop_back();
+        } else {
+          task = std::move(queue.tasks.front());
+          queue.tasks.pop_front();
+        }
+
+        std::lock_guard<std::mutex> counter_lock{m_mutex};
+        --m_queued;
+        return true;
+      }
+
+      return false;
+    }
+
+    void
+    run(Task& task)
+    {
+      std::exception_ptr error;
+      try {
+        task();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      task = nullptr;
+
+      bool done;
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (error && !m_error) {
+          m_error = error;
+        }
+        done = --m_pending == 0;
+      }
+      if (done) {
+        m_wakeup.notify_all();
+      }
+    }
+
+    /** The main loop of a background thread. */
+    void
+    work(std::size_t index)
+    {
+      s_current = {this, index};
+
+      while (true) {
+        Task task;
+        if (take(index, task)) {
+          run(task);
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_wakeup.wait(lock, [this] { return m_stop || m_queued > 0; });
+        if (m_stop) {
+          break;
+        }
+      }
+    }
+  };
+}
+
+#endif // MALUUBA_TASKPOOL_HPP
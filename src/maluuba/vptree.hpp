@@ -11,17 +11,189 @@
 #ifndef MALUUBA_VPTREE_HPP
 #define MALUUBA_VPTREE_HPP
 
+#include "maluuba/debug.hpp"
 #include "maluuba/metric.hpp"
+#include "maluuba/searchstats.hpp"
+#include "maluuba/snapshot.hpp"
+#include "maluuba/taskpool.hpp"
 #include "maluuba/xtd/optional.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <initializer_list>
-#include <queue>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <xmmintrin.h>
+#endif
 
 namespace maluuba
 {
+  /**
+   * Options for building a @c VpTree.
+   */
+  struct VpTreeOptions
+  {
+    /**
+     * The number of threads to build the tree with, or 0 for one per hardware
+     * thread.  With more than one, the metric must be safe to call
+     * concurrently.  The tree is the same for any number of threads.
+     */
+    std::size_t threads = 1;
+
+    /**
+     * The number of randomly sampled candidates to consider for each vantage
+     * point.  The default of 1 always uses the first element of each range.
+     * More candidates cost more distance computations while building, but
+     * give a more balanced tree that is faster to search.
+     */
+    std::size_t vantage_point_candidates = 1;
+
+    /**
+     * The number of elements to measure each vantage point candidate against.
+     * Ranges smaller than <code>vantage_point_candidates *
+     * vantage_point_samples</code> use their first element.
+     */
+    std::size_t vantage_point_samples = 16;
+
+    /** The seed for vantage point sampling. */
+    std::uint64_t seed = 0;
+
+    /**
+     * The most elements a subtree can hold and still be a leaf bucket, whose
+     * elements are scanned one after another rather than split around
+     * another vantage point.  Larger buckets take fewer, more predictable
+     * steps per search for slightly more distance computations.
+     */
+    std::size_t leaf_size = 8;
+  };
+
+  /**
+   * The order in which a @c VpTree search visits subtrees.
+   */
+  enum class VpTreeTraversal
+  {
+    /** Descend into the more promising half first, backtracking from a stack. */
+    DEPTH_FIRST,
+    /**
+     * Expand whichever pending subtree has the smallest lower bound on its
+     * distance to the target, stopping as soon as that bound exceeds the
+     * current k-th match.  This usually shrinks the search radius sooner, at
+     * the cost of keeping a heap.
+     */
+    BEST_FIRST,
+  };
+
+  /**
+   * Options for a single @c VpTree search.  The limits below trade accuracy
+   * for time: a search that hits one returns the best matches found so far,
+   * and reports whether they are still guaranteed to be exact.
+   */
+  struct VpTreeSearchOptions
+  {
+    VpTreeTraversal traversal = VpTreeTraversal::DEPTH_FIRST;
+
+    /** The most distances to compute, or 0 for no limit. */
+    std::size_t max_evaluations = 0;
+
+    /** When to stop searching. */
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+    /**
+     * Prune subtrees that can't hold a match closer than the search radius
+     * divided by (1 + epsilon).  The k-th match found is then at most (1 +
+     * epsilon) times as far as the exact k-th match, but matches beyond
+     * limit / (1 + epsilon) may be missed.
+     */
+    double epsilon = 0.0;
+  };
+
+  /**
+   * Tracks how much of the evaluation and time limits of a search are left.
+   */
+  class VpTreeSearchBudget
+  {
+  public:
+    explicit VpTreeSearchBudget(const VpTreeSearchOptions& options)
+      : m_remaining{options.max_evaluations == 0 ? std::numeric_limits<std::size_t>::max() : options.max_evaluations},
+        m_deadline{options.deadline},
+        m_timed{options.deadline != std::chrono::steady_clock::time_point::max()}
+    { }
+
+    /**
+     * @return Whether the search must stop.
+     */
+    bool
+    exhausted() const
+    {
+      return m_remaining == 0 || (m_timed && std::chrono::steady_clock::now() >= m_deadline);
+    }
+
+    /**
+     * Spend up to @p wanted evaluations.
+     *
+     * @return The number of evaluations that may be computed.
+     */
+    std::size_t
+    take(std::size_t wanted)
+    {
+      auto taken = std::min(wanted, m_remaining);
+      m_remaining -= taken;
+      return taken;
+    }
+
+  private:
+    std::size_t m_remaining;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_timed;
+  };
+
+  /**
+   * The shape of a @c VpTree, to judge how well its vantage points split it.
+   */
+  struct VpTreeShape
+  {
+    /** The number of static trees in the forest. */
+    std::size_t trees = 0;
+    /** The number of elements, including erased ones that still guide searches. */
+    std::size_t nodes = 0;
+    /** The number of leaf buckets. */
+    std::size_t leaves = 0;
+    /** The depth of the deepest leaf bucket, counting each tree's root as depth 0. */
+    std::size_t max_depth = 0;
+    /** The mean depth of the elements. */
+    double mean_depth = 0.0;
+    /**
+     * The fraction of splits whose halves share a boundary distance, so that
+     * a target at that distance from the vantage point can prune neither.
+     * Each split halves its subtree by count, so this is how its balance
+     * shows: integer metrics with many ties at the median raise it.
+     */
+    double tied_splits = 0.0;
+    /** The smallest distance from a vantage point to the outside half of its subtree. */
+    double min_radius = 0.0;
+    /** The median distance from a vantage point to the outside half of its subtree. */
+    double median_radius = 0.0;
+    /** The largest distance from a vantage point to the outside half of its subtree. */
+    double max_radius = 0.0;
+  };
+
   /**
    * A vantage point tree.
    *
+   * Elements can be inserted and erased after construction.  The tree is kept
+   * as a forest of static trees whose sizes at least halve from one to the
+   * next; an insertion adds a tree of size one and merges the smallest trees
+   * until that holds again, so each element is rebuilt O(log n) times.  Erased
+   * elements stay in place to guide searches until half of their tree is
+   * erased, at which point it is rebuilt.
+   *
    * @tparam T  The type of element to store.
    * @tparam Metric  The metric used to compare elements.
    * @author Tavian Barnes (tavian.barnes@microsoft.com)
@@ -34,23 +206,84 @@ namespace maluuba
     using distance_type = MetricResult<Metric, T>;
 
   private:
+    using ElementVector = std::vector<T>;
+    using ElementIterator = typename ElementVector::const_iterator;
+
+    /**
+     * The range of distances from a vantage point to the elements of one half
+     * of its subtree.
+     */
+    struct Shell
+    {
+      distance_type lo, hi;
+
+      /**
+       * @return A lower bound for the distance to any element of the shell
+       *         from a target at @p distance from the vantage point.
+       */
+      distance_type
+      bound(distance_type distance) const
+      {
+        // Careful not to go negative, in case distance_type is unsigned
+        if (distance < lo) {
+          return lo - distance;
+        } else if (distance > hi) {
+          return distance - hi;
+        } else {
+          return distance_type{};
+        }
+      }
+    };
+
+    /**
+     * The metadata for the subtree rooted at one element.  The subtree over
+     * [i, j) has its vantage point at i, its inside half at [i + 1, i + 1 +
+     * left_size) and its outside half after that, so no child pointers are
+     * needed.  Subtrees of at most @c VpTreeOptions::leaf_size elements are
+     * leaf buckets, and their metadata is unused apart from @c erased.
+     */
     struct Node
     {
-      T element;
-      distance_type radius;
+      /** The distances to the inside half, which are at most outside.lo. */
+      Shell inside;
+      /** The distances to the outside half. */
+      Shell outside;
       std::size_t left_size;
-
-      Node(T element)
-        : element(std::move(element)), radius{}, left_size{}
-      { }
+      /** Whether this element has been erased.  It still guides searches. */
+      bool erased;
     };
 
     using NodeVector = std::vector<Node>;
-    using NodeIterator = typename NodeVector::const_iterator;
+
+    /**
+     * One of the static trees in the forest.  The metadata is kept apart from
+     * the elements, so the search can walk the tree without striding over
+     * large elements.
+     */
+    struct SubTree
+    {
+      NodeVector nodes;
+      /** The elements, parallel to @c nodes. */
+      ElementVector elements;
+      /** The number of erased nodes. */
+      std::size_t erased;
+
+      std::size_t
+      size() const
+      {
+        return nodes.size();
+      }
+
+      std::size_t
+      live() const
+      {
+        return nodes.size() - erased;
+      }
+    };
 
   public:
-    using size_type = typename NodeVector::size_type;
-    using difference_type = typename NodeVector::difference_type;
+    using size_type = typename ElementVector::size_type;
+    using difference_type = typename ElementVector::difference_type;
 
     using reference = value_type&;
     using const_reference = const value_type&;
@@ -65,30 +298,198 @@ namespace maluuba
     { }
 
     explicit VpTree(std::initializer_list<T> ilist, Metric metric = Metric{})
-      : m_nodes{ilist.begin(), ilist.end()},
-        m_metric{std::move(metric)}
+      : m_metric{std::move(metric)}
     {
-      build_tree();
+      add_tree(ElementVector{ilist.begin(), ilist.end()});
     }
 
     template <typename Iterator>
     explicit VpTree(Iterator first, Iterator last, Metric metric = Metric{})
-      : m_nodes{first, last},
-        m_metric{std::move(metric)}
+      : m_metric{std::move(metric)}
+    {
+      add_tree(ElementVector{first, last});
+    }
+
+    /**
+     * @param options  The options for the initial build, and for rebuilding
+     *                 after later insertions and erasures.
+     */
+    template <typename Iterator>
+    explicit VpTree(Iterator first, Iterator last, Metric metric, const VpTreeOptions& options)
+      : m_metric{std::move(metric)},
+        m_options{options}
     {
-      build_tree();
+      add_tree(ElementVector{first, last});
     }
 
     bool
     empty() const
     {
-      return m_nodes.empty();
+      return m_size == 0;
     }
 
+    /**
+     * @return The number of elements in the tree, not counting erased ones.
+     */
     size_type
     size() const
     {
-      return m_nodes.size();
+      return m_size;
+    }
+
+    /**
+     * Insert an element into the tree.  Matches found before the insertion
+     * are invalidated.
+     */
+    void
+    insert(T element)
+    {
+      ElementVector elements;
+      elements.push_back(std::move(element));
+      add_tree(std::move(elements));
+      normalize();
+    }
+
+    /**
+     * Erase the elements at distance zero from @p key for which @p pred
+     * returns @c true.  Matches found before the erasure are invalidated.
+     *
+     * @param key  The key to look up.
+     * @param pred  A predicate that picks which of the elements equivalent to
+     *              @p key to erase.
+     * @return The number of elements erased.
+     */
+    template <typename U, typename Predicate>
+    size_type
+    erase(const U& key, Predicate pred)
+    {
+      // Lookups for erasure aren't counted as searches
+      SearchStatsCounter uncounted;
+      SearchRecorder recorder{uncounted};
+      SearchContext context;
+
+      size_type count = 0;
+      for (auto& tree : m_trees) {
+        std::vector<std::size_t> found;
+        visit_within(tree, key, 0, [&](std::size_t i, distance_type) {
+          if (pred(tree.elements[i])) {
+            found.push_back(i);
+          }
+        }, context, recorder);
+
+        for (auto i : found) {
+          tree.nodes[i].erased = true;
+        }
+        tree.erased += found.size();
+        count += found.size();
+
+        if (tree.erased > 0 && tree.erased >= tree.live()) {
+          tree = build_tree(live_elements(std::move(tree)));
+        }
+      }
+
+      if (count > 0) {
+        m_size -= count;
+        normalize();
+      }
+      return count;
+    }
+
+    /**
+     * Erase the elements equal to @p element, which must be at distance zero
+     * from it.
+     *
+     * @return The number of elements erased.
+     */
+    size_type
+    erase(const T& element)
+    {
+      return erase(element, [&element](const T& other) { return other == element; });
+    }
+
+    /**
+     * Save the tree's structure to a snapshot, so it can be loaded without
+     * computing any distances.
+     *
+     * @param writer  The snapshot to write to.
+     * @param write_element  Called as <code>write_element(writer, element)</code>
+     *                       for each element, including erased ones.
+     */
+    template <typename ElementWriter>
+    void
+    save(SnapshotWriter& writer, ElementWriter&& write_element) const
+    {
+      writer.write_u64(m_options.vantage_point_candidates);
+      writer.write_u64(m_options.vantage_point_samples);
+      writer.write_u64(m_options.seed);
+      writer.write_u64(m_options.leaf_size);
+
+      writer.write_u64(m_trees.size());
+      for (const auto& tree : m_trees) {
+        writer.write_u64(tree.size());
+        for (std::size_t i = 0; i < tree.size(); ++i) {
+          const auto& node = tree.nodes[i];
+          writer.write_f64(node.inside.lo);
+          writer.write_f64(node.inside.hi);
+          writer.write_f64(node.outside.lo);
+          writer.write_f64(node.outside.hi);
+          writer.write_u64(node.left_size);
+          writer.write_u8(node.erased);
+          write_element(writer, tree.elements[i]);
+        }
+      }
+    }
+
+    /**
+     * Load a tree saved by @c save().  The nodes and elements are decoded into
+     * the tree's own arrays, which don't refer to @p reader's memory.
+     *
+     * @param reader  The snapshot to read from.
+     * @param read_element  Called as <code>read_element(reader)</code> to read
+     *                      each element written by @c save().
+     * @param metric  The metric, which must match the saved tree's.
+     * @param threads  The number of threads for rebuilds after later
+     *                 insertions and erasures.
+     * @throws std::runtime_error  If the snapshot is malformed.
+     */
+    template <typename ElementReader>
+    static VpTree
+    load(SnapshotReader& reader, ElementReader&& read_element, Metric metric = Metric{}, std::size_t threads = 1)
+    {
+      VpTree tree{std::move(metric)};
+      tree.m_options.threads = threads;
+      tree.m_options.vantage_point_candidates = reader.read_u64();
+      tree.m_options.vantage_point_samples = reader.read_u64();
+      tree.m_options.seed = reader.read_u64();
+      tree.m_options.leaf_size = reader.read_u64();
+
+      // Each node takes at least 41 bytes
+      constexpr std::size_t node_size = 41;
+      auto tree_count = reader.read_count(8);
+      for (std::size_t i = 0; i < tree_count; ++i) {
+        SubTree subtree{{}, {}, 0};
+        auto node_count = reader.read_count(node_size);
+        subtree.nodes.reserve(node_count);
+        subtree.elements.reserve(node_count);
+        for (std::size_t j = 0; j < node_count; ++j) {
+          Node node;
+          node.inside.lo = static_cast<distance_type>(reader.read_f64());
+          node.inside.hi = static_cast<distance_type>(reader.read_f64());
+          node.outside.lo = static_cast<distance_type>(reader.read_f64());
+          node.outside.hi = static_cast<distance_type>(reader.read_f64());
+          node.left_size = reader.read_u64();
+          node.erased = reader.read_u8() != 0;
+          subtree.nodes.push_back(node);
+          subtree.elements.push_back(read_element(reader));
+          subtree.erased += node.erased;
+        }
+
+        check(tree.well_formed(subtree), "Malformed snapshot.");
+        tree.m_size += subtree.live();
+        tree.m_trees.push_back(std::move(subtree));
+      }
+
+      return tree;
     }
 
     /**
@@ -99,8 +500,8 @@ namespace maluuba
     public:
       Match() = default;
 
-      Match(NodeIterator node, distance_type distance)
-        : m_node{node}, m_distance{distance}
+      Match(const T& element, distance_type distance)
+        : m_element{&element}, m_distance{distance}
       { }
 
       /**
@@ -109,7 +510,7 @@ namespace maluuba
       const T&
       element() const
       {
-        return m_node->element;
+        return *m_element;
       }
 
       /**
@@ -128,7 +529,7 @@ namespace maluuba
         return lhs.distance() < rhs.distance();
       }
 
-      NodeIterator m_node;
+      const T* m_element;
       distance_type m_distance;
     };
 
@@ -138,31 +539,54 @@ namespace maluuba
      */
     struct StackEntry
     {
-      /** The range to search. */
-      NodeIterator first, last;
-      /** Search is necessary iff a <= b + tau. */
-      distance_type a, b;
+      /** The tree to search. */
+      const SubTree* tree;
+      /** The range of the tree to search. */
+      std::size_t first, last;
+      /** A lower bound for the distance to any element in the range. */
+      distance_type bound;
 
-      StackEntry(NodeIterator first, NodeIterator last, distance_type a, distance_type b)
-        : first{first}, last{last}, a{a}, b{b}
+      StackEntry(const SubTree* tree, std::size_t first, std::size_t last, distance_type bound)
+        : tree{tree}, first{first}, last{last}, bound{bound}
       { }
     };
 
     using SearchStack = std::vector<StackEntry>;
 
   public:
+    /**
+     * Scratch space for searches.  Passing the same context to one search
+     * after another reuses its buffers, so once they have grown to fit, a
+     * search allocates nothing.  A context can serve any tree of this type,
+     * but only one search at a time: keep one per thread.
+     */
+    class SearchContext
+    {
+    private:
+      friend class VpTree;
+
+      SearchStack m_stack;
+      /** A max-heap of the matches found so far, sorted once the search ends. */
+      std::vector<Match> m_matches;
+      /** Distances from a batch metric. */
+      std::vector<distance_type> m_distances;
+    };
+
     /**
      * Find the nearest element in the tree.
      *
      * @param target  The search target.
+     * @param options  How to search.
+     * @param[out] exact  If not null, set to whether the match is guaranteed
+     *                    to be the closest despite the limits in @p options.
      * @return The closest match to @p target, or @c nullopt if the tree is
      *         empty.
      */
     template <typename U>
     xtd::optional<Match>
-    find_nearest(const U& target) const
+    find_nearest(const U& target, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
     {
-      auto matches = find_k_nearest(target, 1);
+      auto matches = find_k_nearest(target, 1, options, exact);
       if (matches.empty()) {
         return xtd::nullopt;
       } else {
@@ -175,14 +599,17 @@ namespace maluuba
      *
      * @param target  The search target.
      * @param limit  The maximum distance to a match.
+     * @param options  How to search.
+     * @param[out] exact  If not null, set to whether the match is guaranteed
+     *                    to be the closest despite the limits in @p options.
      * @return The closest match to @p target within @p limit, or @c nullopt if
      *         no match is found.
      */
     template <typename U>
     xtd::optional<Match>
-    find_nearest_within(const U& target, distance_type limit) const
+    find_nearest_within(const U& target, distance_type limit, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
     {
-      auto matches = find_k_nearest_within(target, 1, limit);
+      auto matches = find_k_nearest_within(target, 1, limit, options, exact);
       if (matches.empty()) {
         return xtd::nullopt;
       } else {
@@ -195,165 +622,869 @@ namespace maluuba
      *
      * @param target  The search target.
      * @param k  The maximum number of result to return.
+     * @param options  How to search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
      * @return The @p k nearest elements in the tree to @p target.
      */
     template <typename U>
     std::vector<Match>
-    find_k_nearest(const U& target, size_type k) const
+    find_k_nearest(const U& target, size_type k, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      SearchContext context;
+      search(target, k, distance_type{}, false, options, exact, context);
+      return std::move(context.m_matches);
+    }
+
+    /**
+     * Find the @p k nearest elements in the tree, passing them to @p sink
+     * rather than collecting them.
+     *
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @param context  The scratch space for the search.
+     * @param sink  Called as <code>sink(element, distance)</code> for each
+     *              match, nearest first.
+     * @param options  How to search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The number of matches.
+     */
+    template <typename U, typename Sink>
+    size_type
+    find_k_nearest(const U& target, size_type k, SearchContext& context, Sink&& sink, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      search(target, k, distance_type{}, false, options, exact, context);
+      return emit(context, sink);
+    }
+
+    /**
+     * Find the @p k nearest elements in the tree.
+     *
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param options  How to search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The @p k nearest elements in the tree to @p target within @p limit.
+     */
+    template <typename U>
+    std::vector<Match>
+    find_k_nearest_within(const U& target, size_type k, distance_type limit, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
     {
-      std::priority_queue<Match> matches;
-      distance_type tau{};
+      SearchContext context;
+      search(target, k, limit, true, options, exact, context);
+      return std::move(context.m_matches);
+    }
 
-      SearchStack stack;
-      stack.emplace_back(m_nodes.begin(), m_nodes.end(), 0, 0);
+    /**
+     * Find the @p k nearest elements in the tree, passing them to @p sink
+     * rather than collecting them.
+     *
+     * @param target  The search target.
+     * @param k  The maximum number of result to return.
+     * @param limit  The maximum distance to a match.
+     * @param context  The scratch space for the search.
+     * @param sink  Called as <code>sink(element, distance)</code> for each
+     *              match, nearest first.
+     * @param options  How to search.
+     * @param[out] exact  If not null, set to whether the matches are
+     *                    guaranteed to be the nearest despite the limits in
+     *                    @p options.
+     * @return The number of matches.
+     */
+    template <typename U, typename Sink>
+    size_type
+    find_k_nearest_within(const U& target, size_type k, distance_type limit, SearchContext& context, Sink&& sink, const VpTreeSearchOptions& options = {}, bool* exact = nullptr) const
+    {
+      search(target, k, limit, true, options, exact, context);
+      return emit(context, sink);
+    }
 
-      while (!stack.empty()) {
-        auto entry = stack.back();
-        stack.pop_back();
+    /**
+     * Find every element within a distance of a target.  Unlike the k
+     * nearest searches, the search radius stays fixed at @p limit.
+     *
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @return The elements within @p limit of @p target, nearest first.
+     */
+    template <typename U>
+    std::vector<Match>
+    find_all_within(const U& target, distance_type limit) const
+    {
+      std::vector<Match> matches;
+      visit_within(target, limit, [&](const T& element, distance_type distance) {
+        matches.emplace_back(element, distance);
+      });
+      std::stable_sort(matches.begin(), matches.end());
+      return matches;
+    }
 
-        if (entry.first == entry.last || (matches.size() == k && entry.a > entry.b + tau)) {
-          continue;
+    /**
+     * Call <code>visitor(element, distance)</code> for every element within
+     * a distance of a target, in no particular order, without collecting
+     * them.  The tree must not be modified until the visit returns.
+     *
+     * @param target  The search target.
+     * @param limit  The maximum distance to a match.
+     * @param visitor  Called for each match.
+     */
+    template <typename U, typename Visitor>
+    void
+    visit_within(const U& target, distance_type limit, Visitor&& visitor) const
+    {
+      SearchContext context;
+      visit_within(target, limit, context, std::forward<Visitor>(visitor));
+    }
+
+    /**
+     * Like <code>visit_within(target, limit, visitor)</code>, with the
+     * scratch space in @p context.
+     */
+    template <typename U, typename Visitor>
+    void
+    visit_within(const U& target, distance_type limit, SearchContext& context, Visitor&& visitor) const
+    {
+      SearchRecorder recorder{m_stats};
+      for (const auto& tree : m_trees) {
+        visit_within(tree, target, limit, [&](std::size_t i, distance_type distance) {
+          visitor(tree.elements[i], distance);
+        }, context, recorder);
+      }
+    }
+
+    /**
+     * @return The counts of every search since construction or the last
+     *         @c reset_search_stats(), all zero unless built with
+     *         @c MALUUBA_SEARCH_STATS.
+     */
+    SearchStats
+    search_stats() const
+    {
+      return m_stats.stats();
+    }
+
+    /**
+     * Zero the counts returned by @c search_stats().
+     */
+    void
+    reset_search_stats()
+    {
+      m_stats.reset();
+    }
+
+    /**
+     * Measure the shape of the tree.  This walks every tree in the forest, so
+     * it costs O(n) but no distance computations.
+     */
+    VpTreeShape
+    shape() const
+    {
+      struct Range
+      {
+        std::size_t first, last, depth;
+      };
+
+      VpTreeShape shape;
+      std::vector<distance_type> radii;
+      double depths = 0.0;
+      std::size_t ties = 0;
+
+      for (const auto& tree : m_trees) {
+        ++shape.trees;
+        shape.nodes += tree.size();
+
+        std::vector<Range> stack;
+        stack.push_back({0, tree.size(), 0});
+        while (!stack.empty()) {
+          auto range = stack.back();
+          stack.pop_back();
+
+          auto size = range.last - range.first;
+          if (size == 0) {
+            continue;
+          } else if (size <= leaf_size()) {
+            ++shape.leaves;
+            shape.max_depth = std::max(shape.max_depth, range.depth);
+            depths += static_cast<double>(size*range.depth);
+            continue;
+          }
+
+          const auto& node = tree.nodes[range.first];
+          auto left = range.first + 1;
+          auto mid = left + node.left_size;
+          if (node.left_size > 0 && !(node.inside.hi < node.outside.lo)) {
+            ++ties;
+          }
+          radii.push_back(node.outside.lo);
+          depths += range.depth;
+
+          stack.push_back({left, mid, range.depth + 1});
+          stack.push_back({mid, range.last, range.depth + 1});
         }
+      }
+
+      if (shape.nodes > 0) {
+        shape.mean_depth = depths/shape.nodes;
+      }
+      if (!radii.empty()) {
+        shape.tied_splits = static_cast<double>(ties)/radii.size();
+        auto median = radii.begin() + radii.size()/2;
+        std::nth_element(radii.begin(), median, radii.end());
+        shape.median_radius = static_cast<double>(*median);
+        shape.min_radius = static_cast<double>(*std::min_element(radii.begin(), radii.end()));
+        shape.max_radius = static_cast<double>(*std::max_element(radii.begin(), radii.end()));
+      }
+      return shape;
+    }
+
+  private:
+    /** Ranges smaller than this are built by a single task. */
+    static constexpr std::size_t parallel_build_grain = 1024;
+    /** Ranges at least this large compute their distances to the vantage point in parallel. */
+    static constexpr std::size_t parallel_partition_size = 16384;
+    /** The number of distances each task computes for a parallel partition. */
+    static constexpr std::size_t parallel_partition_chunk = 4096;
+
+    /** The static trees, largest first. */
+    std::vector<SubTree> m_trees;
+    size_type m_size = 0;
+    Metric m_metric;
+    VpTreeOptions m_options;
+    mutable SearchStatsCounter m_stats;
+
+    /** @return The size of the largest leaf bucket. */
+    std::size_t
+    leaf_size() const
+    {
+      return std::max<std::size_t>(m_options.leaf_size, 1);
+    }
+
+    /** Reset @p stack to hold every tree, with the largest on top. */
+    void
+    initial_stack(SearchStack& stack) const
+    {
+      stack.clear();
+      for (auto tree = m_trees.rbegin(); tree != m_trees.rend(); ++tree) {
+        stack.emplace_back(&*tree, 0, tree->size(), distance_type{});
+      }
+    }
+
+    /**
+     * Pass the matches of the last search with @p context to @p sink.
+     *
+     * @return The number of matches.
+     */
+    template <typename Sink>
+    static size_type
+    emit(const SearchContext& context, Sink& sink)
+    {
+      for (const auto& match : context.m_matches) {
+        sink(match.element(), match.distance());
+      }
+      return context.m_matches.size();
+    }
+
+    /** Hint that the search will visit @p entry soon. */
+    static void
+    prefetch(const StackEntry& entry)
+    {
+      const void* node = entry.tree->nodes.data() + entry.first;
+      const void* element = entry.tree->elements.data() + entry.first;
+#if defined(__GNUC__)
+      __builtin_prefetch(node);
+      __builtin_prefetch(element);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+      _mm_prefetch(static_cast<const char*>(node), _MM_HINT_T0);
+      _mm_prefetch(static_cast<const char*>(element), _MM_HINT_T0);
+#else
+      static_cast<void>(node);
+      static_cast<void>(element);
+#endif
+    }
+
+    /** Orders a heap of stack entries with the smallest bound on top. */
+    static bool
+    farther(const StackEntry& lhs, const StackEntry& rhs)
+    {
+      return lhs.bound > rhs.bound;
+    }
+
+    /** Take the next entry to visit from @p stack. */
+    static StackEntry
+    pop_entry(SearchStack& stack, VpTreeTraversal traversal)
+    {
+      if (traversal == VpTreeTraversal::BEST_FIRST) {
+        std::pop_heap(stack.begin(), stack.end(), farther);
+      }
+      auto entry = stack.back();
+      stack.pop_back();
+      return entry;
+    }
+
+    /** Return an entry to @p stack. */
+    static void
+    push_entry(SearchStack& stack, const StackEntry& entry, VpTreeTraversal traversal)
+    {
+      stack.push_back(entry);
+      if (traversal == VpTreeTraversal::BEST_FIRST) {
+        std::push_heap(stack.begin(), stack.end(), farther);
+      }
+    }
+
+    /**
+     * Push the halves of the subtree rooted at @p root, bounded by their
+     * shells.  The half that may hold closer elements goes on top, and the
+     * next entry to visit is prefetched.
+     */
+    static void
+    push_children(SearchStack& stack, const StackEntry& entry, distance_type distance, VpTreeTraversal traversal = VpTreeTraversal::DEPTH_FIRST)
+    {
+      const auto& node = entry.tree->nodes[entry.first];
+      auto left = entry.first + 1;
+      auto mid = left + node.left_size;
+      auto inside_bound = node.inside.bound(distance);
+      auto outside_bound = node.outside.bound(distance);
+
+      if (inside_bound < outside_bound) {
+        stack.emplace_back(entry.tree, mid, entry.last, outside_bound);
+        stack.emplace_back(entry.tree, left, mid, inside_bound);
+      } else {
+        stack.emplace_back(entry.tree, left, mid, inside_bound);
+        stack.emplace_back(entry.tree, mid, entry.last, outside_bound);
+      }
 
-        auto root = entry.first;
-        auto distance = m_metric(root->element, target);
-        if (matches.size() < k || distance <= tau) {
+      if (traversal == VpTreeTraversal::BEST_FIRST) {
+        std::push_heap(stack.begin(), stack.end() - 1, farther);
+        std::push_heap(stack.begin(), stack.end(), farther);
+        prefetch(stack.front());
+      } else {
+        prefetch(stack.back());
+      }
+    }
+
+    /**
+     * Find the @p k nearest elements.  If @p limited, only elements within
+     * @p tau match.  Otherwise the first @p k elements visited match whatever
+     * their distance, and pruning starts once there are @p k of them.  The
+     * matches are left in <code>context.m_matches</code>, nearest first.
+     */
+    template <typename U>
+    void
+    search(const U& target, size_type k, distance_type tau, bool limited, const VpTreeSearchOptions& options, bool* exact, SearchContext& context) const
+    {
+      SearchRecorder recorder{m_stats};
+      auto& matches = context.m_matches;
+      matches.clear();
+      auto pruning = [&] { return limited || matches.size() == k; };
+      auto add_match = [&](const T& element, distance_type distance) {
+        if (!pruning() || distance <= tau) {
           if (matches.size() == k) {
-            matches.pop();
+            std::pop_heap(matches.begin(), matches.end());
+            matches.pop_back();
+          }
+          matches.emplace_back(element, distance);
+          std::push_heap(matches.begin(), matches.end());
+          if (matches.size() == k) {
+            tau = matches.front().distance();
           }
-          matches.push(Match(root, distance));
-          tau = matches.top().distance();
         }
+      };
+
+      auto traversal = options.traversal;
+      auto relaxation = 1.0 + options.epsilon;
+      VpTreeSearchBudget budget{options};
+      bool approximated = false;
+
+      auto& distances = context.m_distances;
+      auto& stack = context.m_stack;
+      initial_stack(stack);
+      if (traversal == VpTreeTraversal::BEST_FIRST) {
+        std::make_heap(stack.begin(), stack.end(), farther);
+      }
+
+      while (!stack.empty() && !budget.exhausted()) {
+        auto entry = pop_entry(stack, traversal);
 
-        auto left = root + 1;
-        auto right = entry.last;
-        if (left == right) {
+        if (pruning() && entry.bound*relaxation > tau) {
+          recorder.prune();
+          approximated |= !(entry.bound > tau);
+          if (traversal == VpTreeTraversal::BEST_FIRST) {
+            // Every other pending subtree is at least as far away
+            break;
+          }
+          continue;
+        }
+        if (entry.first == entry.last) {
           continue;
         }
 
-        auto mid = left + root->left_size;
+        const auto& nodes = entry.tree->nodes;
+        const auto& elements = entry.tree->elements;
+        recorder.visit();
 
-        auto radius = root->radius;
+        if (entry.last - entry.first <= leaf_size()) {
+          // Leave whatever the budget doesn't cover for later
+          auto last = entry.first + budget.take(entry.last - entry.first);
+          if (last < entry.last) {
+            push_entry(stack, StackEntry(entry.tree, last, entry.last, entry.bound), traversal);
+            entry.last = last;
+          }
 
-        if (distance < radius) {
-          stack.emplace_back(mid, right, radius, distance);
-          stack.emplace_back(left, mid, distance, radius);
-        } else {
-          stack.emplace_back(left, mid, distance, radius);
-          stack.emplace_back(mid, right, radius, distance);
+          // Scan the bucket, all at once if the metric supports it
+          if constexpr (IsBatchMetric<Metric, U, ElementIterator, distance_type*, distance_type>::value) {
+            if (pruning()) {
+              distances.resize(entry.last - entry.first);
+              recorder.metric(distances.size(), [&] {
+                distance_many(m_metric, target, elements.begin() + entry.first, elements.begin() + entry.last, distances.data(), tau);
+              });
+              for (auto i = entry.first; i < entry.last; ++i) {
+                if (!nodes[i].erased) {
+                  add_match(elements[i], distances[i - entry.first]);
+                }
+              }
+              continue;
+            }
+          }
+
+          for (auto i = entry.first; i < entry.last; ++i) {
+            if (!nodes[i].erased) {
+              auto distance = recorder.metric(1, [&] {
+                return pruning() ? bounded_distance(m_metric, elements[i], target, tau) : m_metric(elements[i], target);
+              });
+              add_match(elements[i], distance);
+            }
+          }
+          continue;
         }
+
+        budget.take(1);
+        const auto& root = nodes[entry.first];
+        const auto& element = elements[entry.first];
+        auto distance = recorder.metric(1, [&] {
+          return pruning() ? bounded_distance(m_metric, element, target, search_limit(root, tau)) : m_metric(element, target);
+        });
+        if (!root.erased) {
+          add_match(element, distance);
+        }
+
+        push_children(stack, entry, distance, traversal);
+        recorder.stack(stack.size());
       }
 
-      auto i = matches.size();
-      std::vector<Match> result{i};
-      while (!matches.empty()) {
-        result[--i] = matches.top();
-        matches.pop();
+      if (exact) {
+        // Exact unless something that could still hold a match was skipped
+        *exact = !approximated && std::all_of(stack.begin(), stack.end(), [&](const StackEntry& entry) {
+          return entry.first == entry.last || (pruning() && entry.bound > tau);
+        });
       }
-      return result;
+
+      std::sort_heap(matches.begin(), matches.end());
     }
 
     /**
-     * Find the @p k nearest elements in the tree.
-     *
-     * @param target  The search target.
-     * @param k  The maximum number of result to return.
-     * @param limit  The maximum distance to a match.
-     * @return The @p k nearest elements in the tree to @p target within @p limit.
+     * Call @p visitor with the index of every element of @p tree that isn't
+     * erased and is within @p limit of @p target, along with its distance.
      */
-    template <typename U>
-    std::vector<Match>
-    find_k_nearest_within(const U& target, size_type k, distance_type limit) const
+    template <typename U, typename Visitor>
+    void
+    visit_within(const SubTree& tree, const U& target, distance_type limit, Visitor&& visitor, SearchContext& context, SearchRecorder& recorder) const
     {
-      std::priority_queue<Match> matches;
-      distance_type tau = limit;
-
-      SearchStack stack;
-      stack.emplace_back(m_nodes.begin(), m_nodes.end(), 0, 0);
+      auto& distances = context.m_distances;
+      auto& stack = context.m_stack;
+      stack.clear();
+      stack.emplace_back(&tree, 0, tree.size(), distance_type{});
 
       while (!stack.empty()) {
         auto entry = stack.back();
         stack.pop_back();
 
-        if (entry.first == entry.last || entry.a > entry.b + tau) {
+        if (entry.first == entry.last) {
+          continue;
+        } else if (entry.bound > limit) {
+          recorder.prune();
           continue;
         }
 
-        auto root = entry.first;
-        auto distance = m_metric(root->element, target);
-        if (distance <= tau) {
-          if (matches.size() == k) {
-            matches.pop();
+        recorder.visit();
+        if (entry.last - entry.first <= leaf_size()) {
+          if constexpr (IsBatchMetric<Metric, U, ElementIterator, distance_type*, distance_type>::value) {
+            distances.resize(entry.last - entry.first);
+            recorder.metric(distances.size(), [&] {
+              distance_many(m_metric, target, tree.elements.begin() + entry.first, tree.elements.begin() + entry.last, distances.data(), limit);
+            });
+            for (auto i = entry.first; i < entry.last; ++i) {
+              auto distance = distances[i - entry.first];
+              if (!tree.nodes[i].erased && distance <= limit) {
+                visitor(i, distance);
+              }
+            }
+            continue;
           }
-          matches.push(Match(root, distance));
-          if (matches.size() == k) {
-            tau = matches.top().distance();
+
+          for (auto i = entry.first; i < entry.last; ++i) {
+            if (!tree.nodes[i].erased) {
+              auto distance = recorder.metric(1, [&] { return bounded_distance(m_metric, tree.elements[i], target, limit); });
+              if (distance <= limit) {
+                visitor(i, distance);
+              }
+            }
           }
+          continue;
+        }
+
+        const auto& root = tree.nodes[entry.first];
+        auto distance = recorder.metric(1, [&] { return bounded_distance(m_metric, tree.elements[entry.first], target, search_limit(root, limit)); });
+        if (!root.erased && distance <= limit) {
+          visitor(entry.first, distance);
         }
 
-        auto left = root + 1;
-        auto right = entry.last;
-        if (left == right) {
+        push_children(stack, entry, distance);
+        recorder.stack(stack.size());
+      }
+    }
+
+    /** @return Whether every subtree's inside half fits inside it. */
+    bool
+    well_formed(const SubTree& tree) const
+    {
+      std::vector<std::pair<std::size_t, std::size_t>> stack;
+      stack.emplace_back(0, tree.size());
+
+      while (!stack.empty()) {
+        auto range = stack.back();
+        stack.pop_back();
+
+        if (range.second - range.first <= leaf_size()) {
           continue;
         }
 
-        auto mid = left + root->left_size;
+        auto left = range.first + 1;
+        auto left_size = tree.nodes[range.first].left_size;
+        if (left_size > range.second - left) {
+          return false;
+        }
 
-        auto radius = root->radius;
+        stack.emplace_back(left, left + left_size);
+        stack.emplace_back(left + left_size, range.second);
+      }
 
-        if (distance < radius) {
-          stack.emplace_back(mid, right, radius, distance);
-          stack.emplace_back(left, mid, distance, radius);
-        } else {
-          stack.emplace_back(left, mid, distance, radius);
-          stack.emplace_back(mid, right, radius, distance);
+      return true;
+    }
+
+    /** Build @p elements into a new tree and add it to the forest. */
+    void
+    add_tree(ElementVector elements)
+    {
+      if (elements.empty()) {
+        return;
+      }
+
+      m_size += elements.size();
+      m_trees.push_back(build_tree(std::move(elements)));
+    }
+
+    /** @return The elements of @p tree that aren't erased, ready to be rebuilt. */
+    static ElementVector
+    live_elements(SubTree tree)
+    {
+      ElementVector elements;
+      elements.reserve(tree.live());
+      for (std::size_t i = 0; i < tree.size(); ++i) {
+        if (!tree.nodes[i].erased) {
+          elements.push_back(std::move(tree.elements[i]));
+        }
+      }
+      return elements;
+    }
+
+    /**
+     * Restore the forest's shape after an insertion or erasure: drop empty
+     * trees, and merge trees until each is more than twice the size of the
+     * next.
+     */
+    void
+    normalize()
+    {
+      auto by_size = [](const SubTree& a, const SubTree& b) { return a.live() > b.live(); };
+
+      m_trees.erase(std::remove_if(m_trees.begin(), m_trees.end(), [](const SubTree& tree) { return tree.live() == 0; }), m_trees.end());
+      std::stable_sort(m_trees.begin(), m_trees.end(), by_size);
+
+      auto i = m_trees.size();
+      while (i >= 2) {
+        auto& larger = m_trees[i - 2];
+        auto& smaller = m_trees[i - 1];
+        if (larger.live() > 2*smaller.live()) {
+          --i;
+          continue;
         }
+
+        auto elements = live_elements(std::move(larger));
+        auto rest = live_elements(std::move(smaller));
+        elements.insert(elements.end(), std::make_move_iterator(rest.begin()), std::make_move_iterator(rest.end()));
+        larger = build_tree(std::move(elements));
+        m_trees.erase(m_trees.begin() + (i - 1));
+
+        std::stable_sort(m_trees.begin(), m_trees.end(), by_size);
+        i = m_trees.size();
       }
+    }
 
-      auto i = matches.size();
-      std::vector<Match> result{i};
-      while (!matches.empty()) {
-        result[--i] = matches.top();
-        matches.pop();
+    /**
+     * The largest distance to the vantage point @p root that can still affect
+     * a search with radius @p tau.  Beyond the outer edge of both shells plus
+     * tau, the element is not a match and both halves are pruned, so a
+     * bounded metric may stop early.  Its lower bound is then enough to prune
+     * them, since it too lies beyond both shells.
+     */
+    static distance_type
+    search_limit(const Node& root, distance_type tau)
+    {
+      auto hi = std::max(root.inside.hi, root.outside.hi);
+      if (tau > std::numeric_limits<distance_type>::max() - hi) {
+        return std::numeric_limits<distance_type>::max();
+      } else {
+        return hi + tau;
       }
-      return result;
     }
 
-  private:
-    NodeVector m_nodes;
-    Metric m_metric;
+    /**
+     * Scratch space for one element while building the tree.  The build
+     * arranges these rather than the elements themselves, which are moved into
+     * place once at the end.
+     */
+    struct BuildEntry
+    {
+      /** The index of the element in the unbuilt elements. */
+      std::size_t index;
+      /** The element's distance to the vantage point of its current range. */
+      distance_type distance;
+    };
+
+    using BuildVector = std::vector<BuildEntry>;
+    using BuildIterator = typename BuildVector::iterator;
+
+    /** State shared by a whole build. */
+    struct BuildState
+    {
+      const VpTreeOptions& options;
+      std::size_t leaf_size;
+      /** The unbuilt elements. */
+      const ElementVector& elements;
+      /** The metadata for each unbuilt element. */
+      NodeVector& nodes;
+      BuildIterator base;
+      TaskPool* pool;
+    };
+
+    static const T&
+    build_element(const BuildState& state, BuildIterator entry)
+    {
+      return state.elements[entry->index];
+    }
+
+    /** @return The elements, arranged into a tree. */
+    SubTree
+    build_tree(ElementVector elements) const
+    {
+      BuildVector entries(elements.size());
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+        entries[i].index = i;
+      }
+
+      NodeVector nodes(elements.size(), Node{{}, {}, 0, false});
+      if (m_options.threads == 1 || entries.size() < parallel_build_grain) {
+        BuildState state{m_options, leaf_size(), elements, nodes, entries.begin(), nullptr};
+        build_range(state, entries.begin(), entries.end());
+      } else {
+        TaskPool pool{m_options.threads};
+        BuildState state{m_options, leaf_size(), elements, nodes, entries.begin(), &pool};
+        pool.spawn([this, &state, &entries] { build_range_task(state, entries.begin(), entries.end()); });
+        pool.wait();
+      }
 
+      SubTree tree{{}, {}, 0};
+      tree.nodes.reserve(entries.size());
+      tree.elements.reserve(entries.size());
+      for (const auto& entry : entries) {
+        tree.nodes.push_back(nodes[entry.index]);
+        tree.elements.push_back(std::move(elements[entry.index]));
+      }
+      return tree;
+    }
+
+    /** Build the subtree over [first, last), one vantage point at a time. */
     void
-    build_tree()
+    build_range(const BuildState& state, BuildIterator first, BuildIterator last) const
     {
-      using iterator = typename NodeVector::iterator;
-      using SubRange = std::pair<iterator, iterator>;
+      using SubRange = std::pair<BuildIterator, BuildIterator>;
 
       std::vector<SubRange> stack;
-      stack.emplace_back(m_nodes.begin(), m_nodes.end());
+      stack.emplace_back(first, last);
 
       while (!stack.empty()) {
         auto range = stack.back();
         stack.pop_back();
 
-        if (range.second - range.first <= 1) {
+        if (static_cast<std::size_t>(range.second - range.first) <= state.leaf_size) {
           continue;
         }
 
         auto root = range.first;
-        auto begin = root + 1;
-        auto end = range.second;
-        auto mid = begin + (end - begin)/2;
-
-        auto compare = [=] (const Node& a, const Node& b) {
-          return m_metric(root->element, a.element) < m_metric(root->element, b.element);
-        };
-        std::nth_element(begin, mid, end, compare);
-
-        root->radius = m_metric(root->element, mid->element);
-        root->left_size = mid - begin;
-        stack.emplace_back(mid, end);
-        stack.emplace_back(begin, mid);
+        select_vantage_point(state, root, range.second);
+        compute_distances(state, root, root + 1, range.second);
+        auto mid = partition(state, root, range.second);
+        stack.emplace_back(mid, range.second);
+        stack.emplace_back(root + 1, mid);
+      }
+    }
+
+    /**
+     * Move the chosen vantage point for [first, last) to @p first.  With
+     * several candidates, the one whose distances to a sample of the range
+     * have the largest spread (second moment about their median) wins, as it
+     * separates the range most cleanly.
+     */
+    void
+    select_vantage_point(const BuildState& state, BuildIterator first, BuildIterator last) const
+    {
+      const auto& options = state.options;
+      std::size_t size = last - first;
+      if (options.vantage_point_candidates <= 1 || size < options.vantage_point_candidates*options.vantage_point_samples) {
+        return;
+      }
+
+      // Seed by position, so the choice doesn't depend on the build order
+      std::uint64_t position = first - state.base;
+      std::seed_seq seed{
+        static_cast<std::uint32_t>(options.seed), static_cast<std::uint32_t>(options.seed >> 32),
+        static_cast<std::uint32_t>(position), static_cast<std::uint32_t>(position >> 32),
+      };
+      std::mt19937_64 random{seed};
+
+      std::vector<double> distances(options.vantage_point_samples);
+      auto best = first;
+      auto best_spread = -1.0;
+      for (std::size_t i = 0; i < options.vantage_point_candidates; ++i) {
+        auto candidate = first + random()%size;
+        for (auto& distance : distances) {
+          auto sample = first + random()%size;
+          distance = m_metric(build_element(state, candidate), build_element(state, sample));
+        }
+
+        auto median = distances.begin() + distances.size()/2;
+        std::nth_element(distances.begin(), median, distances.end());
+        auto center = *median;
+        auto spread = 0.0;
+        for (auto distance : distances) {
+          spread += (distance - center)*(distance - center);
+        }
+
+        if (spread > best_spread) {
+          best = candidate;
+          best_spread = spread;
+        }
+      }
+
+      std::iter_swap(first, best);
+    }
+
+    /** Compute the distance from @p root to each element of [first, last) once. */
+    void
+    compute_distances(const BuildState& state, BuildIterator root, BuildIterator first, BuildIterator last) const
+    {
+      const auto& vantage_point = build_element(state, root);
+      for (auto entry = first; entry != last; ++entry) {
+        entry->distance = m_metric(vantage_point, build_element(state, entry));
+      }
+    }
+
+    /**
+     * Partition the range after @p root around the median of the computed
+     * distances to @p root, and record the shell each half falls in.
+     *
+     * @return The start of the outside half.
+     */
+    static BuildIterator
+    partition(const BuildState& state, BuildIterator root, BuildIterator end)
+    {
+      auto begin = root + 1;
+      auto mid = begin + (end - begin)/2;
+
+      auto by_distance = [](const BuildEntry& a, const BuildEntry& b) {
+        return a.distance < b.distance;
+      };
+      std::nth_element(begin, mid, end, by_distance);
+
+      auto& node = state.nodes[root->index];
+      node.outside = {mid->distance, std::max_element(mid, end, by_distance)->distance};
+      if (begin == mid) {
+        node.inside = {mid->distance, mid->distance};
+      } else {
+        auto inside = std::minmax_element(begin, mid, by_distance);
+        node.inside = {inside.first->distance, inside.second->distance};
+      }
+      node.left_size = mid - begin;
+      return mid;
+    }
+
+    /** Build the subtree over [first, last) with tasks from the build's pool. */
+    void
+    build_range_task(const BuildState& state, BuildIterator first, BuildIterator last) const
+    {
+      std::size_t size = last - first;
+      if (size < parallel_build_grain || size <= state.leaf_size) {
+        build_range(state, first, last);
+        return;
+      }
+
+      select_vantage_point(state, first, last);
+      if (size < parallel_partition_size) {
+        compute_distances(state, first, first + 1, last);
+        auto mid = partition(state, first, last);
+        spawn_halves(state, first, mid, last);
+      } else {
+        parallel_partition(state, first, last);
+      }
+    }
+
+    void
+    spawn_halves(const BuildState& state, BuildIterator root, BuildIterator mid, BuildIterator last) const
+    {
+      state.pool->spawn([this, &state, mid, last] { build_range_task(state, mid, last); });
+      state.pool->spawn([this, &state, root, mid] { build_range_task(state, root + 1, mid); });
+    }
+
+    /**
+     * Compute the distances to the vantage point @p root with several tasks,
+     * then partition and continue with the halves.
+     */
+    void
+    parallel_partition(const BuildState& state, BuildIterator root, BuildIterator end) const
+    {
+      auto begin = root + 1;
+      std::size_t size = end - begin;
+      auto chunks = (size + parallel_partition_chunk - 1)/parallel_partition_chunk;
+      auto remaining = std::make_shared<std::atomic<std::size_t>>(chunks);
+
+      for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        auto first = begin + chunk*parallel_partition_chunk;
+        auto last = begin + std::min((chunk + 1)*parallel_partition_chunk, size);
+        state.pool->spawn([this, &state, root, end, first, last, remaining] {
+          compute_distances(state, root, first, last);
+
+          // The last chunk to finish does the partitioning
+          if (--*remaining == 0) {
+            auto mid = partition(state, root, end);
+            spawn_halves(state, root, mid, end);
+          }
+        });
       }
     }
   };
@@ -30,6 +30,32 @@ test("English hybrid distance.", () => {
     expect(dist.distance(makeInput(""), makeInput(""))).toBe(0);
 });
 
+test("English hybrid distance within a limit.", () => {
+    const phrases = ["This, is a test.", "this is the best", "Jennifer", "Jenny", "John B", "Andrew Smith", "aaa", "bbb"];
+    const inputs = phrases.map(makeInput);
+    for (const weight of [0.1, 0.3, 0.7, 0.9]) {
+        const dist = new EnHybridDistance(weight);
+        for (const a of inputs) {
+            for (const b of inputs) {
+                const exact = dist.distance(a, b);
+                // A pair exactly at the limit is within it
+                expect(dist.distance(a, b, exact)).toBe(exact);
+                expect(dist.distance(a, b, exact + 1)).toBe(exact);
+                if (exact > 0) {
+                    expect(dist.distance(a, b, exact / 2)).toBeGreaterThan(exact / 2);
+                }
+            }
+        }
+    }
+});
+
+test("Non-number limit exception.", () => {
+    expect(() => {
+        const dist = new EnHybridDistance(0.7);
+        dist.distance(makeInput("aaa"), makeInput("bbb"), "1" as any);
+    }).toThrow();
+});
+
 test("ctor used as function exception.", () => {
     expect(() => {
         const distance = (EnHybridDistance as any)();
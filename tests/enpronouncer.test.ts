@@ -8,6 +8,64 @@ test("English pronouncer.", () => {
     expect(pronouncer.pronounce("This, is a test.").ipa).toBe("ðɪsɪzətɛst");
 });
 
+test("Lexical only pronouncer.", () => {
+    const pronouncer = new EnPronouncer(true);
+    expect(pronouncer.pronounce("This, is a test.").ipa).toBe(new EnPronouncer().pronounce("This, is a test.").ipa);
+});
+
+test("Non-boolean lexicalOnly exception.", () => {
+    expect(() => {
+        const pronouncer = new EnPronouncer("yes" as any);
+    }).toThrow();
+});
+
+test("Bulk pronunciation.", () => {
+    const pronouncer = new EnPronouncer();
+    const phrases = ["This, is a test.", "Main Street", "This, is a test.", "Main Street"];
+    const pronunciations = pronouncer.pronounceAll(phrases);
+    expect(pronunciations.map((pronunciation) => pronunciation.ipa)).toEqual(phrases.map((phrase) => pronouncer.pronounce(phrase).ipa));
+    expect(pronouncer.pronounceAll([])).toEqual([]);
+});
+
+test("Bulk pronouncing non-strings exception.", () => {
+    expect(() => {
+        const pronouncer = new EnPronouncer();
+        pronouncer.pronounceAll(["This, is a test.", 7] as any);
+    }).toThrow();
+});
+
+test("Pronunciation cache.", () => {
+    const pronouncer = new EnPronouncer();
+    EnPronouncer.clearCache();
+    EnPronouncer.setCacheBudget(1 << 20);
+    try {
+        const before = EnPronouncer.cacheStats();
+        const first = pronouncer.pronounce("This, is a test.");
+        const second = new EnPronouncer().pronounce("This, is a test.");
+        const after = EnPronouncer.cacheStats();
+
+        expect(second.ipa).toBe(first.ipa);
+        expect(after.misses - before.misses).toBe(1);
+        expect(after.hits - before.hits).toBe(1);
+        expect(after.entries).toBe(1);
+        expect(after.bytes).toBeGreaterThan(0);
+        expect(after.budget).toBe(1 << 20);
+    } finally {
+        EnPronouncer.setCacheBudget(0);
+    }
+    expect(EnPronouncer.cacheStats().entries).toBe(0);
+});
+
+test("Lexicon index matches the lexicon.", () => {
+    expect(EnPronouncer.checkLexiconIndex()).toEqual([]);
+});
+
+test("Negative cache budget exception.", () => {
+    expect(() => {
+        EnPronouncer.setCacheBudget(-1);
+    }).toThrow();
+});
+
 test("ctor used as function exception.", () => {
     expect(() => {
         const pronouncer = (EnPronouncer as any)();
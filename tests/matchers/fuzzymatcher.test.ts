@@ -1,8 +1,11 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
-import {AcceleratedFuzzyMatcher, FuzzyMatcher} from "../../ts/matchers"
+import {AcceleratedFuzzyMatcher, BkTreeFuzzyMatcher, FuzzyMatcher} from "../../ts/matchers"
 import {StringDistance,EnPhoneticDistance,EnHybridDistance} from "../../ts/distance"
+import * as fs from "fs"
+import * as os from "os"
+import * as path from "path"
 
 const targetStrings = [
     "Andrew Smith",
@@ -165,6 +168,93 @@ describe("FuzzyMatcher", () => {
         }));
     });
 
+    test("insert and erase.", () => {
+        const matcher = new FuzzyMatcher(targets, new StringDistance(), (target) => `${target.firstName} ${target.lastName}`);
+        const added = {firstName: "Jon", lastName: "Bee"};
+        matcher.insert(added);
+        expect(matcher.size()).toBe(targets.length + 1);
+        expect(matcher.nearest("Jon Bee").element).toBe(added);
+
+        expect(matcher.erase({...added})).toBe(false);
+        expect(matcher.erase(added)).toBe(true);
+        expect(matcher.erase(added)).toBe(false);
+        expect(matcher.size()).toBe(targets.length);
+        expect(matcher.nearest("Jon Bee").element).not.toBe(added);
+
+        expect(matcher.erase(targets[2])).toBe(true);
+        expect(matcher.nearest("John B").element).toBe(targets[3]);
+    });
+
+    test("search stats.", () => {
+        const matcher = new FuzzyMatcher(targetStrings, new StringDistance());
+        matcher.resetSearchStats();
+        matcher.kNearest("andrew smith", 2);
+        matcher.allWithin("jon", 3);
+
+        const stats = matcher.searchStats();
+        expect(stats.searches).toBe(stats.enabled ? 2 : 0);
+        expect(stats.evaluations).toBe(stats.enabled ? 2*targetStrings.length : 0);
+        matcher.resetSearchStats();
+        expect(matcher.searchStats().searches).toBe(0);
+        expect(matcher.treeShape()).toBeUndefined();
+    });
+
+    test("k nearest within batch.", () => {
+        const queries = ["andrew smith", "jon", "jenny"];
+        for (const matcher of [
+            new FuzzyMatcher(targetStrings, new StringDistance()),
+            new FuzzyMatcher(targetStrings, new EnPhoneticDistance()),
+            new FuzzyMatcher(targetStrings, simpleDistance),
+        ]) {
+            expect(matcher.kNearestWithinBatch(queries, 2, 0.5)).toEqual(queries.map((query) => matcher.kNearestWithin(query, 2, 0.5)));
+        }
+        expect(new FuzzyMatcher(targetStrings, simpleDistance).kNearestWithinBatch([], 2, 0.5)).toEqual([]);
+    });
+
+    test("k nearest within approximate.", () => {
+        const matcher = new FuzzyMatcher(targetStrings, new StringDistance());
+        for (const query of ["andrew smith", "jon", "jenny"]) {
+            expect(matcher.kNearestWithinApproximate(query, 2, 0.5, {})).toEqual({matches: matcher.kNearestWithin(query, 2, 0.5), exact: true});
+            const limited = matcher.kNearestWithinApproximate(query, 2, 0.5, {maxEvaluations: 1});
+            expect(limited.exact).toBe(false);
+            expect(limited.matches.length).toBeLessThanOrEqual(1);
+        }
+    });
+
+    test("all within.", () => {
+        for (const matcher of [
+            new FuzzyMatcher(targetStrings, new StringDistance()),
+            new FuzzyMatcher(targetStrings, simpleDistance),
+        ]) {
+            for (const query of ["andrew smith", "jon", "jenny"]) {
+                const all = matcher.allWithin(query, 0.5);
+                const nearest = matcher.kNearestWithin(query, targetStrings.length, 0.5);
+                expect(all.map((match) => match.distance)).toEqual(nearest.map((match) => match.distance));
+                expect(all.map((match) => match.element).sort()).toEqual(nearest.map((match) => match.element).sort());
+            }
+            expect(matcher.allWithin("jon", 0)).toEqual([]);
+        }
+    });
+
+    test("save and load.", () => {
+        const extract = (target: TestContact) => `${target.firstName} ${target.lastName}`;
+        const distance = new EnHybridDistance(0.7);
+        const matcher = new FuzzyMatcher(targets, distance, extract);
+        const added = {firstName: "Jon", lastName: "Bee"};
+        matcher.insert(added);
+        matcher.erase(targets[2]);
+
+        const file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "snapshot-")), "matcher.bin");
+        matcher.save(file);
+        const loaded = FuzzyMatcher.load(file, [...targets, added], distance, extract);
+        expect(loaded.size()).toBe(matcher.size());
+        for (const query of ["Jon Bee", "John B", "andrew smith", "jenny"]) {
+            expect(loaded.kNearest(query, 3)).toEqual(matcher.kNearest(query, 3));
+        }
+
+        expect(() => FuzzyMatcher.load(file, [], new StringDistance(), extract)).toThrow();
+    });
+
     test("ctor used as function exception.", () => {
         expect(() => {
             const matcher = (FuzzyMatcher as any)(targets);
@@ -279,6 +369,111 @@ describe("AcceleratedMatchers.FuzzyMatcher", () => {
         }));
     });
 
+    test("insert and erase.", () => {
+        const matcher = new AcceleratedFuzzyMatcher(targets, new StringDistance(), (target) => `${target.firstName} ${target.lastName}`);
+        const added = {firstName: "Jon", lastName: "Bee"};
+        matcher.insert(added);
+        expect(matcher.size()).toBe(targets.length + 1);
+        expect(matcher.nearest("Jon Bee").element).toBe(added);
+
+        expect(matcher.erase({...added})).toBe(false);
+        expect(matcher.erase(added)).toBe(true);
+        expect(matcher.erase(added)).toBe(false);
+        expect(matcher.size()).toBe(targets.length);
+        expect(matcher.nearest("Jon Bee").element).not.toBe(added);
+
+        expect(matcher.erase(targets[2])).toBe(true);
+        expect(matcher.nearest("John B").element).toBe(targets[3]);
+    });
+
+    test("search stats.", () => {
+        const matcher = new AcceleratedFuzzyMatcher(targetStrings, new StringDistance());
+        matcher.resetSearchStats();
+        matcher.kNearest("andrew smith", 2);
+        matcher.allWithin("jon", 3);
+
+        const stats = matcher.searchStats();
+        expect(stats.searches).toBe(stats.enabled ? 2 : 0);
+        expect(stats.evaluations).toBeLessThanOrEqual(2*targetStrings.length);
+        matcher.resetSearchStats();
+        expect(matcher.searchStats().searches).toBe(0);
+
+        const shape = matcher.treeShape()!;
+        expect(shape.nodes).toBe(targetStrings.length);
+        expect(shape.leaves).toBeGreaterThan(0);
+    });
+
+    test("k nearest within batch.", () => {
+        const queries = ["andrew smith", "jon", "jenny"];
+        for (const matcher of [
+            new AcceleratedFuzzyMatcher(targetStrings, new StringDistance()),
+            new AcceleratedFuzzyMatcher(targetStrings, new EnPhoneticDistance()),
+            new AcceleratedFuzzyMatcher(targetStrings, simpleDistance),
+        ]) {
+            expect(matcher.kNearestWithinBatch(queries, 2, 0.5)).toEqual(queries.map((query) => matcher.kNearestWithin(query, 2, 0.5)));
+        }
+        expect(new AcceleratedFuzzyMatcher(targetStrings, simpleDistance).kNearestWithinBatch([], 2, 0.5)).toEqual([]);
+    });
+
+    test("k nearest within approximate.", () => {
+        const matcher = new AcceleratedFuzzyMatcher(targetStrings, new StringDistance());
+        for (const query of ["andrew smith", "jon", "jenny"]) {
+            expect(matcher.kNearestWithinApproximate(query, 2, 0.5, {})).toEqual({matches: matcher.kNearestWithin(query, 2, 0.5), exact: true});
+            const limited = matcher.kNearestWithinApproximate(query, 2, 0.5, {maxEvaluations: 1});
+            expect(limited.exact).toBe(false);
+            expect(limited.matches.length).toBeLessThanOrEqual(1);
+        }
+    });
+
+    test("all within.", () => {
+        for (const matcher of [
+            new AcceleratedFuzzyMatcher(targetStrings, new StringDistance()),
+            new AcceleratedFuzzyMatcher(targetStrings, simpleDistance),
+        ]) {
+            for (const query of ["andrew smith", "jon", "jenny"]) {
+                const all = matcher.allWithin(query, 0.5);
+                const nearest = matcher.kNearestWithin(query, targetStrings.length, 0.5);
+                expect(all.map((match) => match.distance)).toEqual(nearest.map((match) => match.distance));
+                expect(all.map((match) => match.element).sort()).toEqual(nearest.map((match) => match.element).sort());
+            }
+            expect(matcher.allWithin("jon", 0)).toEqual([]);
+        }
+    });
+
+    test("save and load.", () => {
+        const extract = (target: TestContact) => `${target.firstName} ${target.lastName}`;
+        const distance = new EnHybridDistance(0.7);
+        const matcher = new AcceleratedFuzzyMatcher(targets, distance, extract);
+        const added = {firstName: "Jon", lastName: "Bee"};
+        matcher.insert(added);
+        matcher.erase(targets[2]);
+
+        const file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "snapshot-")), "matcher.bin");
+        matcher.save(file);
+        const loaded = AcceleratedFuzzyMatcher.load(file, [...targets, added], distance, extract);
+        expect(loaded.size()).toBe(matcher.size());
+        for (const query of ["Jon Bee", "John B", "andrew smith", "jenny"]) {
+            expect(loaded.kNearest(query, 3)).toEqual(matcher.kNearest(query, 3));
+        }
+
+        expect(() => FuzzyMatcher.load(file, [], new StringDistance(), extract)).toThrow();
+    });
+
+    test("save and load with a distance function.", () => {
+        const matcher = new AcceleratedFuzzyMatcher(targetStrings, simpleDistance);
+        const file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "snapshot-")), "matcher.bin");
+        matcher.save(file);
+
+        const loaded = AcceleratedFuzzyMatcher.load(file, targetStrings, simpleDistance);
+        for (const query of ["andrew smith", "jon", "jenny"]) {
+            expect(loaded.kNearest(query, 3)).toEqual(matcher.kNearest(query, 3));
+        }
+
+        const otherDistance = (a: string, b: string) => Math.abs(a.length - b.length);
+        expect(() => AcceleratedFuzzyMatcher.load(file, targetStrings, otherDistance)).toThrow();
+        expect(() => AcceleratedFuzzyMatcher.load(file, targetStrings, simpleDistance, (target: string) => target)).toThrow();
+    });
+
     test("ctor used as function exception.", () => {
         expect(() => {
             const matcher = (AcceleratedFuzzyMatcher as any)(targets);
@@ -292,3 +487,54 @@ describe("AcceleratedMatchers.FuzzyMatcher", () => {
         }).toThrow();
     });
 });
+
+describe("BkTreeFuzzyMatcher", () => {
+    const extract = (target: TestContact) => `${target.firstName} ${target.lastName}`;
+    const queries = ["andrew smith", "jon", "jenny", "John B", ""];
+
+    test("agrees with FuzzyMatcher.", () => {
+        const expected = new FuzzyMatcher(targets, new StringDistance(), extract);
+        const matcher = new BkTreeFuzzyMatcher(targets, new StringDistance(), extract);
+        expect(matcher.size()).toBe(targets.length);
+        for (const query of queries) {
+            expect(matcher.nearest(query)!.distance).toBe(expected.nearest(query)!.distance);
+            expect(matcher.kNearest(query, 3).map((m) => m.distance)).toEqual(expected.kNearest(query, 3).map((m) => m.distance));
+            expect(matcher.kNearestWithin(query, 3, 5).map((m) => m.distance)).toEqual(expected.kNearestWithin(query, 3, 5).map((m) => m.distance));
+            expect(matcher.allWithin(query, 6)).toEqual(expected.allWithin(query, 6));
+        }
+    });
+
+    test("requires a StringDistance.", () => {
+        expect(() => new BkTreeFuzzyMatcher(targets, simpleDistance)).toThrow();
+        expect(() => new BkTreeFuzzyMatcher(targets, new EnPhoneticDistance() as any, extract)).toThrow();
+    });
+
+    test("insert and erase.", () => {
+        const matcher = new BkTreeFuzzyMatcher(targets, new StringDistance(), extract);
+        const added = {firstName: "Jon", lastName: "Bee"};
+        matcher.insert(added);
+        expect(matcher.size()).toBe(targets.length + 1);
+        expect(matcher.nearest("Jon Bee")!.element).toBe(added);
+
+        expect(matcher.erase(added)).toBe(true);
+        expect(matcher.erase(added)).toBe(false);
+        expect(matcher.size()).toBe(targets.length);
+        expect(matcher.nearest("Jon Bee")!.element).not.toBe(added);
+    });
+
+    test("save and load.", () => {
+        const distance = new StringDistance();
+        const matcher = new BkTreeFuzzyMatcher(targets, distance, extract);
+        matcher.erase(targets[1]);
+
+        const file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "snapshot-")), "matcher.bin");
+        matcher.save(file);
+        const loaded = BkTreeFuzzyMatcher.load(file, targets, distance, extract);
+        expect(loaded.size()).toBe(matcher.size());
+        for (const query of queries) {
+            expect(loaded.kNearest(query, 3)).toEqual(matcher.kNearest(query, 3));
+        }
+
+        expect(() => AcceleratedFuzzyMatcher.load(file, targets, distance, extract)).toThrow();
+    });
+});
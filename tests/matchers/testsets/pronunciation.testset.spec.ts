@@ -0,0 +1,52 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+import { EnPronouncer } from "../../../ts"
+
+interface TestElement {
+    element: { id: string, name: string, address?: string };
+    queries: Array<{ query: string, transcriptions: Array<{ utterance: string }> }>;
+}
+
+/**
+ * Check that the lexical pipeline pronounces every phrase of a test set like the full synthesis pipeline, and time both.
+ */
+function comparePipelines(testSet: TestElement[], label: string) {
+    const phrases: string[] = [];
+    testSet.forEach((test) => {
+        phrases.push(test.element.name);
+        if (test.element.address) {
+            phrases.push(test.element.address);
+        }
+        test.queries.forEach((query) => {
+            phrases.push(query.query);
+            query.transcriptions.forEach((transcription) => phrases.push(transcription.utterance));
+        });
+    });
+
+    const full = new EnPronouncer();
+    const lexical = new EnPronouncer(true);
+
+    let start = Date.now();
+    const expected = phrases.map((phrase) => full.pronounce(phrase).ipa);
+    const fullTime = Date.now() - start;
+
+    start = Date.now();
+    const actual = phrases.map((phrase) => lexical.pronounce(phrase).ipa);
+    const lexicalTime = Date.now() - start;
+
+    console.log(`${label}: ${phrases.length} phrases, full synthesis ${fullTime}ms, lexical ${lexicalTime}ms`);
+    actual.forEach((ipa, i) => {
+        expect([phrases[i], ipa]).toEqual([phrases[i], expected[i]]);
+    });
+}
+
+describe("TESTSET pronunciation", () => {
+    test("lexical pipeline - contacts", () => {
+        comparePipelines(require("./contacts.json"), "Contacts");
+    });
+
+    test("lexical pipeline - places", () => {
+        comparePipelines(require("./places.json"), "Places");
+    });
+});
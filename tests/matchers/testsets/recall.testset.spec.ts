@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+import { AcceleratedFuzzyMatcher } from "../../../ts/matchers"
+import { EnHybridDistance } from "../../../ts/distance"
+import { Speech } from "../../../ts"
+
+interface TestElement {
+    element: { id: string, name: string };
+    queries: Array<{ transcriptions: Array<{ utterance: string }> }>;
+}
+
+// Recall is measured over the K nearest matches, with no threshold.
+const K = 4;
+
+const SEARCH_OPTIONS: Array<[string, Speech.SearchOptions]> = [
+    ["maxEvaluations 25", {maxEvaluations: 25}],
+    ["maxEvaluations 100", {maxEvaluations: 100}],
+    ["maxEvaluations 400", {maxEvaluations: 400}],
+    ["epsilon 0.1", {epsilon: 0.1}],
+    ["epsilon 0.5", {epsilon: 0.5}],
+    ["epsilon 1", {epsilon: 1}],
+    ["timeout 0.1ms", {timeout: 0.1}],
+];
+
+/**
+ * Check that the distances of @p more, found with a larger evaluation budget, are each no worse than those of @p fewer.
+ */
+function expectNoWorse(more: Speech.ApproximateMatches<string>, fewer: Speech.ApproximateMatches<string>) {
+    expect(more.matches.length).toBeGreaterThanOrEqual(fewer.matches.length);
+    fewer.matches.forEach((match, i) => {
+        expect(more.matches[i].distance).toBeLessThanOrEqual(match.distance);
+    });
+}
+
+/**
+ * Report the recall@K of approximate searches against exact ones, for each kind of limit, and check the guarantees each limit gives.
+ */
+function approximateRecall(testSet: TestElement[], label: string) {
+    const names = testSet.map((test) => test.element.name);
+    const matcher = new AcceleratedFuzzyMatcher(names, new EnHybridDistance(0.7));
+    const utterances: string[] = [];
+    testSet.forEach((test) => test.queries.forEach((query) => query.transcriptions.forEach((transcription) => {
+        utterances.push(transcription.utterance);
+    })));
+    const exact = utterances.map((utterance) => matcher.kNearest(utterance, K));
+
+    const results = new Map<string, Speech.ApproximateMatches<string>[]>();
+    SEARCH_OPTIONS.forEach(([name, options]) => {
+        const approximate: Speech.ApproximateMatches<string>[] = [];
+        results.set(name, approximate);
+        let found = 0;
+        let total = 0;
+        let exactCount = 0;
+        utterances.forEach((utterance, i) => {
+            const result = matcher.kNearestWithinApproximate(utterance, K, Infinity, options);
+            approximate.push(result);
+            const expected = exact[i].map((match) => match.element);
+            found += result.matches.filter((match) => expected.indexOf(match.element) >= 0).length;
+            total += expected.length;
+            if (result.exact) {
+                ++exactCount;
+                expect(result.matches.map((match) => match.distance)).toEqual(exact[i].map((match) => match.distance));
+            }
+        });
+        const recall = total > 0 ? found/total : 1;
+        console.log(`${label} ${name}: recall@${K} ${(recall*100).toFixed(1)}%, ${exactCount}/${utterances.length} guaranteed exact`);
+
+        // The Kth match is within a factor of 1 + epsilon of the exact one
+        if (options.epsilon !== undefined) {
+            const slack = 1 + options.epsilon;
+            approximate.forEach((result, i) => {
+                expect(result.matches.length).toBe(exact[i].length);
+                if (exact[i].length > 0) {
+                    const kth = exact[i][exact[i].length - 1].distance;
+                    expect(result.matches[result.matches.length - 1].distance).toBeLessThanOrEqual(kth*slack*(1 + 1e-9));
+                }
+            });
+        }
+    });
+
+    // A search with a larger budget evaluates the same targets first, so it never does worse
+    const budgets = ["maxEvaluations 25", "maxEvaluations 100", "maxEvaluations 400"].map((name) => results.get(name)!);
+    for (let b = 1; b < budgets.length; ++b) {
+        utterances.forEach((utterance, i) => expectNoWorse(budgets[b][i], budgets[b - 1][i]));
+    }
+}
+
+describe("TESTSET recall", () => {
+    test("approximate search - contacts", () => {
+        approximateRecall(require("./contacts.json"), "Contacts");
+    });
+
+    test("approximate search - places", () => {
+        approximateRecall(require("./places.json"), "Places");
+    });
+});
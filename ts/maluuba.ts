@@ -22,6 +22,8 @@ export interface Maluuba {
     EnPronouncer: EnPronouncerConstructor;
 
     AcceleratedFuzzyMatcher : FuzzyMatcherConstructor;
+    /** Like {@link AcceleratedFuzzyMatcher}, indexed by a BK-tree. The distance must be a {@link StringDistance}. */
+    BkTreeFuzzyMatcher : FuzzyMatcherConstructor;
     FuzzyMatcher : FuzzyMatcherConstructor;
 
     StringDistance : StringDistanceConstructor;
@@ -63,7 +65,39 @@ export interface EnPronunciationStatic {
  * @interface EnPronouncerConstructor
  */
 export interface EnPronouncerConstructor {
-    new(): Speech.EnPronouncer;
+    /**
+     * @param {boolean} [lexicalOnly] Whether to run only the flite modules that settle the phones and their stress, skipping the prosody models. This is faster and meant to give the same pronunciations as the whole synthesis pipeline, which is the default.
+     */
+    new(lexicalOnly?: boolean): Speech.EnPronouncer;
+
+    /**
+     * Set the memory budget of the pronunciation cache shared by every pronouncer, which remembers the pronunciations of repeated texts.
+     *
+     * @param {number} bytes The budget, or 0 (the default) to disable the cache.
+     * @memberof EnPronouncerConstructor
+     */
+    setCacheBudget(bytes: number): void;
+
+    /**
+     * @returns {Speech.PronunciationCacheStats} The counts of the pronunciation cache.
+     * @memberof EnPronouncerConstructor
+     */
+    cacheStats(): Speech.PronunciationCacheStats;
+
+    /**
+     * Empty the pronunciation cache.
+     *
+     * @memberof EnPronouncerConstructor
+     */
+    clearCache(): void;
+
+    /**
+     * Check the lexicon index used by lexical-only pronouncers against flite's own lexicon lookups, for every word in the lexicon. This is meant for tests.
+     *
+     * @returns {string[]} The entries, as "pos word", that the index lacks or disagrees with flite on.
+     * @memberof EnPronouncerConstructor
+     */
+    checkLexiconIndex(): string[];
 };
 
 /**
@@ -101,10 +135,10 @@ export interface EnHybridDistanceConstructor {
      *
      * @param {number} phoneticWeightPercentage Between 0 and 1. Weighting trade-off between the phonetic
      *  distance and the lexical distance scores. 1 meaning 100% phonetic score and 0% lexical score.
-     * @returns {(Speech.Distance<DistanceInput> & {readonly phoneticWeightPercentage: number})}
+     * @returns {(Speech.Distance<DistanceInput> & Speech.BoundedDistance<DistanceInput> & {readonly phoneticWeightPercentage: number})}
      * @memberof EnHybridDistanceConstructor
      */
-    new(phoneticWeightPercentage: number): Speech.Distance<DistanceInput> & {readonly phoneticWeightPercentage: number};
+    new(phoneticWeightPercentage: number): Speech.Distance<DistanceInput> & Speech.BoundedDistance<DistanceInput> & {readonly phoneticWeightPercentage: number};
 };
 
 /**
@@ -132,6 +166,28 @@ export interface FuzzyMatcherConstructor {
         distance: ((a: Pronounceable, b: Pronounceable) => number) | Speech.Distance<Pronounceable>,
         extract?: (target: Target) => Extraction
     ): Speech.FuzzyMatcher<Target, Extraction>;
+
+    /**
+     * Load a fuzzy matcher from a snapshot written by {@link Speech.FuzzyMatcher.save}, without preparing the targets or building the matcher again.
+     * The snapshot is decoded into memory, so every loaded matcher holds its own copy of the index.
+     * A distance or extract function must have the same source code as the saved matcher's, or loading throws.
+     *
+     * @template Target The type of the object to match against.
+     * @template Pronounceable The type of input for the distance function.
+     * @template Extraction The type of query object.
+     * @param {string} path The snapshot file.
+     * @param {Array<Target>} targets The targets the saved matcher was constructed with, followed by every target inserted since, in order (including erased ones).
+     * @param {(((a: Pronounceable, b: Pronounceable) => number) | Speech.Distance<Pronounceable>)} distance The distance function the saved matcher used.
+     * @param {(target: Target) => Extraction} [extract] The mapping the saved matcher used.
+     * @returns {Speech.FuzzyMatcher<Target, Extraction>} The fuzzy matcher instance.
+     * @memberof FuzzyMatcherConstructor
+     */
+    load<Target, Pronounceable, Extraction>(
+        path: string,
+        targets: Array<Target>,
+        distance: ((a: Pronounceable, b: Pronounceable) => number) | Speech.Distance<Pronounceable>,
+        extract?: (target: Target) => Extraction
+    ): Speech.FuzzyMatcher<Target, Extraction>;
 };
 
 /**
@@ -319,11 +375,159 @@ export namespace Speech {
          * @memberof EnPronouncer
          */
         pronounce(phrase: string): EnPronunciation;
+
+        /**
+         * Pronounce many texts at once, in parallel, pronouncing each distinct text only once.
+         *
+         * @param {string[]} phrases The texts to pronounce.
+         * @returns {EnPronunciation[]} The English Pronunciation of each text, in the same order.
+         * @memberof EnPronouncer
+         */
+        pronounceAll(phrases: string[]): EnPronunciation[];
+    };
+
+    /**
+     * What the pronunciation cache has done and holds.
+     *
+     * @export
+     * @interface PronunciationCacheStats
+     */
+    export interface PronunciationCacheStats {
+        readonly hits: number;
+        readonly misses: number;
+        /**
+         * The number of pronunciations evicted to stay within the budget.
+         */
+        readonly evictions: number;
+        readonly entries: number;
+        /**
+         * The estimated memory held by the entries, in bytes.
+         */
+        readonly bytes: number;
+        readonly budget: number;
     };
     
     export interface Distance<T> {
         distance(a: T, b: T): number;
     };
+
+    /**
+     * A distance that can give up once it exceeds a limit, as the matchers' searches do.
+     *
+     * @export
+     * @interface BoundedDistance
+     */
+    export interface BoundedDistance<T> {
+        /**
+         * @param {T} a The first input.
+         * @param {T} b The second input.
+         * @param {number} limit The largest distance of interest.
+         * @returns {number} The distance if it is at most limit, otherwise a lower bound for it that exceeds limit.
+         * @memberof BoundedDistance
+         */
+        distance(a: T, b: T, limit: number): number;
+    };
+
+    /**
+     * Limits that trade the accuracy of a search for its speed. A search that reaches one returns the best matches found so far.
+     *
+     * @export
+     * @interface SearchOptions
+     */
+    export interface SearchOptions {
+        /**
+         * The most distances to compute. 0 or absent for no limit.
+         */
+        maxEvaluations?: number;
+        /**
+         * The most milliseconds to search for.
+         */
+        timeout?: number;
+        /**
+         * Skip parts of an accelerated matcher's index that can't hold a match closer than the current __k__th match divided by 1 + __epsilon__.
+         */
+        epsilon?: number;
+    };
+
+    /**
+     * The result of a search that may be approximate.
+     *
+     * @export
+     * @interface ApproximateMatches
+     * @template T The element type.
+     */
+    export interface ApproximateMatches<T> {
+        readonly matches: Array<Match<T>>;
+        /**
+         * Whether __matches__ are guaranteed to be the same as an unlimited search's.
+         */
+        readonly exact: boolean;
+    };
+
+    /**
+     * What a matcher's searches have done. Only counted when the native module is built with MALUUBA_SEARCH_STATS=1, otherwise every count is 0.
+     *
+     * @export
+     * @interface SearchStats
+     */
+    export interface SearchStats {
+        /**
+         * Whether the native module counts searches at all.
+         */
+        readonly enabled: boolean;
+        readonly searches: number;
+        /**
+         * The number of distances computed.
+         */
+        readonly evaluations: number;
+        /**
+         * The number of subtrees, or targets of an unaccelerated matcher, expanded.
+         */
+        readonly nodesVisited: number;
+        /**
+         * The number of subtrees, or targets of an unaccelerated matcher, skipped by their bounds.
+         */
+        readonly subtreesPruned: number;
+        /**
+         * The most pending subtrees any one search held at once.
+         */
+        readonly stackHighWater: number;
+        /**
+         * The milliseconds spent computing distances.
+         */
+        readonly metricTime: number;
+        /**
+         * The rest of the milliseconds spent searching.
+         */
+        readonly traversalTime: number;
+    };
+
+    /**
+     * The shape of an accelerated matcher's vantage point tree.
+     *
+     * @export
+     * @interface TreeShape
+     */
+    export interface TreeShape {
+        /**
+         * The number of static trees the index is split into.
+         */
+        readonly trees: number;
+        readonly nodes: number;
+        readonly leaves: number;
+        readonly maxDepth: number;
+        readonly meanDepth: number;
+        /**
+         * The fraction of splits whose halves share a boundary distance, so neither can be pruned for some targets.
+         */
+        readonly tiedSplits: number;
+        /**
+         * The smallest, median and largest distances from a vantage point to the outside half of its subtree.
+         */
+        readonly minRadius: number;
+        readonly medianRadius: number;
+        readonly maxRadius: number;
+    };
     
     /**
      * A fuzzy matcher. The fuzziness it determined by the provided distance function.
@@ -341,11 +545,36 @@ export namespace Speech {
         empty(): boolean;
 
         /**
-         * @returns {number} The number of targets constructed with.
+         * @returns {number} The number of targets.
          * @memberof FuzzyMatcher
          */
         size(): number;
 
+        /**
+         * Add a target, without rebuilding the whole matcher.
+         *
+         * @param {Target} target The target to add.
+         * @memberof FuzzyMatcher
+         */
+        insert(target: Target): void;
+
+        /**
+         * Remove a target. It is looked up by distance, so the distance from its extraction to itself must be 0.
+         *
+         * @param {Target} target The target to remove, compared with ===.
+         * @returns {boolean} true iff __target__ was found and removed.
+         * @memberof FuzzyMatcher
+         */
+        erase(target: Target): boolean;
+
+        /**
+         * Save the prepared targets, and the index if accelerated, to a snapshot file that {@link FuzzyMatcherConstructor.load} can reload.
+         *
+         * @param {string} path The snapshot file.
+         * @memberof FuzzyMatcher
+         */
+        save(path: string): void;
+
         /**
          * Find the nearest element.
          *
@@ -385,8 +614,60 @@ export namespace Speech {
          * @memberof FuzzyMatcher
          */
         kNearestWithin(target: Extraction, k: number, threshold: number): Array<Match<Target>>;
+
+        /**
+         * Find the __k__ nearest elements, giving up some accuracy to stay within the limits of __options__.
+         *
+         * @param {Extraction} target The search target.
+         * @param {number} k The maximum number of result to return.
+         * @param {number} threshold The maximum distance to a match.
+         * @param {SearchOptions} options The limits on the search.
+         * @returns {ApproximateMatches<Target>} The nearest matches found to __target__ within __threshold__, and whether they are exact.
+         * @memberof FuzzyMatcher
+         */
+        kNearestWithinApproximate(target: Extraction, k: number, threshold: number, options: SearchOptions): ApproximateMatches<Target>;
+
+        /**
+         * Find the __k__ nearest elements to each of many targets in one call. Native distances are computed on a pool of threads.
+         *
+         * @param {Array<Extraction>} targets The search targets.
+         * @param {number} k The maximum number of result to return per target.
+         * @param {number} threshold The maximum distance to a match.
+         * @returns {Array<Array<Match<Target>>>} The __k__ nearest matches to each of __targets__ within __threshold__, in the same order.
+         * @memberof FuzzyMatcher
+         */
+        kNearestWithinBatch(targets: Array<Extraction>, k: number, threshold: number): Array<Array<Match<Target>>>;
+
+        /**
+         * Find every element within a distance of the target, however many there are.
+         *
+         * @param {Extraction} target The search target.
+         * @param {number} threshold The maximum distance to a match.
+         * @returns {Array<Match<Target>>} All the matches to __target__ within __threshold__, nearest first.
+         * @memberof FuzzyMatcher
+         */
+        allWithin(target: Extraction, threshold: number): Array<Match<Target>>;
+
+        /**
+         * @returns {SearchStats} The counts of every search since construction or the last __resetSearchStats()__.
+         * @memberof FuzzyMatcher
+         */
+        searchStats(): SearchStats;
+
+        /**
+         * Zero the counts returned by __searchStats()__.
+         *
+         * @memberof FuzzyMatcher
+         */
+        resetSearchStats(): void;
+
+        /**
+         * @returns {(TreeShape | undefined)} The shape of an accelerated matcher's index, or undefined for other matchers.
+         * @memberof FuzzyMatcher
+         */
+        treeShape(): TreeShape | undefined;
     };
 }
 
 export const { EnPronouncer, EnPronunciation, EnPhoneticDistance, FuzzyMatcher, AcceleratedFuzzyMatcher, 
-    EnHybridDistance, StringDistance } = maluuba;
\ No newline at end of file
+    BkTreeFuzzyMatcher, EnHybridDistance, StringDistance } = maluuba;
\ No newline at end of file
@@ -81,8 +81,6 @@ export class EnContactMatcher<Contact> {
 
     private readonly nameFuzzyMatcher: Speech.FuzzyMatcher<Target<Contact>, string>;
     private readonly aliasFuzzyMatcher: Speech.FuzzyMatcher<Target<Contact>, string>;
-    private readonly nameMaxWindowSize: number;
-    private readonly aliasMaxWindowSize: number;
 
 
     /**
@@ -100,15 +98,12 @@ export class EnContactMatcher<Contact> {
         const nameTargets: Map<string, Target<Contact>> = new Map();
         const aliasTargets: Map<string, Target<Contact>> = new Map();
 
-        let nameMaxWindowSize = 1;
-        let aliasMaxWindowSize = 1;
         contacts.forEach((contact, index) => {
             const fields = extractContactFields(contact);
 
             if (fields.name) {
                 const name = EnContactMatcher.preprocessor.preProcess(fields.name);
                 const nameVariations = this.addNameVariations(contact, name, index);
-                nameMaxWindowSize = Math.max(nameMaxWindowSize, nameVariations.length);
                 for (const variation of nameVariations) {
                     nameTargets.set(JSON.stringify({id:variation.id, phrase:variation.phrase}), variation);
                 }
@@ -117,7 +112,6 @@ export class EnContactMatcher<Contact> {
                 for (const alias of fields.aliases) {
                     // Not preprocessing given aliases, respecting what was passed in.
                     const aliasVariations = this.addNameVariations(contact, alias, index);
-                    aliasMaxWindowSize = Math.max(aliasMaxWindowSize, aliasVariations.length);
                     for (const variation of aliasVariations) {
                         aliasTargets.set(JSON.stringify({id:variation.id, phrase:variation.phrase}), variation);
                     }
@@ -125,8 +119,6 @@ export class EnContactMatcher<Contact> {
             }
         });
 
-        this.nameMaxWindowSize = nameMaxWindowSize;
-        this.aliasMaxWindowSize = aliasMaxWindowSize;
         const distance = new EnHybridDistance(this.config.phoneticWeightPercentage);
         const extract = (contact: Target<Contact>) => contact.phrase;
         this.nameFuzzyMatcher = new AcceleratedFuzzyMatcher(Array.from(nameTargets.values()), distance, extract);
@@ -142,10 +134,8 @@ export class EnContactMatcher<Contact> {
      */
     find(query: string): Contact[] {
         const target = EnContactMatcher.preprocessor.preProcess(query);
-        const nameMaxWindow = this.nameMaxWindowSize * this.config.maxReturns;
-        const aliasMaxWindow = this.aliasMaxWindowSize * this.config.maxReturns;
-        const names = this.nameFuzzyMatcher.kNearestWithin(target, nameMaxWindow, this.config.findThreshold);
-        const aliases = this.aliasFuzzyMatcher.kNearestWithin(target, aliasMaxWindow, this.config.findThreshold);
+        const names = this.nameFuzzyMatcher.allWithin(target, this.config.findThreshold);
+        const aliases = this.aliasFuzzyMatcher.allWithin(target, this.config.findThreshold);
         const candidates = this.merge(names, aliases);
         return this.selectMatches(candidates);
     }
@@ -159,8 +149,7 @@ export class EnContactMatcher<Contact> {
      */
     findByName(name: string): Contact[] {
         const target = EnContactMatcher.preprocessor.preProcess(name);
-        const nameMaxWindow = this.nameMaxWindowSize * this.config.maxReturns;
-        const candidates = this.nameFuzzyMatcher.kNearestWithin(target, nameMaxWindow, this.config.findThreshold);
+        const candidates = this.nameFuzzyMatcher.allWithin(target, this.config.findThreshold);
         return this.selectMatches(candidates);
     }
 
@@ -173,8 +162,7 @@ export class EnContactMatcher<Contact> {
      */
     findByAlias(alias: string): Contact[] {
         const target = EnContactMatcher.preprocessor.preProcess(alias);
-        const aliasMaxWindow = this.aliasMaxWindowSize * this.config.maxReturns;
-        const candidates = this.aliasFuzzyMatcher.kNearestWithin(target, aliasMaxWindow, this.config.findThreshold);
+        const candidates = this.aliasFuzzyMatcher.allWithin(target, this.config.findThreshold);
         return this.selectMatches(candidates);
     }
 
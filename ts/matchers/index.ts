@@ -1,7 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
-export {FuzzyMatcher, AcceleratedFuzzyMatcher} from "../maluuba";
+export {FuzzyMatcher, AcceleratedFuzzyMatcher, BkTreeFuzzyMatcher} from "../maluuba";
 export * from "./contactmatcher";
 export * from "./placematcher";
 export * from "./matcherconfig";
\ No newline at end of file
@@ -87,7 +87,6 @@ export class EnPlaceMatcher<Place> {
     private static readonly preprocessor = new EnPlacesPreProcessor();
 
     private readonly fuzzyMatcher: Speech.FuzzyMatcher<Target<Place>, string>;
-    private readonly maxWindowSize: number;
 
     /**
      * Creates an instance of EnPlaceMatcher.
@@ -103,7 +102,6 @@ export class EnPlaceMatcher<Place> {
             public readonly config: MatcherConfig = new PlaceMatcherConfig()) {
         const targets: Map<string, Target<Place>> = new Map();
 
-        let maxWindowSize = 1;
         places.forEach((place, index) => {
             const fields = extractPlaceFields(place);
 
@@ -116,7 +114,6 @@ export class EnPlaceMatcher<Place> {
                 address = EnPlaceMatcher.preprocessor.preProcess(fields.address);
             }
             const nameVariations = this.addNameVariations(place, index, name, address);
-            maxWindowSize = Math.max(maxWindowSize, nameVariations.length);
             for (const variation of nameVariations) {
                 targets.set(JSON.stringify({id:variation.id, phrase:variation.phrase}), variation);
             }
@@ -124,7 +121,6 @@ export class EnPlaceMatcher<Place> {
                 for (const type of fields.types) {
                     // Not preprocessing given types, respecting what was passed in.
                     const fieldVariations = this.addNameVariations(place, index, type);
-                    maxWindowSize = Math.max(maxWindowSize, fieldVariations.length);
                     for (const variation of fieldVariations) {
                         targets.set(JSON.stringify({id:variation.id, phrase:variation.phrase}), variation);
                     }
@@ -132,7 +128,6 @@ export class EnPlaceMatcher<Place> {
             }
         });
 
-        this.maxWindowSize = maxWindowSize;
         const distance = new EnHybridDistance(this.config.phoneticWeightPercentage);
         const extract = (place: Target<Place>) => place.phrase;
         this.fuzzyMatcher = new AcceleratedFuzzyMatcher(Array.from(targets.values()), distance, extract);
@@ -147,8 +142,7 @@ export class EnPlaceMatcher<Place> {
      */
     find(query: string): Place[] {
         const target = EnPlaceMatcher.preprocessor.preProcess(query);
-        const maxWindow = this.maxWindowSize * this.config.maxReturns;
-        const candidates = this.fuzzyMatcher.kNearestWithin(target, maxWindow, this.config.findThreshold);
+        const candidates = this.fuzzyMatcher.allWithin(target, this.config.findThreshold);
         const result = this.selectMatches(candidates);
         return result;
     }